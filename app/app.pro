@@ -54,21 +54,30 @@ SOURCES += main.cpp\
     genericdatacollectiontablefilterdialog.cpp \
     genericdatacollectiontablemodel.cpp \
     genericdatacollectiontablesearchdialog.cpp \
+    genericdatacolumn.cpp \
     genericdataobject.cpp \
     genericdataobjectfilter.cpp \
+    genericdataobjectpool.cpp \
     genericdataobjectlessthan.cpp \
+    genericdatavalueindex.cpp \
     imageutility.cpp \
     linkbackfilterdelegate.cpp \
     linkedfieldcache.cpp \
     linkedfieldselectioncache.cpp \
     mainwindow.cpp \
+    memoryusage.cpp \
+    memoryusagedialog.cpp \
+    preparedquerycache.cpp \
     qtenummapper.cpp \
     scrollmessagebox.cpp \
     searchoptions.cpp \
     sqldialog.cpp \
     sqlfieldtype.cpp \
     sqlfieldtypemaster.cpp \
+    sqlqueryresultmodel.cpp \
     stampdb.cpp \
+    stampdbasync.cpp \
+    stampdbworker.cpp \
     stampschema.cpp \
     stringutil.cpp \
     tableeditfielddescriptor.cpp \
@@ -76,6 +85,8 @@ SOURCES += main.cpp\
     tableeditorgenericgrid.cpp \
     tablefieldbinarytreeevalnode.cpp \
     tablefieldevalnode.cpp \
+    tablepagereader.cpp \
+    tablesnapshotcache.cpp \
     tablesortfield.cpp \
     tablesortfielddialog.cpp \
     tablesortfieldtablemodel.cpp \
@@ -90,6 +101,7 @@ HEADERS  += \
     changetracker.h \
     changetrackerbase.h \
     checkboxonlydelegate.h \
+    chunkedlist.h \
     comparer.h \
     configuredialog.h \
     constants.h \
@@ -100,6 +112,7 @@ HEADERS  += \
     csvreaderdialog.h \
     csvwriter.h \
     dbtransactionhandler.h \
+    fieldref.h \
     describesqlfield.h \
     describesqltable.h \
     describesqltables.h \
@@ -111,23 +124,32 @@ HEADERS  += \
     genericdatacollectiontablefilterdialog.h \
     genericdatacollectiontablemodel.h \
     genericdatacollectiontablesearchdialog.h \
+    genericdatacolumn.h \
     genericdataobject.h \
     genericdataobjectfilter.h \
+    genericdataobjectpool.h \
     genericdataobjectlessthan.h \
+    genericdatavalueindex.h \
     globals.h \
     imageutility.h \
     linkbackfilterdelegate.h \
     linkedfieldcache.h \
     linkedfieldselectioncache.h \
     mainwindow.h \
+    memoryusage.h \
+    memoryusagedialog.h \
     nullptr.h \
+    preparedquerycache.h \
     qtenummapper.h \
     scrollmessagebox.h \
     searchoptions.h \
     sqldialog.h \
     sqlfieldtype.h \
     sqlfieldtypemaster.h \
+    sqlqueryresultmodel.h \
     stampdb.h \
+    stampdbasync.h \
+    stampdbworker.h \
     stampschema.h \
     stringutil.h \
     tableeditfielddescriptor.h \
@@ -135,6 +157,8 @@ HEADERS  += \
     tableeditorgenericgrid.h \
     tablefieldbinarytreeevalnode.h \
     tablefieldevalnode.h \
+    tablepagereader.h \
+    tablesnapshotcache.h \
     tablesortfield.h \
     tablesortfielddialog.h \
     tablesortfieldtablemodel.h \
@@ -4,6 +4,8 @@
 #include "changetrackerbase.h"
 #include "changedobject.h"
 
+#include "memoryusage.h"
+
 #include <QStack>
 
 //**************************************************************************
@@ -97,6 +99,12 @@ public:
   /*! \brief Delete every element from every contained stack, delete everything in the list, then clear the list. */
   virtual void clear();
 
+  /*! \brief Add the memory used by the change history; each change holds copies of the new and old objects.
+   *
+   *  \param [in, out] usage Receives the bytes for the current component.
+   */
+  void addMemoryUsage(MemoryUsage& usage) const;
+
   protected:
   QStack< QStack<ChangedObject<T>*>* > m_list;
 
@@ -120,6 +128,31 @@ inline void ChangeTracker<T>::clear()
   m_list.clear();
 }
 
+template <class T>
+inline void ChangeTracker<T>::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::RowObjects, MemoryUsage::listBytes(m_list));
+  for (int i=0; i<m_list.size(); ++i)
+  {
+    const QStack<ChangedObject<T>*>* stack = m_list.at(i);
+    usage.add(MemoryUsage::RowObjects, sizeof(QStack<ChangedObject<T>*>) + MemoryUsage::listBytes(*stack));
+    for (int j=0; j<stack->size(); ++j)
+    {
+      const ChangedObject<T>* change = stack->at(j);
+      usage.add(MemoryUsage::RowObjects, sizeof(ChangedObject<T>));
+      usage.addString(change->getChangeInfo());
+      if (change->getNewData() != nullptr)
+      {
+        change->getNewData()->addMemoryUsage(usage);
+      }
+      if (change->getOldData() != nullptr)
+      {
+        change->getOldData()->addMemoryUsage(usage);
+      }
+    }
+  }
+}
+
 /**
 template <class T>
 inline ChangedObject<T>* ChangeTracker<T>::valueObject(const int i) const
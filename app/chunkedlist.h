@@ -0,0 +1,140 @@
+#ifndef CHUNKEDLIST_H
+#define CHUNKEDLIST_H
+
+#include <QList>
+#include <QDataStream>
+
+//**************************************************************************
+/*! \class ChunkedList
+ * \brief List of values stored in fixed size chunks, each of which is an implicitly shared QList.
+ *
+ * Copying the list shares every chunk. Writing to a value in a copy copies the list of
+ * chunk pointers and the one chunk that holds the value, not every value, so a snapshot
+ * of a large column costs little when a cell is later edited.
+ *
+ * Only what a column needs is supported: indexed access, resize at the end, and streaming
+ * in the same format as a QList so that data written from a QList can be read.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+template <class T>
+class ChunkedList
+{
+public:
+  /*! \brief Values in each chunk; the last chunk may hold fewer. */
+  static const int ChunkSize = 4096;
+
+  /*! \brief Constructor
+   *  \param [in] size Initial number of values.
+   *  \param [in] value Initial value for each slot.
+   */
+  explicit ChunkedList(const int size = 0, const T& value = T()) : m_size(0) { resize(size, value); }
+
+  /*! \return Number of values. */
+  int size() const { return m_size; }
+
+  /*! \return True if there are no values. */
+  bool isEmpty() const { return m_size == 0; }
+
+  /*! \brief Value at an index, which must be valid. */
+  const T& at(const int i) const { return m_chunks.at(i / ChunkSize).at(i % ChunkSize); }
+
+  /*! \brief Value at an index, which must be valid; only the chunk that holds the value is detached. */
+  T& operator[](const int i) { return m_chunks[i / ChunkSize][i % ChunkSize]; }
+
+  /*! \brief Change the number of values; new values are set to value.
+   *  \param [in] size New number of values.
+   *  \param [in] value Value for each new slot.
+   */
+  void resize(const int size, const T& value = T());
+
+  /*! \brief Reserve space for the chunk list; each chunk grows as values are added. */
+  void reserve(const int size) { m_chunks.reserve((size + ChunkSize - 1) / ChunkSize); }
+
+  /*! \brief Add a value at the end. */
+  void append(const T& value);
+
+  /*! \brief Remove every value. */
+  void clear() { m_chunks.clear(); m_size = 0; }
+
+  /*! \return Number of chunks. */
+  int chunkCount() const { return m_chunks.size(); }
+
+  /*! \return Chunk at an index, used to measure the memory used. */
+  const QList<T>& chunk(const int i) const { return m_chunks.at(i); }
+
+  /*! \return Chunk list, used to measure the memory used. */
+  const QList<QList<T> >& chunks() const { return m_chunks; }
+
+private:
+  QList<QList<T> > m_chunks;
+  int m_size;
+};
+
+template <class T>
+inline void ChunkedList<T>::resize(const int size, const T& value)
+{
+  const int newSize = qMax(0, size);
+  const int numChunks = (newSize + ChunkSize - 1) / ChunkSize;
+  m_chunks.resize(numChunks);
+  // Chunks before the smaller of the two sizes are full and stay as they are.
+  for (int i=qMin(m_size, newSize) / ChunkSize; i<numChunks; ++i)
+  {
+    const int remaining = newSize - i * ChunkSize;
+    const int chunkSize = (remaining < ChunkSize) ? remaining : ChunkSize;
+    if (m_chunks.at(i).size() != chunkSize)
+    {
+      m_chunks[i].resize(chunkSize, value);
+    }
+  }
+  m_size = newSize;
+}
+
+template <class T>
+inline void ChunkedList<T>::append(const T& value)
+{
+  if (m_chunks.isEmpty() || m_chunks.last().size() >= ChunkSize)
+  {
+    m_chunks.append(QList<T>());
+  }
+  m_chunks.last().append(value);
+  ++m_size;
+}
+
+//**************************************************************************
+/*! \brief Write the values in the same format as a QList. */
+template <class T>
+inline QDataStream& operator<<(QDataStream& stream, const ChunkedList<T>& list)
+{
+  stream << static_cast<quint32>(list.size());
+  for (int i=0; i<list.chunkCount(); ++i)
+  {
+    const QList<T>& chunk = list.chunk(i);
+    for (int j=0; j<chunk.size(); ++j)
+    {
+      stream << chunk.at(j);
+    }
+  }
+  return stream;
+}
+
+//**************************************************************************
+/*! \brief Read values written by a ChunkedList or a QList; a bad count stops at the end of the stream. */
+template <class T>
+inline QDataStream& operator>>(QDataStream& stream, ChunkedList<T>& list)
+{
+  list.clear();
+  quint32 n = 0;
+  stream >> n;
+  for (quint32 i=0; i<n && stream.status() == QDataStream::Ok; ++i)
+  {
+    T value;
+    stream >> value;
+    list.append(value);
+  }
+  return stream;
+}
+
+#endif // CHUNKEDLIST_H
@@ -6,6 +6,7 @@
 
 #include <QSettings>
 #include <QLineEdit>
+#include <QCheckBox>
 #include <QFileDialog>
 #include <QFile>
 #include <QMessageBox>
@@ -19,7 +20,7 @@
 #include <QScopedPointer>
 
 ConfigureDialog::ConfigureDialog(QWidget *parent) :
-  QDialog(parent), m_DBPath(nullptr), m_CatalogImagePath(nullptr), m_UserImagePath(nullptr)
+  QDialog(parent), m_DBPath(nullptr), m_CatalogImagePath(nullptr), m_UserImagePath(nullptr), m_UseSnapshotCache(nullptr)
 {
   buildDialog();
 }
@@ -43,6 +44,19 @@ QString ConfigureDialog::getLineEdit(QLineEdit *line_edit) const
     return (line_edit != nullptr) ? line_edit->text() : "";
 }
 
+void ConfigureDialog::setUseSnapshotCache(const bool use)
+{
+    if (m_UseSnapshotCache != nullptr)
+    {
+      m_UseSnapshotCache->setChecked(use);
+    }
+}
+
+bool ConfigureDialog::getUseSnapshotCache() const
+{
+    return (m_UseSnapshotCache != nullptr) && m_UseSnapshotCache->isChecked();
+}
+
 
 void ConfigureDialog::selectDir(QLineEdit* edit, const QString& header_txt)
 {
@@ -84,6 +98,7 @@ void ConfigureDialog::done(int r)
         pSettings->setValue(Constants::Settings_DBPath, getDBPath());
         pSettings->setValue(Constants::Settings_CatalogImagePath, getCatalogImagePath());
         pSettings->setValue(Constants::Settings_UserImagePath, getUserImagePath());
+        pSettings->setValue(Constants::Settings_UseSnapshotCache, getUseSnapshotCache());
     }
     QDialog::done(r);
     return;
@@ -151,6 +166,10 @@ void ConfigureDialog::buildDialog()
   hLayout->addWidget(button);
   fLayout->addRow(hLayout);
 
+  // Used the next time the database is opened.
+  m_UseSnapshotCache = new QCheckBox(tr("Keep a snapshot cache of loaded tables for faster opening"));
+  fLayout->addRow(m_UseSnapshotCache);
+
   QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal);
   connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
   connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
@@ -163,4 +182,5 @@ void ConfigureDialog::buildDialog()
   setDBPath(pSettings->value(Constants::Settings_DBPath).toString());
   setCatalogImagePath(pSettings->value(Constants::Settings_CatalogImagePath).toString());
   setUserImagePath(pSettings->value(Constants::Settings_UserImagePath).toString());
+  setUseSnapshotCache(pSettings->value(Constants::Settings_UseSnapshotCache, false).toBool());
 }
@@ -9,6 +9,7 @@
 #include "typemapper.h"
 
 class QLineEdit;
+class QCheckBox;
 
 //**************************************************************************
 /*! \class ConfigureDialog
@@ -42,6 +43,9 @@ public:
   void setUserImagePath(const QString& path) { setLineEdit(m_UserImagePath, path); }
   QString getUserImagePath() const { return getLineEdit(m_UserImagePath); }
 
+  void setUseSnapshotCache(const bool use);
+  bool getUseSnapshotCache() const;
+
   void setLineEdit(QLineEdit *line_edit, const QString& txt);
   QString getLineEdit(QLineEdit *line_edit) const;
 
@@ -63,6 +67,7 @@ private:
   QLineEdit* m_DBPath;
   QLineEdit* m_CatalogImagePath;
   QLineEdit* m_UserImagePath;
+  QCheckBox* m_UseSnapshotCache;
 };
 
 #endif // CONFIGUREDIALOG_H
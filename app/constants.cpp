@@ -20,6 +20,7 @@ QString Constants::Settings_SearchOptions = "SearchOptions";
 QString Constants::Settings_SearchReplaceValue = "SearchReplaceValue";
 QString Constants::Settings_SortFieldDlgGeometry = "SortFieldDlgGeometry";
 QString Constants::Settings_SQLDialogGeometry = "sqlDialogGeometry";
+QString Constants::Settings_UseSnapshotCache = "UseSnapshotCache";
 QString Constants::Settings_UserImagePath = "UserImagePath";
 QString Constants::SortFieldConfigDialogLastConfigPath = "SortFieldConfigDialogLastConfigPath";
 QString Constants::SortFieldConfigDialogRoutingColumnWidths = "SortFieldConfigDialogRoutingColumnWidths";
@@ -62,6 +62,9 @@ public:
   /*! Settings Name to access the path to the user images. */
   static QString Settings_UserImagePath;
 
+  /*! Settings Name to turn on the snapshot cache of loaded tables, off by default. */
+  static QString Settings_UseSnapshotCache;
+
 };
 
 #endif // CONSTANTS_H
@@ -32,6 +32,13 @@ QString CSVWriter::prepForWriting(const QVariant& columnValue)
 
 void CSVWriter::cleanup()
 {
+    // The stream is buffered, so it must be flushed before the file is closed.
+    if (m_outStream != nullptr)
+    {
+        m_outStream->flush();
+        delete m_outStream;
+        m_outStream = nullptr;
+    }
     if (m_file != nullptr)
     {
         if (m_file->isOpen())
@@ -41,11 +48,6 @@ void CSVWriter::cleanup()
         delete m_file;
         m_file = nullptr;
     }
-    if (m_outStream != nullptr)
-    {
-        delete m_outStream;
-        m_outStream = nullptr;
-    }
 }
 
 bool CSVWriter::setStreamWriteToString(QString* s)
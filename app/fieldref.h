@@ -0,0 +1,67 @@
+#ifndef FIELDREF_H
+#define FIELDREF_H
+
+#include <QString>
+
+class GenericDataCollection;
+
+//**************************************************************************
+/*! \class FieldRef
+ * \brief Resolved handle to a property (column) in a GenericDataCollection.
+ *
+ * Looking up a value by name converts the name to lower case and then hashes it.
+ * Resolve the name once and then use the handle inside of a loop:
+ *
+ * \code
+ * FieldRef ref = collection.resolve("paid");
+ * for (int row=0; row<collection.rowCount(); ++row)
+ * {
+ *   total += collection.getObjectByRow(row)->getDouble(ref);
+ * }
+ * \endcode
+ *
+ * When used with an object from the collection that resolved it, the column is
+ * accessed directly by index. Used with any other object, the stored lower case
+ * name is used, so the result is always correct.
+ *
+ * A handle is invalidated if the collection is cleared.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class FieldRef
+{
+public:
+  /*! \brief Default constructor creates an invalid reference. */
+  FieldRef() : m_collection(nullptr), m_index(-1) {}
+
+  /*! \brief Reference by name only; this is not bound to a collection.
+   *  \param [in] name Case insensitive property name.
+   */
+  explicit FieldRef(const QString& name) : m_collection(nullptr), m_index(-1), m_lowerCaseName(name.toLower()) {}
+
+  /*! \return True if this is bound to a column in a collection. */
+  bool isValid() const { return m_collection != nullptr && m_index >= 0; }
+
+  /*! \return Collection that resolved this reference, or nullptr. */
+  const GenericDataCollection* getCollection() const { return m_collection; }
+
+  /*! \return Column index in the collection, or -1. */
+  int getIndex() const { return m_index; }
+
+  /*! \return Lower case property name. */
+  const QString& getLowerCaseName() const { return m_lowerCaseName; }
+
+private:
+  friend class GenericDataCollection;
+
+  FieldRef(const GenericDataCollection* collection, const int index, const QString& lowerCaseName) :
+    m_collection(collection), m_index(index), m_lowerCaseName(lowerCaseName) {}
+
+  const GenericDataCollection* m_collection;
+  int m_index;
+  QString m_lowerCaseName;
+};
+
+#endif // FIELDREF_H
@@ -1,23 +1,242 @@
 #include "genericdatacollection.h"
 #include "csvwriter.h"
+#include "memoryusage.h"
 
 #include <QMetaType>
 #include <QUrl>
 #include <QUuid>
 #include <QDebug>
+#include <QBitArray>
+#include <QCollator>
+#include <QDataStream>
 #include <algorithm>
+#include <limits>
+
+namespace {
+
+//**************************************************************************
+/*! \brief Sort keys for one sort field, extracted once per slot so that comparisons do not touch a QVariant.
+ *
+ *  Integers, dates, times, and date/times become integer keys, doubles stay doubles, and strings
+ *  become QCollatorSortKey values from a collator set up like the view's, with numeric mode on and the
+ *  sort field's case sensitivity. A dictionary encoded column sorts its distinct values once and uses
+ *  the rank of each code as an integer key. Anything else, or a column that
+ *  contains values of a different type, falls back to comparing the values with the sort field.
+ **************************************************************************/
+class SortKey
+{
+public:
+  SortKey(const GenericDataColumn& column, const TableSortField* sortField) :
+    m_sortField(sortField), m_kind(VariantKey), m_ascending(sortField->isAscending())
+  {
+    const int n = column.size();
+    m_present.resize(n);
+    m_kind = kindForType(column.getMetaType());
+    // Same order as the table view, so numbers in text sort by value and accented letters sort by locale.
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(sortField->caseSensitivity());
+
+    if (m_kind == StringKey && column.isDictionaryEncoded())
+    {
+      extractDictionaryRanks(column, collator);
+    }
+    else if (m_kind != VariantKey)
+    {
+      if (m_kind == DoubleKey)
+        m_doubles.resize(n);
+      else if (m_kind == StringKey)
+      {
+        // The key for a slot is m_stringKeys.at(m_integers.at(slot)); a QCollatorSortKey has no default value.
+        m_integers.resize(n);
+        m_stringKeys.reserve(n);
+      }
+      else
+        m_integers.resize(n);
+
+      for (int slot=0; slot<n && m_kind != VariantKey; ++slot)
+      {
+        if (!column.contains(slot))
+        {
+          continue;
+        }
+        m_present.setBit(slot);
+        const QVariant v = column.value(slot);
+        if (v.metaType().id() != column.getMetaType())
+        {
+          // Mixed types, compare the values the slow way.
+          m_kind = VariantKey;
+          break;
+        }
+        switch (column.getMetaType())
+        {
+        case QMetaType::QDate :
+          m_integers[slot] = v.toDate().isValid() ? v.toDate().toJulianDay() : std::numeric_limits<qint64>::min();
+          break;
+        case QMetaType::QDateTime :
+          m_integers[slot] = v.toDateTime().isValid() ? v.toDateTime().toMSecsSinceEpoch() : std::numeric_limits<qint64>::min();
+          break;
+        case QMetaType::QTime :
+          m_integers[slot] = v.toTime().isValid() ? v.toTime().msecsSinceStartOfDay() : -1;
+          break;
+        case QMetaType::Double :
+          m_doubles[slot] = v.toDouble();
+          break;
+        case QMetaType::QString :
+          m_integers[slot] = m_stringKeys.size();
+          m_stringKeys.append(collator.sortKey(v.toString()));
+          break;
+        default:
+          m_integers[slot] = v.toLongLong();
+          break;
+        }
+      }
+    }
+
+    if (m_kind == VariantKey)
+    {
+      m_integers.clear();
+      m_doubles.clear();
+      m_stringKeys.clear();
+      m_variants.resize(n);
+      for (int slot=0; slot<n; ++slot)
+      {
+        m_present.setBit(slot, column.contains(slot));
+        if (column.contains(slot))
+        {
+          m_variants[slot] = column.value(slot);
+        }
+      }
+    }
+  }
+
+  /*! \brief Compare two slots honoring the sort order. A missing value sorts before a value when ascending. */
+  int compare(const int left, const int right) const
+  {
+    bool hasLeft = m_present.testBit(left);
+    bool hasRight = m_present.testBit(right);
+    int rc = 0;
+    if (!hasLeft || !hasRight)
+    {
+      rc = (hasLeft == hasRight) ? 0 : (hasLeft ? 1 : -1);
+    }
+    else
+    {
+      switch (m_kind)
+      {
+      case IntegerKey :
+        rc = (m_integers.at(left) < m_integers.at(right)) ? -1 : ((m_integers.at(right) < m_integers.at(left)) ? 1 : 0);
+        break;
+      case DoubleKey :
+        rc = (m_doubles.at(left) < m_doubles.at(right)) ? -1 : ((m_doubles.at(right) < m_doubles.at(left)) ? 1 : 0);
+        break;
+      case StringKey :
+        rc = m_stringKeys.at(m_integers.at(left)).compare(m_stringKeys.at(m_integers.at(right)));
+        break;
+      case VariantKey :
+        // The sort field already applies the sort order.
+        return m_sortField->valueCompare(m_variants.at(left), m_variants.at(right));
+      }
+    }
+    return m_ascending ? rc : -rc;
+  }
+
+private:
+  enum Kind { IntegerKey, DoubleKey, StringKey, VariantKey };
+
+  /*! \brief Sort the dictionary and use the rank of each code as the key. Equal strings have equal rank. */
+  void extractDictionaryRanks(const GenericDataColumn& column, const QCollator& collator)
+  {
+    const QStringList& dictionary = column.getDictionary();
+    QList<QCollatorSortKey> compareKeys;
+    QList<int> order;
+    compareKeys.reserve(dictionary.size());
+    order.reserve(dictionary.size());
+    for (int code=0; code<dictionary.size(); ++code)
+    {
+      compareKeys.append(collator.sortKey(dictionary.at(code)));
+      order.append(code);
+    }
+    std::sort(order.begin(), order.end(), [&compareKeys](const int left, const int right) {
+      return compareKeys.at(left).compare(compareKeys.at(right)) < 0;
+    });
+    QList<qint64> ranks(dictionary.size());
+    for (int i=0; i<order.size(); ++i)
+    {
+      bool sameAsPrevious = (i > 0 && compareKeys.at(order.at(i)).compare(compareKeys.at(order.at(i-1))) == 0);
+      ranks[order.at(i)] = sameAsPrevious ? ranks.at(order.at(i-1)) : i;
+    }
+
+    m_kind = IntegerKey;
+    m_integers.resize(column.size());
+    for (int slot=0; slot<column.size(); ++slot)
+    {
+      if (!column.contains(slot))
+      {
+        continue;
+      }
+      int code = column.getDictionaryCode(slot);
+      if (code < 0)
+      {
+        // Not a string, compare the values the slow way.
+        m_kind = VariantKey;
+        return;
+      }
+      m_present.setBit(slot);
+      m_integers[slot] = ranks.at(code);
+    }
+  }
+
+  static Kind kindForType(const QMetaType::Type columnType)
+  {
+    switch (columnType)
+    {
+    case QMetaType::Bool :
+    case QMetaType::Int :
+    case QMetaType::UInt :
+    case QMetaType::LongLong :
+    case QMetaType::QDate :
+    case QMetaType::QDateTime :
+    case QMetaType::QTime :
+      return IntegerKey;
+    case QMetaType::Double :
+      return DoubleKey;
+    case QMetaType::QString :
+      return StringKey;
+    default:
+      break;
+    }
+    return VariantKey;
+  }
+
+  const TableSortField* m_sortField;
+  Kind m_kind;
+  bool m_ascending;
+  QBitArray m_present;
+  QList<qint64> m_integers;
+  QList<double> m_doubles;
+  QList<QCollatorSortKey> m_stringKeys;
+  QList<QVariant> m_variants;
+};
+
+}
 
 GenericDataCollection::GenericDataCollection(QObject *parent) :
-  QObject(parent), m_largestId(-1), m_trackChanges(false)
+  QObject(parent), m_largestId(-1), m_trackChanges(false), m_rowIndexValidCount(0)
 {
 }
 
 GenericDataCollection::GenericDataCollection(const GenericDataCollection& obj) :
-    QObject(nullptr)
+    QObject(nullptr), m_largestId(-1), m_trackChanges(false), m_rowIndexValidCount(0)
 {
     operator=(obj);
 }
 
+GenericDataCollection::~GenericDataCollection()
+{
+  // The view pool releases the views.
+}
+
 void GenericDataCollection::makeDummy()
 {
   QStringList nameList;
@@ -32,35 +251,114 @@ void GenericDataCollection::makeDummy()
 }
 
 void GenericDataCollection::appendObject(const int id, GenericDataObject* obj)
+{
+  if (obj == nullptr)
+  {
+    removeObject(id);
+    return;
+  }
+
+  if (obj->isBound())
+  {
+    // A view is owned by its collection, so copy it before anything is removed.
+    GenericDataObject copy(*obj);
+    removeObject(id);
+    allocateSlot(id, &copy);
+  }
+  else
+  {
+    removeObject(id);
+    allocateSlot(id, obj);
+    delete obj;
+  }
+  m_sortedIDs.append(id);
+  if (id > m_largestId)
+  {
+    m_largestId = id;
+  }
+}
+
+void GenericDataCollection::appendValues(const int id, const QList<QVariant>& values)
 {
   removeObject(id);
-  if (obj != nullptr)
+  int slot = allocateSlot(id, nullptr);
+  int n = qMin(values.size(), m_columns.size());
+  for (int col=0; col<n; ++col)
   {
-    m_objects.insert(id, obj);
-    m_sortedIDs.append(id);
-    if (id > m_largestId)
+    const QVariant& value = values.at(col);
+    if (value.isValid())
     {
-      m_largestId = id;
+      setColumnValue(col, slot, value);
     }
   }
+  m_sortedIDs.append(id);
+  if (id > m_largestId)
+  {
+    m_largestId = id;
+  }
+}
+
+bool GenericDataCollection::updateValues(const int id, const QList<QVariant>& values)
+{
+  int slot = getSlot(id);
+  if (slot < 0)
+  {
+    return false;
+  }
+  int n = qMin(values.size(), m_columns.size());
+  for (int col=0; col<n; ++col)
+  {
+    const QVariant& value = values.at(col);
+    if (value.isValid())
+    {
+      setColumnValue(col, slot, value);
+    }
+    else if (m_columns.at(col).contains(slot))
+    {
+      removeColumnValue(col, slot);
+    }
+  }
+  return true;
 }
 
 void GenericDataCollection::removeObject(const int id)
 {
-  if (containsObject(id))
+  // Appending an object removes it first, so an unknown ID must not look through the rows.
+  if (getSlot(id) >= 0)
   {
-    m_sortedIDs.removeOne(id);
-    delete m_objects.take(id);
+    removeObjects(QList<int>() << id);
   }
 }
 
-void GenericDataCollection::removeRow(const int i)
+void GenericDataCollection::removeObjects(const QList<int>& ids)
 {
-  if (0 <= i && i < m_sortedIDs.size()) {
-    int id = m_sortedIDs.at(i);
-    m_sortedIDs.removeAt(i);
-    delete m_objects.take(id);
+  QList<int> rows;
+  rows.reserve(ids.size());
+  for (int i=0; i<ids.size(); ++i)
+  {
+    const int slot = getSlot(ids.at(i));
+    if (slot < 0)
+    {
+      continue;
+    }
+    const int row = getIndexOf(ids.at(i));
+    if (row >= 0)
+    {
+      rows.append(row);
+    }
+    else
+    {
+      // An object that is not in the row list only needs its slot back.
+      m_objects.remove(ids.at(i));
+      releaseSlot(slot);
+    }
   }
+  removeRows(rows);
+}
+
+void GenericDataCollection::removeRow(const int i)
+{
+  removeRows(QList<int>() << i);
 }
 
 void GenericDataCollection::insertRow(const int i, GenericDataObject *obj)
@@ -69,18 +367,372 @@ void GenericDataCollection::insertRow(const int i, GenericDataObject *obj)
   {
     int id = obj->getValue("id").toInt();
     if (i < 0) {
-      delete obj;
+      if (!obj->isBound())
+      {
+        delete obj;
+      }
     }
-    else if (i >= m_sortedIDs.size())
+    else if (i >= m_sortedIDs.size() || containsObject(id))
     {
       appendObject(id, obj);
     }
     else
     {
+      allocateSlot(id, obj);
+      if (!obj->isBound())
+      {
+        delete obj;
+      }
       m_sortedIDs.insert(i, id);
-      m_objects.insert(id, obj);
+      if (i < m_rowIndexValidCount)
+      {
+        // Every indexed row after the new one moved down by one.
+        ++m_rowIndexValidCount;
+        indexRows(i, m_rowIndexValidCount);
+      }
+      if (id > m_largestId)
+      {
+        m_largestId = id;
+      }
+    }
+  }
+}
+
+void GenericDataCollection::removeRows(const QList<int>& rows)
+{
+  QList<int> sortedRows;
+  sortedRows.reserve(rows.size());
+  for (int i=0; i<rows.size(); ++i)
+  {
+    if (0 <= rows.at(i) && rows.at(i) < m_sortedIDs.size())
+    {
+      sortedRows.append(rows.at(i));
+    }
+  }
+  if (sortedRows.isEmpty())
+  {
+    return;
+  }
+  std::sort(sortedRows.begin(), sortedRows.end());
+
+  QBitArray removed(m_sortedIDs.size());
+  for (int i=0; i<sortedRows.size(); ++i)
+  {
+    int row = sortedRows.at(i);
+    if (removed.testBit(row))
+    {
+      continue;
+    }
+    removed.setBit(row);
+    int id = m_sortedIDs.at(row);
+    m_rowOfId.remove(id);
+    int slot = getSlot(id);
+    if (slot >= 0)
+    {
+      m_objects.remove(id);
+      releaseSlot(slot);
+    }
+  }
+
+  // Compact the row list in a single pass; the reverse index moves with the rows that were indexed.
+  const int firstRow = sortedRows.first();
+  const int oldValidCount = m_rowIndexValidCount;
+  int validCount = qMin(oldValidCount, firstRow);
+  int out = firstRow;
+  for (int in=firstRow; in<m_sortedIDs.size(); ++in)
+  {
+    if (!removed.testBit(in))
+    {
+      const int id = m_sortedIDs.at(in);
+      m_sortedIDs[out] = id;
+      if (in < oldValidCount)
+      {
+        m_rowOfId.insert(id, out);
+        validCount = out + 1;
+      }
+      ++out;
+    }
+  }
+  m_sortedIDs.resize(out);
+  m_rowIndexValidCount = validCount;
+}
+
+void GenericDataCollection::indexRows(const int firstRow, const int endRow) const
+{
+  for (int row=qMax(0, firstRow); row<endRow && row<m_sortedIDs.size(); ++row)
+  {
+    m_rowOfId.insert(m_sortedIDs.at(row), row);
+  }
+}
+
+int GenericDataCollection::getIndexOf(const int id) const
+{
+  QHash<int, int>::const_iterator it = m_rowOfId.constFind(id);
+  if (it != m_rowOfId.constEnd() && it.value() < m_rowIndexValidCount && m_sortedIDs.at(it.value()) == id)
+  {
+    return it.value();
+  }
+
+  // Extend the valid part of the index until the ID is found.
+  while (m_rowIndexValidCount < m_sortedIDs.size())
+  {
+    int rowId = m_sortedIDs.at(m_rowIndexValidCount);
+    m_rowOfId.insert(rowId, m_rowIndexValidCount);
+    ++m_rowIndexValidCount;
+    if (rowId == id)
+    {
+      return m_rowIndexValidCount - 1;
+    }
+  }
+  return -1;
+}
+
+int GenericDataCollection::allocateSlot(const int id, const GenericDataObject* obj)
+{
+  int slot = m_slotIds.size();
+  m_slotIds.append(id);
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    m_columns[col].resize(slot + 1);
+  }
+  m_objects.insert(id, slot);
+
+  if (obj != nullptr)
+  {
+    if (obj->isBound())
+    {
+      setSlotProperties(slot, obj->getProperties());
     }
+    else
+    {
+      QHashIterator<QString, QVariant> i(obj->m_properties);
+      while (i.hasNext())
+      {
+        i.next();
+        setSlotValue(slot, i.key(), i.value());
+      }
+    }
+  }
+  return slot;
+}
+
+void GenericDataCollection::releaseSlot(const int slot)
+{
+  int lastSlot = m_slotIds.size() - 1;
+  if (!m_valueIndexes.isEmpty())
+  {
+    int id = m_slotIds.at(slot);
+    QMutableHashIterator<int, GenericDataValueIndex> i(m_valueIndexes);
+    while (i.hasNext())
+    {
+      i.next();
+      const GenericDataColumn& column = m_columns.at(i.key());
+      if (column.contains(slot))
+      {
+        i.value().remove(column.toString(slot), id);
+      }
+    }
+  }
+  if (slot < m_views.size())
+  {
+    m_viewPool.release(m_views.at(slot));
+    m_views[slot] = nullptr;
+  }
+  m_extraProperties.remove(slot);
+
+  if (slot != lastSlot)
+  {
+    // Move the last slot into the hole so that the storage stays dense.
+    for (int col=0; col<m_columns.size(); ++col)
+    {
+      m_columns[col].moveSlot(lastSlot, slot);
+    }
+    int movedId = m_slotIds.at(lastSlot);
+    m_slotIds[slot] = movedId;
+    m_objects.insert(movedId, slot);
+    GenericDataObject* movedView = (lastSlot < m_views.size()) ? m_views.at(lastSlot) : nullptr;
+    if (movedView != nullptr)
+    {
+      // slot < lastSlot, so it is inside of the view list.
+      m_views[slot] = movedView;
+      movedView->m_slot = slot;
+    }
+    if (m_extraProperties.contains(lastSlot))
+    {
+      m_extraProperties.insert(slot, m_extraProperties.take(lastSlot));
+    }
+  }
+
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    m_columns[col].removeLast();
+  }
+  m_slotIds.removeLast();
+  if (m_views.size() > lastSlot)
+  {
+    m_views.resize(lastSlot);
+  }
+}
+
+GenericDataObject* GenericDataCollection::getView(const int slot) const
+{
+  if (slot >= m_views.size())
+  {
+    // The view list grows on demand so that copying a collection does not touch every slot.
+    m_views.resize(m_slotIds.size());
+  }
+  GenericDataObject* view = m_views.at(slot);
+  if (view == nullptr)
+  {
+    view = m_viewPool.acquire(const_cast<GenericDataCollection*>(this), slot);
+    m_views[slot] = view;
+  }
+  return view;
+}
+
+bool GenericDataCollection::lookupValue(const int id, const QString& name, QVariant& value) const
+{
+  int slot = getSlot(id);
+  return (slot >= 0) ? slotValue(slot, name.toLower(), value) : false;
+}
+
+bool GenericDataCollection::slotContainsValue(const int slot, const QString& lowerCaseName) const
+{
+  int col = m_LowerCasePropertyNameMap.value(lowerCaseName, -1);
+  if (col >= 0)
+  {
+    return m_columns.at(col).contains(slot);
+  }
+  return !m_extraProperties.isEmpty() && m_extraProperties.value(slot).contains(lowerCaseName);
+}
+
+bool GenericDataCollection::slotValue(const int slot, const QString& lowerCaseName, QVariant& value) const
+{
+  int col = m_LowerCasePropertyNameMap.value(lowerCaseName, -1);
+  if (col >= 0)
+  {
+    const GenericDataColumn& column = m_columns.at(col);
+    if (!column.contains(slot))
+    {
+      return false;
+    }
+    value = column.value(slot);
+    return true;
+  }
+  if (!m_extraProperties.isEmpty() && m_extraProperties.value(slot).contains(lowerCaseName))
+  {
+    value = m_extraProperties.value(slot).value(lowerCaseName);
+    return true;
   }
+  return false;
+}
+
+void GenericDataCollection::setSlotValue(const int slot, const QString& lowerCaseName, const QVariant& value)
+{
+  int col = m_LowerCasePropertyNameMap.value(lowerCaseName, -1);
+  if (col >= 0)
+  {
+    setColumnValue(col, slot, value);
+  }
+  else
+  {
+    m_extraProperties[slot].insert(lowerCaseName, value);
+  }
+}
+
+void GenericDataCollection::setColumnValue(const int col, const int slot, const QVariant& value)
+{
+  GenericDataColumn& column = m_columns[col];
+  QHash<int, GenericDataValueIndex>::iterator it = m_valueIndexes.find(col);
+  if (it == m_valueIndexes.end())
+  {
+    column.setValue(slot, value);
+    return;
+  }
+
+  int id = m_slotIds.at(slot);
+  if (column.contains(slot))
+  {
+    it.value().remove(column.toString(slot), id);
+  }
+  column.setValue(slot, value);
+  it.value().insert(column.toString(slot), id);
+}
+
+void GenericDataCollection::removeColumnValue(const int col, const int slot)
+{
+  GenericDataColumn& column = m_columns[col];
+  if (!column.contains(slot))
+  {
+    return;
+  }
+  QHash<int, GenericDataValueIndex>::iterator it = m_valueIndexes.find(col);
+  if (it != m_valueIndexes.end())
+  {
+    it.value().remove(column.toString(slot), m_slotIds.at(slot));
+  }
+  column.removeValue(slot);
+}
+
+QHash<QString, QVariant> GenericDataCollection::slotProperties(const int slot) const
+{
+  QHash<QString, QVariant> properties = m_extraProperties.value(slot);
+  QHashIterator<QString, int> i(m_LowerCasePropertyNameMap);
+  while (i.hasNext())
+  {
+    i.next();
+    const GenericDataColumn& column = m_columns.at(i.value());
+    if (column.contains(slot))
+    {
+      properties.insert(i.key(), column.value(slot));
+    }
+  }
+  return properties;
+}
+
+void GenericDataCollection::setSlotProperties(const int slot, const QHash<QString, QVariant>& properties)
+{
+  m_extraProperties.remove(slot);
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    removeColumnValue(col, slot);
+  }
+  QHashIterator<QString, QVariant> i(properties);
+  while (i.hasNext())
+  {
+    i.next();
+    setSlotValue(slot, i.key(), i.value());
+  }
+}
+
+int GenericDataCollection::getInt(const int id, const QString& name, const int defaultValue) const
+{
+  QVariant v;
+  if (lookupValue(id, name, v))
+  {
+    bool ok = false;
+    int i = v.toInt(&ok);
+    if (ok)
+    {
+      return i;
+    }
+  }
+  return defaultValue;
+}
+
+double GenericDataCollection::getDouble(const int id, const QString& name, const double defaultValue) const
+{
+  QVariant v;
+  if (lookupValue(id, name, v))
+  {
+    bool ok = false;
+    double d = v.toDouble(&ok);
+    if (ok)
+    {
+      return d;
+    }
+  }
+  return defaultValue;
 }
 
 QMetaType::Type GenericDataCollection::getPropertyTypeMeta(const QString& name) const
@@ -102,6 +754,23 @@ int GenericDataCollection::getPropertyIndex(const QString& name) const
   return m_LowerCasePropertyNameMap.value(name.toLower(), -1);
 }
 
+FieldRef GenericDataCollection::resolve(const QString& name) const
+{
+  int i = getPropertyIndex(name);
+  return (i >= 0) ? FieldRef(this, i, m_lowerCasePropertyNames.at(i)) : FieldRef(name);
+}
+
+QList<FieldRef> GenericDataCollection::resolveAll(const QStringList& names) const
+{
+  QList<FieldRef> refs;
+  refs.reserve(names.size());
+  for (int i=0; i<names.size(); ++i)
+  {
+    refs.append(resolve(names.at(i)));
+  }
+  return refs;
+}
+
 bool GenericDataCollection::appendPropertyName(const QString& name, const QMetaType::Type pType)
 {
     QString lowerCaseName = name.toLower();
@@ -111,7 +780,28 @@ bool GenericDataCollection::appendPropertyName(const QString& name, const QMetaT
     }
     m_LowerCasePropertyNameMap.insert(lowerCaseName, m_propertyNames.size());
     m_propertyNames.append(name);
+    m_lowerCasePropertyNames.append(lowerCaseName);
     m_metaTypes.append(pType);
+    m_columns.append(GenericDataColumn(pType, m_slotIds.size()));
+
+    // A value may have been set using this name before the property existed.
+    if (!m_extraProperties.isEmpty())
+    {
+      GenericDataColumn& column = m_columns.last();
+      QMutableHashIterator<int, QHash<QString, QVariant> > i(m_extraProperties);
+      while (i.hasNext())
+      {
+        i.next();
+        if (i.value().contains(lowerCaseName))
+        {
+          column.setValue(i.key(), i.value().take(lowerCaseName));
+          if (i.value().isEmpty())
+          {
+            i.remove();
+          }
+        }
+      }
+    }
     return true;
 }
 
@@ -132,14 +822,15 @@ bool GenericDataCollection::exportToCSV(CSVWriter& writer) const
   for (int idx=0; idx < objKeys.size(); ++idx)
   {
     CSVLine newLine;
-    GenericDataObject* obj = m_objects.value(objKeys[idx]);
-    for (int i=0; i<getPropertNames().size(); ++i)
+    int slot = m_objects.value(objKeys[idx]);
+    for (int i=0; i<m_columns.size(); ++i)
     {
-      if (obj->containsValue(getPropertyName(i)))
+      const GenericDataColumn& column = m_columns.at(i);
+      if (column.contains(slot))
       {
-        QMetaType::Type columnType = getPropertyTypeMeta(i);
+        QMetaType::Type columnType = column.getMetaType();
         bool qualified = (columnType == QMetaType::QString);
-        newLine.append(CSVColumn(obj->getString(getPropertyName(i)), qualified, columnType));
+        newLine.append(CSVColumn(column.toString(slot), qualified, columnType));
       }
       else
       {
@@ -175,16 +866,34 @@ bool GenericDataCollection::exportToCSV(CSVWriter& writer) const
 
 const GenericDataObject* GenericDataCollection::getObjectByValue(const QString& name, const QString& compareValue, const Qt::CaseSensitivity sensitive) const
 {
-  QString lowerCaseName = name.toLower();
-  if (m_LowerCasePropertyNameMap.contains(lowerCaseName))
+  int col = getPropertyIndex(name);
+  if (col >= 0)
   {
-    QHashIterator<int, GenericDataObject*> i(m_objects);
-    while (i.hasNext())
+    const GenericDataValueIndex* index = findValueIndex(col, sensitive);
+    if (index != nullptr)
     {
-      i.next();
-      if (i.value() != nullptr && i.value()->valueIs(lowerCaseName, compareValue, sensitive))
+      QList<int> slotList = findIndexedSlots(index, col, compareValue, sensitive);
+      return slotList.isEmpty() ? nullptr : getView(slotList.first());
+    }
+
+    const GenericDataColumn& column = m_columns.at(col);
+    if (column.isDictionaryEncoded())
+    {
+      QBitArray matches = column.findMatches(compareValue, sensitive);
+      for (int slot=0; slot<matches.size(); ++slot)
+      {
+        if (matches.testBit(slot))
+        {
+          return getView(slot);
+        }
+      }
+      return nullptr;
+    }
+    for (int slot=0; slot<column.size(); ++slot)
+    {
+      if (column.contains(slot) && column.toString(slot).compare(compareValue, sensitive) == 0)
       {
-        return i.value();
+        return getView(slot);
       }
     }
   }
@@ -205,20 +914,42 @@ QList<const GenericDataObject*> GenericDataCollection::getMatchingValues(const Q
             return list;
         }
     }
-    QHashIterator<int, GenericDataObject*> i(m_objects);
+    QList<const GenericDataColumn*> columns;
+    QList<int> candidates;
+    bool useCandidates = false;
+    for (int index=0; index<max_num; ++index) {
+        int col = m_LowerCasePropertyNameMap.value(names[index]);
+        columns << &m_columns.at(col);
+        const GenericDataValueIndex* valueIndex = useCandidates ? nullptr : findValueIndex(col, sensitive);
+        if (valueIndex != nullptr) {
+            // Only the objects with a matching value in one indexed column need to be checked.
+            candidates = findIndexedSlots(valueIndex, col, values[index], sensitive);
+            useCandidates = true;
+        }
+    }
+    // A dictionary encoded column compares each distinct value once rather than once per object.
+    QList<QBitArray> columnMatches(max_num);
+    for (int index=0; index<max_num && !useCandidates; ++index) {
+        if (columns[index]->isDictionaryEncoded()) {
+            columnMatches[index] = columns[index]->findMatches(values[index], sensitive);
+        }
+    }
     bool object_matches;
-    while (i.hasNext())
+    int numToCheck = useCandidates ? candidates.size() : m_slotIds.size();
+    for (int i=0; i<numToCheck; ++i)
     {
-      i.next();
-      if (i.value() != nullptr)
-      {
-          object_matches = true;
-          for (int index=0; index<max_num && object_matches; ++index) {
-              object_matches = i.value()->valueIs(names[index], values[index], sensitive);
+      int slot = useCandidates ? candidates.at(i) : i;
+      object_matches = true;
+      for (int index=0; index<max_num && object_matches; ++index) {
+          const GenericDataColumn* column = columns[index];
+          if (!columnMatches.at(index).isEmpty()) {
+              object_matches = columnMatches.at(index).testBit(slot);
+          } else {
+              object_matches = column->contains(slot) && column->toString(slot).compare(values[index], sensitive) == 0;
           }
-          if (object_matches)
-              list << i.value();
       }
+      if (object_matches)
+          list << getView(slot);
     }
     return list;
 }
@@ -226,33 +957,137 @@ QList<const GenericDataObject*> GenericDataCollection::getMatchingValues(const Q
 int GenericDataCollection::countValues(const QString& name, const QString& compareValue, const Qt::CaseSensitivity sensitive) const
 {
   int iCount = 0;
-  QString lowerCaseName = name.toLower();
-  if (m_LowerCasePropertyNameMap.contains(lowerCaseName))
+  int col = getPropertyIndex(name);
+  if (col >= 0)
   {
-    QHashIterator<int, GenericDataObject*> i(m_objects);
-    while (i.hasNext())
+    const GenericDataValueIndex* index = findValueIndex(col, sensitive);
+    if (index != nullptr)
     {
-      i.next();
-      if (i.value() != nullptr && i.value()->valueIs(lowerCaseName, compareValue, sensitive))
-      {
-        ++iCount;
-      }
+      return findIndexedSlots(index, col, compareValue, sensitive).size();
     }
+
+    iCount = m_columns.at(col).findMatches(compareValue, sensitive).count(true);
   }
 
   return iCount;
 }
 
-void GenericDataCollection::clear()
+QDateTime GenericDataCollection::getLatestDateTime(const QString& name) const
 {
-    QHashIterator<int, GenericDataObject*> i(m_objects);
-    while (i.hasNext())
+  int col = getPropertyIndex(name);
+  return (col >= 0) ? m_columns.at(col).latestDateTime() : QDateTime();
+}
+
+int GenericDataCollection::encodeLowCardinalityColumns(const int maxDistinct)
+{
+  int numEncoded = 0;
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    if (m_metaTypes.at(col) == QMetaType::QString && m_columns[col].encodeAsDictionary(maxDistinct))
     {
-        i.next();
-        delete i.value();
+      ++numEncoded;
     }
+  }
+  return numEncoded;
+}
+
+void GenericDataCollection::beginLowCardinalityEncoding(const int maxDistinct)
+{
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    if (m_metaTypes.at(col) == QMetaType::QString)
+    {
+      m_columns[col].beginDictionary(maxDistinct);
+    }
+  }
+}
+
+int GenericDataCollection::endLowCardinalityEncoding()
+{
+  int numEncoded = 0;
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    if (m_metaTypes.at(col) == QMetaType::QString && m_columns[col].finishDictionary())
+    {
+      ++numEncoded;
+    }
+  }
+  return numEncoded;
+}
+
+bool GenericDataCollection::createIndex(const QString& name, const Qt::CaseSensitivity sensitive)
+{
+  int col = getPropertyIndex(name);
+  if (col < 0)
+  {
+    qDebug() << "Cannot create an index, table does not contain name " << name;
+    return false;
+  }
+
+  GenericDataValueIndex index(sensitive);
+  const GenericDataColumn& column = m_columns.at(col);
+  for (int slot=0; slot<column.size(); ++slot)
+  {
+    if (column.contains(slot))
+    {
+      index.insert(column.toString(slot), m_slotIds.at(slot));
+    }
+  }
+  m_valueIndexes.insert(col, index);
+  return true;
+}
+
+void GenericDataCollection::dropIndex(const QString& name)
+{
+  m_valueIndexes.remove(getPropertyIndex(name));
+}
+
+bool GenericDataCollection::hasIndex(const QString& name) const
+{
+  return m_valueIndexes.contains(getPropertyIndex(name));
+}
+
+const GenericDataValueIndex* GenericDataCollection::findValueIndex(const int col, const Qt::CaseSensitivity sensitive) const
+{
+  QHash<int, GenericDataValueIndex>::const_iterator it = m_valueIndexes.constFind(col);
+  return (it != m_valueIndexes.constEnd() && it.value().canSearch(sensitive)) ? &it.value() : nullptr;
+}
+
+QList<int> GenericDataCollection::findIndexedSlots(const GenericDataValueIndex* index, const int col, const QString& compareValue, const Qt::CaseSensitivity sensitive) const
+{
+  QList<int> ids = index->find(compareValue);
+  bool mustCompare = (index->getCaseSensitivity() != sensitive);
+  const GenericDataColumn& column = m_columns.at(col);
+  QList<int> slotList;
+  slotList.reserve(ids.size());
+  for (int i=0; i<ids.size(); ++i)
+  {
+    int slot = getSlot(ids.at(i));
+    // A case insensitive index returns candidates that may differ by case.
+    if (slot >= 0 && (!mustCompare || column.toString(slot).compare(compareValue, sensitive) == 0))
+    {
+      slotList.append(slot);
+    }
+  }
+  // Same order as a scan.
+  std::sort(slotList.begin(), slotList.end());
+  return slotList;
+}
+
+void GenericDataCollection::clear()
+{
+    m_views.clear();
+    m_viewPool.clear();
     m_objects.clear();
+    m_slotIds.clear();
+    m_columns.clear();
+    m_extraProperties.clear();
+    m_valueIndexes.clear();
+    m_sortedIDs.clear();
+    m_rowOfId.clear();
+    m_rowIndexValidCount = 0;
     m_propertyNames.clear();
+    m_lowerCasePropertyNames.clear();
     m_metaTypes.clear();
     m_LowerCasePropertyNameMap.clear();
 }
@@ -263,18 +1098,20 @@ const GenericDataCollection& GenericDataCollection::operator=(const GenericDataC
     {
         clear();
         m_propertyNames = obj.m_propertyNames;
+        m_lowerCasePropertyNames = obj.m_lowerCasePropertyNames;
         m_metaTypes = obj.m_metaTypes;
         m_LowerCasePropertyNameMap = obj.m_LowerCasePropertyNameMap;
 
-        QHashIterator<int, GenericDataObject*> i(obj.m_objects);
-        while (i.hasNext())
-        {
-            i.next();
-            if (i.value() != nullptr)
-            {
-                m_objects.insert(i.key(), i.value()->clone(this));
-            }
-        }
+        // The column storage is implicitly shared, so this does not copy the data.
+        m_columns = obj.m_columns;
+        m_objects = obj.m_objects;
+        m_slotIds = obj.m_slotIds;
+        m_extraProperties = obj.m_extraProperties;
+        m_valueIndexes = obj.m_valueIndexes;
+        m_sortedIDs = obj.m_sortedIDs;
+        m_rowOfId.clear();
+        m_rowIndexValidCount = 0;
+        m_largestId = obj.m_largestId;
     }
     return *this;
 }
@@ -298,16 +1135,139 @@ void GenericDataCollection::clearSortFields()
 
 void GenericDataCollection::sort()
 {
+    // Start ordered by ID so that ties are broken by ID.
+    invalidateRowIndex(0);
     m_sortedIDs = m_objects.keys();
+    std::sort(m_sortedIDs.begin(), m_sortedIDs.end());
     if (m_sortFields.size() == 0)
     {
-        std::sort(m_sortedIDs.begin(), m_sortedIDs.end());
+        rebuildRowIndex();
+        return;
     }
-    else
+
+    // Extract typed keys once per row for each sort field.
+    QList<SortKey> keys;
+    for (int i=0; i<m_sortFields.size(); ++i)
+    {
+        const TableSortField* sortField = m_sortFields.at(i);
+        int col = (sortField != nullptr) ? m_LowerCasePropertyNameMap.value(sortField->fieldName(), -1) : -1;
+        if (col >= 0)
+        {
+            keys.append(SortKey(m_columns.at(col), sortField));
+        }
+    }
+    if (keys.isEmpty())
+    {
+        rebuildRowIndex();
+        return;
+    }
+
+    // Sort the slots and then map back to IDs.
+    QList<int> slotOrder;
+    slotOrder.reserve(m_sortedIDs.size());
+    for (int i=0; i<m_sortedIDs.size(); ++i)
+    {
+        slotOrder.append(m_objects.value(m_sortedIDs.at(i)));
+    }
+    std::stable_sort(slotOrder.begin(), slotOrder.end(), [&keys](const int left, const int right) {
+        for (int i=0; i<keys.size(); ++i)
+        {
+            int rc = keys.at(i).compare(left, right);
+            if (rc != 0)
+            {
+                return rc < 0;
+            }
+        }
+        return false;
+    });
+    for (int i=0; i<slotOrder.size(); ++i)
     {
-        // TODO: Use the fields.
-        // https://qt-project.org/forums/viewthread/4978
+        m_sortedIDs[i] = m_slotIds.at(slotOrder.at(i));
     }
+    rebuildRowIndex();
+}
+
+void GenericDataCollection::rebuildRowIndex()
+{
+    // Every row moved, so index them all now rather than on each lookup.
+    m_rowOfId.clear();
+    m_rowOfId.reserve(m_sortedIDs.size());
+    indexRows(0, m_sortedIDs.size());
+    m_rowIndexValidCount = m_sortedIDs.size();
+}
+
+void GenericDataCollection::writeBinary(QDataStream& stream) const
+{
+  stream << m_propertyNames;
+  stream << static_cast<qint32>(m_metaTypes.size());
+  for (int col=0; col<m_metaTypes.size(); ++col)
+  {
+    stream << static_cast<qint32>(m_metaTypes.at(col));
+  }
+  // The storage is written as it is, so reading it back does not build a value per cell.
+  stream << m_slotIds << m_sortedIDs << static_cast<qint32>(m_largestId);
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    m_columns.at(col).writeBinary(stream);
+  }
+}
+
+bool GenericDataCollection::readBinary(QDataStream& stream)
+{
+  QStringList names;
+  qint32 numTypes = 0;
+  stream >> names >> numTypes;
+  if (stream.status() != QDataStream::Ok || numTypes != names.size())
+  {
+    return false;
+  }
+  for (int col=0; col<numTypes; ++col)
+  {
+    qint32 metaType = 0;
+    stream >> metaType;
+    if (!appendPropertyName(names.at(col), static_cast<QMetaType::Type>(metaType)))
+    {
+      return false;
+    }
+  }
+
+  qint32 largestId = -1;
+  stream >> m_slotIds >> m_sortedIDs >> largestId;
+  if (stream.status() != QDataStream::Ok || m_slotIds.size() != m_sortedIDs.size())
+  {
+    return false;
+  }
+  m_largestId = largestId;
+  m_objects.reserve(m_slotIds.size());
+  for (int slot=0; slot<m_slotIds.size(); ++slot)
+  {
+    if (m_objects.contains(m_slotIds.at(slot)))
+    {
+      return false;
+    }
+    m_objects.insert(m_slotIds.at(slot), slot);
+  }
+  // Every row must name a slot, or getObjectByRow would return nullptr.
+  for (int row=0; row<m_sortedIDs.size(); ++row)
+  {
+    if (!m_objects.contains(m_sortedIDs.at(row)))
+    {
+      return false;
+    }
+  }
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    if (!m_columns[col].readBinary(stream) || m_columns.at(col).size() != m_slotIds.size())
+    {
+      return false;
+    }
+  }
+  return stream.status() == QDataStream::Ok;
+}
+
+const GenericDataCollection* GenericDataCollection::createSnapshot() const
+{
+  return new GenericDataCollection(*this);
 }
 
 GenericDataObject* GenericDataCollection::createEmptyObject() const
@@ -380,3 +1340,35 @@ GenericDataObject* GenericDataCollection::createEmptyObject() const
     }
     return data;
 }
+
+void GenericDataCollection::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::RowObjects, sizeof(GenericDataCollection) + MemoryUsage::listBytes(m_columns) + MemoryUsage::listBytes(m_metaTypes));
+  usage.addStringList(MemoryUsage::RowObjects, m_propertyNames);
+  usage.addStringList(MemoryUsage::RowObjects, m_lowerCasePropertyNames);
+  for (int col=0; col<m_columns.size(); ++col)
+  {
+    m_columns.at(col).addMemoryUsage(usage);
+  }
+
+  // Views are row objects; their values are in the columns.
+  usage.add(MemoryUsage::RowObjects, MemoryUsage::listBytes(m_views) + m_viewPool.getAllocatedBytes());
+
+  usage.add(MemoryUsage::VariantPayloads, MemoryUsage::hashBytes(m_extraProperties));
+  for (QHash<int, QHash<QString, QVariant> >::const_iterator it = m_extraProperties.constBegin(); it != m_extraProperties.constEnd(); ++it)
+  {
+    usage.add(MemoryUsage::VariantPayloads, MemoryUsage::hashBytes(it.value()));
+    for (QHash<QString, QVariant>::const_iterator valueIt = it.value().constBegin(); valueIt != it.value().constEnd(); ++valueIt)
+    {
+      usage.addString(valueIt.key());
+      usage.addVariantPayload(valueIt.value());
+    }
+  }
+
+  usage.add(MemoryUsage::IndexStructures, MemoryUsage::hashBytes(m_objects) + MemoryUsage::listBytes(m_slotIds) + MemoryUsage::listBytes(m_sortedIDs) + MemoryUsage::hashBytes(m_rowOfId) + MemoryUsage::hashBytes(m_LowerCasePropertyNameMap));
+  usage.add(MemoryUsage::IndexStructures, MemoryUsage::hashBytes(m_valueIndexes));
+  for (QHash<int, GenericDataValueIndex>::const_iterator it = m_valueIndexes.constBegin(); it != m_valueIndexes.constEnd(); ++it)
+  {
+    it.value().addMemoryUsage(usage);
+  }
+}
@@ -2,6 +2,9 @@
 #define GENERICDATACOLLECTION_H
 
 #include "genericdataobject.h"
+#include "genericdatacolumn.h"
+#include "genericdataobjectpool.h"
+#include "genericdatavalueindex.h"
 #include "tablesortfield.h"
 #include "typemapper.h"
 
@@ -12,6 +15,8 @@
 #include <QMetaType>
 
 class CSVWriter;
+class QDataStream;
+class MemoryUsage;
 
 //**************************************************************************
 /*! \class GenericDataCollection
@@ -19,6 +24,12 @@ class CSVWriter;
  *
  * Think of this as a table
  *
+ * Values are stored by column; one GenericDataColumn per property with a typed vector
+ * and a null bitmap. Each object ID maps to a storage slot. A GenericDataObject returned
+ * by this class is a light weight view of a slot that is created when it is first requested
+ * and is owned by this collection. Views come from a slab pool that is released in one shot. An object passed into this collection is copied into the
+ * column storage and then deleted.
+ *
  * \author Andrew Pitonyak
  * \copyright Andrew Pitonyak, but you may use without restriction.
  * \date 2012-2018
@@ -41,6 +52,9 @@ public:
      */
     GenericDataCollection(const GenericDataCollection& obj);
 
+    /*! \brief Destructor releases the row views. */
+    ~GenericDataCollection();
+
     /*! Turn this into a "dummy" generic table with columns: "Id", "Name", "Date", "Time", "Double", and "Bool" with the obvious data types. */
     void makeDummy();
 
@@ -62,6 +76,24 @@ public:
    */
   int getPropertyIndex(const QString& name) const;
 
+  /*! \brief Resolve a property name once so that values can be accessed without hashing the name.
+   *  \param [in] name Case insensitive property name desired.
+   *  \return Resolved field; if the property does not exist, the field is not valid but still works by name.
+   */
+  FieldRef resolve(const QString& name) const;
+
+  /*! \brief Resolve a property by index.
+   *  \param [in] i Index of the property (the column).
+   *  \return Resolved field, which is not valid if the index is out of range.
+   */
+  FieldRef resolve(const int i) const;
+
+  /*! \brief Resolve a list of property names.
+   *  \param [in] names Case insensitive property names.
+   *  \return Resolved fields in the same order as the names.
+   */
+  QList<FieldRef> resolveAll(const QStringList& names) const;
+
   /*! \brief Get the property names.
    *  \return List of property names in index order.
    */
@@ -98,21 +130,51 @@ public:
   QMetaType::Type getPropertyTypeMeta(const int i) const;
 
 
-  /*! \brief Add an object with the specified integer ID. Null objects are ignored. This class owns and deletes the object. The sorted ID list is not updated.
+  /*! \brief Add an object with the specified integer ID. Null objects are ignored. The values are copied into this collection and a detached object is deleted. The ID is appended to the sorted ID list.
    * The largest ID is set if the ID is greater than the currently set largest ID.
    *  \param [in] id Objects integer ID.
    *  \param [in, out] obj Pointer to an object.
    */
   void appendObject(const int id, GenericDataObject* obj);
 
-  /*! \brief Delete an object from the list based on its ID. The sorted ID list is not updated.
+  /*! \brief Add an object with the specified integer ID using values in property index order.
+   *
+   *  This is the bulk load path; no GenericDataObject is created. An invalid value means that
+   *  the property is not set (null). Extra values are ignored. The ID is appended to the sorted ID list.
+   *
+   *  \param [in] id Objects integer ID.
+   *  \param [in] values Values in the same order as the property names.
+   */
+  void appendValues(const int id, const QList<QVariant>& values);
+
+  /*! \brief Replace the values of an existing object in place so that its row does not change.
+   *
+   *  An invalid value means that the property is not set (null). Extra values are ignored.
+   *
+   *  \param [in] id Objects integer ID.
+   *  \param [in] values Values in the same order as the property names.
+   *  \return True if the ID exists, false otherwise.
+   */
+  bool updateValues(const int id, const QList<QVariant>& values);
+
+  /*! \brief Delete an object from the list based on its ID. The ID is removed from the sorted ID list.
    *  \param [in] id Objects integer ID.
    */
   void removeObject(const int id);
 
+  /*! \brief Delete many objects by ID with one compaction of the row list; unknown IDs are ignored.
+   *  \param [in] ids Object IDs in any order.
+   */
+  void removeObjects(const QList<int>& ids);
+
   void removeRow(const int i);
   void insertRow(const int i, GenericDataObject* obj);
 
+  /*! \brief Remove many rows at once. The row list is compacted in a single pass.
+   *  \param [in] rows Row numbers to remove in any order; invalid and duplicate rows are ignored.
+   */
+  void removeRows(const QList<int>& rows);
+
   // TODO: Deal with the sorted list.
 
   bool exportToCSV(CSVWriter& writer) const;
@@ -137,7 +199,14 @@ public:
    */
   GenericDataObject* getObjectById (const int id);
 
+  /*! \return Every object ID in storage order, not row order; cheaper than walking the rows when the order does not matter. */
+  const QList<int>& getIds() const { return m_slotIds; }
+
   /*! \brief Find the "row" for this object ID.
+   *
+   *  Uses a reverse index that is extended as needed, so this is constant time
+   *  except after the rows are reordered.
+   *
    *  \param [in] id Unique object identifier.
    *  \return Index of this object, or -1 if not found.
    */
@@ -231,6 +300,12 @@ public:
    */
   int countValues(const QString& name, const QString& compareValue, const Qt::CaseSensitivity sensitive = Qt::CaseInsensitive) const;
 
+  /*! \brief Find the latest date and time in a property without creating a view for each row.
+   *  \param [in] name Property name.
+   *  \return Latest valid value, or an invalid QDateTime if the property does not exist or has none.
+   */
+  QDateTime getLatestDateTime(const QString& name) const;
+
   /*! \brief Get all values that match the listed search criteria.
    *
    *  The use case is to find a stamp with a scott number with a
@@ -252,6 +327,56 @@ public:
    */
   const GenericDataObject* getObjectByValue(const QString& name, const QString& compareValue, const Qt::CaseSensitivity sensitive = Qt::CaseInsensitive) const;
 
+  /*! \brief Dictionary encode string properties that have few distinct values, such as grade or condition.
+   *
+   *  Each value is then stored as a small integer code into a shared list of distinct strings.
+   *  Searching by value and sorting compare each distinct string once rather than once per object.
+   *  Call this after the data is loaded; values added later are added to the dictionary
+   *  until a property would have more than maxDistinct distinct values, and then it goes back to plain strings.
+   *
+   *  \param [in] maxDistinct Maximum number of distinct values for a property to be encoded.
+   *  \return Number of properties that are encoded.
+   */
+  int encodeLowCardinalityColumns(const int maxDistinct = GenericDataColumn::DefaultMaxDistinct);
+
+  /*! \brief Dictionary encode the string properties of an empty collection as values are appended.
+   *
+   *  This avoids a second pass over the data after loading. A property with more than maxDistinct
+   *  distinct values goes back to plain strings as soon as that is known.
+   *  Call endLowCardinalityEncoding once the data is loaded.
+   *
+   *  \param [in] maxDistinct Maximum number of distinct values for a property to be encoded.
+   */
+  void beginLowCardinalityEncoding(const int maxDistinct = GenericDataColumn::DefaultMaxDistinct);
+
+  /*! \brief Finish the encoding started by beginLowCardinalityEncoding; a property stays encoded only if most values repeat.
+   *  \return Number of properties that are encoded.
+   */
+  int endLowCardinalityEncoding();
+
+  /*! \brief Create a secondary index on a property so that searching by value does not scan every object.
+   *
+   *  The index is kept current as objects are added, removed, and modified, and it is
+   *  used automatically by countValues, getMatchingValues, and getObjectByValue.
+   *  A case insensitive index can answer both case sensitive and insensitive searches.
+   *
+   *  \param [in] name Case Insensitive name of the property of interest.
+   *  \param [in] sensitive Case sensitivity of the index, default is NOT case sensitive.
+   *  \return True if the index was created, false if the property does not exist.
+   */
+  bool createIndex(const QString& name, const Qt::CaseSensitivity sensitive = Qt::CaseInsensitive);
+
+  /*! \brief Remove the secondary index on a property if there is one.
+   *  \param [in] name Case Insensitive name of the property of interest.
+   */
+  void dropIndex(const QString& name);
+
+  /*! \brief Determine if a property has a secondary index.
+   *  \param [in] name Case Insensitive name of the property of interest.
+   *  \return True if the property has a secondary index.
+   */
+  bool hasIndex(const QString& name) const;
+
   void clear();
 
   void clearSortFields();
@@ -261,17 +386,54 @@ public:
   const QList<TableSortField*>& getSortFields() const;
 
   /*! \brief Assignment operator. The copied objects set the parent to be this object.
+   *
+   *  The storage is implicitly shared, so this costs about the same regardless of the number of objects.
+   *  A column is duplicated only when one of the two collections modifies it. Sort fields are not copied.
+   *
    *  \param [in] obj Object that is be copied.
    */
   const GenericDataCollection& operator=(const GenericDataCollection& obj);
 
   /*! number of objects. Same as object count. */
   int rowCount() const;
+
+  /*! \brief Sort the rows (the sorted ID list) using the sort fields, or by ID if there are no sort fields.
+   *
+   *  Each sort field honors its order and case sensitivity. Typed sort keys are extracted once per row
+   *  and the sort is stable with ties broken by ID.
+   */
   void sort();
 
   bool isTrackChanges() const { return m_trackChanges; }
   void setTrackChanges (const bool b) { m_trackChanges = b; }
 
+  /*! \brief Create a read only copy of this collection as it is right now.
+   *
+   *  Taking a snapshot shares all of the storage with this collection (copy on write), so it is cheap.
+   *  Later changes to this collection duplicate only the columns that they modify, and they are not
+   *  visible in the snapshot. A snapshot may be read by another thread (for example, an export) while
+   *  this collection is edited, as long as the snapshot itself is only used by one thread at a time.
+   *
+   *  \return New snapshot owned by the caller.
+   */
+  const GenericDataCollection* createSnapshot() const;
+
+  /*! \brief Write the properties, the ID and row order, and each column's storage; values set using names that are not properties are not written.
+   *  \param [in, out] stream Stream to which the data is written.
+   */
+  void writeBinary(QDataStream& stream) const;
+
+  /*! \brief Read data written by writeBinary into this empty collection.
+   *  \param [in, out] stream Stream from which the data is read.
+   *  \return True if the data was read without error.
+   */
+  bool readBinary(QDataStream& stream);
+
+  /*! \brief Add the memory used by this collection; values, the ID and row maps, the views, and any secondary indexes.
+   *  \param [in, out] usage Receives the bytes for the current component.
+   */
+  void addMemoryUsage(MemoryUsage& usage) const;
+
   // This will set the ID to be 1 more than the greatest ID present.
   GenericDataObject* createEmptyObject() const;
 
@@ -280,6 +442,57 @@ signals:
 public slots:
 
 private:
+  friend class GenericDataObject;
+
+  /*! \brief Get the storage slot for an ID.
+   *  \param [in] id Unique object identifier.
+   *  \return Storage slot, or -1 if the ID is not present.
+   */
+  int getSlot(const int id) const;
+
+  /*! \brief Get (and create if needed) the view for a storage slot. */
+  GenericDataObject* getView(const int slot) const;
+
+  /*! \brief Allocate a new slot for an ID and copy the object's values into it.
+   *  \param [in] id Unique object identifier, which must not already be present.
+   *  \param [in] obj Object whose values are copied.
+   *  \return The new storage slot.
+   */
+  int allocateSlot(const int id, const GenericDataObject* obj);
+
+  /*! \brief Release a slot by moving the last slot into it. The ID to slot map is updated. */
+  void releaseSlot(const int slot);
+
+  /*! \brief Get a value by ID without any conversions.
+   *  \param [in] id Unique object identifier.
+   *  \param [in] name Property name of interest.
+   *  \param [out] value Set to the value if it exists.
+   *  \return True if the value exists.
+   */
+  bool lookupValue(const int id, const QString& name, QVariant& value) const;
+
+  /*! \brief Support for GenericDataObject views. Property names must be lower case. */
+  bool slotContainsValue(const int slot, const QString& lowerCaseName) const;
+  bool slotValue(const int slot, const QString& lowerCaseName, QVariant& value) const;
+  void setSlotValue(const int slot, const QString& lowerCaseName, const QVariant& value);
+  QHash<QString, QVariant> slotProperties(const int slot) const;
+  void setSlotProperties(const int slot, const QHash<QString, QVariant>& properties);
+
+  /*! \brief Set or remove a value in a column; any secondary index on the column is updated. */
+  void setColumnValue(const int col, const int slot, const QVariant& value);
+  void removeColumnValue(const int col, const int slot);
+
+  /*! \brief Find the index that can answer a search on a column, or nullptr. */
+  const GenericDataValueIndex* findValueIndex(const int col, const Qt::CaseSensitivity sensitive) const;
+
+  /*! \brief Slots (in ascending order) whose value in the column matches, using the column's index.
+   *  \param [in] index Index on the column as returned by findValueIndex.
+   *  \param [in] col Column searched.
+   *  \param [in] compareValue Value against which to compare.
+   *  \param [in] sensitive Case sensitivity of the search.
+   */
+  QList<int> findIndexedSlots(const GenericDataValueIndex* index, const int col, const QString& compareValue, const Qt::CaseSensitivity sensitive) const;
+
   /*! \brief largest used ID. */
   int m_largestId;
 
@@ -288,11 +501,32 @@ private:
   /*! \brief In-order list of property names using what ever case is desired. This list is assumed to not have duplicate names based on case. */
   QStringList m_propertyNames;
 
+  /*! \brief In-order list of lower case property names, used by resolved fields. */
+  QStringList m_lowerCasePropertyNames;
+
   /*! \brief In-order list of property types. */
   QList<QMetaType::Type> m_metaTypes;
 
-  /*! \brief Map an integer ID to a specific object. */
-  QHash<int, GenericDataObject*> m_objects;
+  /*! \brief Map an integer ID to a storage slot. */
+  QHash<int, int> m_objects;
+
+  /*! \brief Column storage in property order. */
+  QList<GenericDataColumn> m_columns;
+
+  /*! \brief Map a storage slot to an integer ID. */
+  QList<int> m_slotIds;
+
+  /*! \brief Views of the slots; created as needed, so most entries are nullptr. This may be shorter than the slot list. */
+  mutable QList<GenericDataObject*> m_views;
+
+  /*! \brief Owns the views. */
+  mutable GenericDataObjectPool m_viewPool;
+
+  /*! \brief Values set on a slot using a name that is not a property; rarely used. Keyed by slot and then lower case name. */
+  QHash<int, QHash<QString, QVariant> > m_extraProperties;
+
+  /*! \brief Secondary value indexes keyed by column. */
+  QHash<int, GenericDataValueIndex> m_valueIndexes;
 
   /*! \brief Provides a fast way to map to the actual property name in a case insensitive way. */
   QHash<QString, int> m_LowerCasePropertyNameMap;
@@ -304,6 +538,24 @@ private:
   /*! \brief IDs in some sorted order for record traversal. So, you sort this list and then traverse it. */
   QList<int> m_sortedIDs;
 
+  /*! \brief Reverse index from an ID to its row in m_sortedIDs.
+   *  Only entries for rows less than m_rowIndexValidCount are trusted. Inserts, removes, and sorts keep
+   *  those entries correct; rows appended after them are indexed when they are looked up.
+   */
+  mutable QHash<int, int> m_rowOfId;
+
+  /*! \brief Number of leading rows whose entries in m_rowOfId are correct. */
+  mutable int m_rowIndexValidCount;
+
+  /*! \brief Rows at or after this row moved, so their reverse index entries can no longer be trusted. */
+  void invalidateRowIndex(const int row) const;
+
+  /*! \brief Set the reverse index entries for rows firstRow up to, but not including, endRow. */
+  void indexRows(const int firstRow, const int endRow) const;
+
+  /*! \brief Index every row, used after the rows are reordered. */
+  void rebuildRowIndex();
+
   TypeMapper m_mapper;
 };
 
@@ -317,6 +569,11 @@ inline bool GenericDataCollection::containsProperty(const QString& fieldName) co
   return m_LowerCasePropertyNameMap.contains(fieldName.toLower());
 }
 
+inline FieldRef GenericDataCollection::resolve(const int i) const
+{
+  return (0 <= i && i < m_lowerCasePropertyNames.size()) ? FieldRef(this, i, m_lowerCasePropertyNames.at(i)) : FieldRef();
+}
+
 inline int GenericDataCollection::getPropertyNameCount() const
 {
   return m_propertyNames.size();
@@ -338,29 +595,39 @@ inline bool GenericDataCollection::containsObject(const int id) const
   return m_objects.contains(id);
 }
 
+inline int GenericDataCollection::getSlot(const int id) const
+{
+  return m_objects.value(id, -1);
+}
+
 inline const GenericDataObject* GenericDataCollection::getObjectById (const int id) const
 {
-  return containsObject(id) ? m_objects.value(id) : nullptr;
+  int slot = getSlot(id);
+  return (slot >= 0) ? getView(slot) : nullptr;
 }
 
 inline GenericDataObject* GenericDataCollection::getObjectById (const int id)
 {
-  return containsObject(id) ? m_objects.value(id) : nullptr;
+  int slot = getSlot(id);
+  return (slot >= 0) ? getView(slot) : nullptr;
 }
 
-inline int GenericDataCollection::getIndexOf(const int id) const
+inline void GenericDataCollection::invalidateRowIndex(const int row) const
 {
-  return m_sortedIDs.indexOf(id);
+  if (row < m_rowIndexValidCount)
+  {
+    m_rowIndexValidCount = (row < 0) ? 0 : row;
+  }
 }
 
 inline const GenericDataObject* GenericDataCollection::getObjectByRow(const int row) const
 {
-  return (0 <= row && row < m_sortedIDs.size()) ? m_objects.value(m_sortedIDs.value(row)) : nullptr;
+  return (0 <= row && row < m_sortedIDs.size()) ? getObjectById(m_sortedIDs.at(row)) : nullptr;
 }
 
 inline GenericDataObject* GenericDataCollection::getObjectByRow (const int row)
 {
-  return (0 <= row && row < m_sortedIDs.size()) ? m_objects.value(m_sortedIDs.value(row)) : nullptr;
+  return (0 <= row && row < m_sortedIDs.size()) ? getObjectById(m_sortedIDs.at(row)) : nullptr;
 }
 
 inline int GenericDataCollection::getLargestId() const
@@ -375,47 +642,44 @@ inline void GenericDataCollection::setLargestId(const int n)
 
 inline bool GenericDataCollection::containsValue(const int id, const QString& name) const
 {
-  return containsObject(id) ? m_objects.value(id)->containsValue(name) : false;
+  QVariant v;
+  return lookupValue(id, name, v);
 }
 
 inline QString GenericDataCollection::getString(const int id, const QString& name) const
 {
-  return containsObject(id) ? m_objects.value(id)->getString(name) : "";
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toString() : "";
 }
 
 inline QString GenericDataCollection::getString(const int id, const QString& name, const QString& defaultValue) const
 {
-  return containsObject(id) ? m_objects.value(id)->getString(name) : defaultValue;
-}
-
-inline int GenericDataCollection::getInt(const int id, const QString& name, const int defaultValue) const
-{
-  return containsObject(id) ? m_objects.value(id)->getInt(name) : defaultValue;
-}
-
-inline double GenericDataCollection::getDouble(const int id, const QString& name, const double defaultValue) const
-{
-  return containsObject(id) ? m_objects.value(id)->getDouble(name) : defaultValue;
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toString() : defaultValue;
 }
 
 inline QDate GenericDataCollection::getDate(const int id, const QString& name) const
 {
-  return containsObject(id) ? m_objects.value(id)->getDate(name) : QDate::currentDate();
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toDate() : QDate::currentDate();
 }
 
 inline QDate GenericDataCollection::getDate(const int id, const QString& name, const QDate& defaultValue) const
 {
-  return containsObject(id) ? m_objects.value(id)->getDate(name) : defaultValue;
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toDate() : defaultValue;
 }
 
 inline QDateTime GenericDataCollection::getDateTime(const int id, const QString& name) const
 {
-  return containsObject(id) ? m_objects.value(id)->getDateTime(name) : QDateTime::currentDateTime();
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toDateTime() : QDateTime::currentDateTime();
 }
 
 inline QDateTime GenericDataCollection::getDateTime(const int id, const QString& name, const QDateTime& defaultValue) const
 {
-  return containsObject(id) ? m_objects.value(id)->getDateTime(name) : defaultValue;
+  QVariant v;
+  return lookupValue(id, name, v) ? v.toDateTime() : defaultValue;
 }
 
 inline const QString GenericDataCollection::getPropertyName(const int i) const
@@ -1,4 +1,5 @@
 #include "genericdatacollections.h"
+#include "memoryusage.h"
 
 GenericDataCollections::GenericDataCollections(QObject *parent) :
     QObject(parent)
@@ -39,3 +40,16 @@ QVariant GenericDataCollections::getValue(const QString& tableName, const int id
   }
   return QVariant();
 }
+
+void GenericDataCollections::addMemoryUsage(MemoryUsage& usage) const
+{
+    for (int i=0; i<m_names.size(); ++i)
+    {
+        const GenericDataCollection* table = getTable(m_names.at(i));
+        if (table != nullptr)
+        {
+            usage.setComponent(m_names.at(i));
+            table->addMemoryUsage(usage);
+        }
+    }
+}
@@ -66,6 +66,13 @@ public:
      ***************************************************************************/
     QVariant getValue(const QString& tableName, const int id, const QString& fieldName);
 
+    //**************************************************************************
+    /*! \brief Add the memory used by each table as a component named for the table.
+     *
+     *  \param [in, out] usage Receives the bytes.
+     ***************************************************************************/
+    void addMemoryUsage(MemoryUsage& usage) const;
+
 signals:
 
 public slots:
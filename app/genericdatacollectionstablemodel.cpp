@@ -2,10 +2,14 @@
 
 #include "describesqltables.h"
 #include "dbtransactionhandler.h"
+#include "memoryusage.h"
+#include "preparedquerycache.h"
 
 #include <QLocale>
 #include <QQueue>
 #include <QSqlQuery>
+#include <QSqlError>
+#include <QSet>
 #include <QRegularExpression>
 #include <QRegularExpressionMatch>
 #include <QCollator>
@@ -23,6 +27,68 @@ GenericDataCollectionsTableModel::GenericDataCollectionsTableModel(const bool us
   if (tableSchema != nullptr) {
       m_schema = *tableSchema;
   }
+  resolveColumns();
+}
+
+GenericDataCollectionsTableModel::~GenericDataCollectionsTableModel()
+{
+  delete m_pageReader;
+}
+
+void GenericDataCollectionsTableModel::setPageReader(TablePageReader* reader)
+{
+  if (reader != m_pageReader)
+  {
+    delete m_pageReader;
+    m_pageReader = reader;
+  }
+}
+
+bool GenericDataCollectionsTableModel::canFetchMore(const QModelIndex &parent) const
+{
+  return !parent.isValid() && m_pageReader != nullptr && !m_pageReader->atEnd();
+}
+
+void GenericDataCollectionsTableModel::fetchMore(const QModelIndex &parent)
+{
+  if (!canFetchMore(parent))
+  {
+    return;
+  }
+  QList<int> keys;
+  QList<QList<QVariant> > rows;
+  if (m_pageReader->readNextPage(keys, rows) > 0)
+  {
+    int firstRow = m_table->rowCount();
+    beginInsertRows(QModelIndex(), firstRow, firstRow + keys.size() - 1);
+    for (int i=0; i<keys.size(); ++i)
+    {
+      m_table->appendValues(keys.at(i), rows.at(i));
+    }
+    endInsertRows();
+  }
+}
+
+void GenericDataCollectionsTableModel::fetchAll()
+{
+  while (canFetchMore(QModelIndex()))
+  {
+    fetchMore(QModelIndex());
+  }
+}
+
+void GenericDataCollectionsTableModel::resolveColumns() const
+{
+  m_columnRefs.clear();
+  m_columnSchemas.clear();
+  if (m_table != nullptr)
+  {
+    for (int i=0; i<m_table->getPropertyNameCount(); ++i)
+    {
+      m_columnRefs.append(m_table->resolve(i));
+      m_columnSchemas.append(m_schema.getFieldByName(m_table->getPropertyName(i)));
+    }
+  }
 }
 
 QModelIndex GenericDataCollectionsTableModel::getIndexByRowCol(int row, int col) const
@@ -133,9 +199,13 @@ QVariant GenericDataCollectionsTableModel::data( const QModelIndex &index, int r
   const GenericDataObject* object = (index.column() < m_table->getPropertyNameCount()) ? m_table->getObjectByRow(index.row()) : nullptr;
   if (object != nullptr)
   {
-    QString fieldName = m_table->getPropertyName(index.column());
-    Q_ASSERT_X(m_schema.containsField(fieldName), "GenericDataCollectionsTableModel::data", qPrintable(QString("Schema does not have field %1").arg(fieldName)));
-    const DescribeSqlField* fieldSchema = m_schema.getFieldByName(fieldName);
+    if (m_columnRefs.size() != m_table->getPropertyNameCount())
+    {
+      resolveColumns();
+    }
+    const FieldRef& ref = m_columnRefs.at(index.column());
+    const DescribeSqlField* fieldSchema = m_columnSchemas.at(index.column());
+    Q_ASSERT_X(fieldSchema != nullptr, "GenericDataCollectionsTableModel::data", qPrintable(QString("Schema does not have field %1").arg(ref.getLowerCaseName())));
 
     if (role == Qt::EditRole)
     {
@@ -147,7 +217,7 @@ QVariant GenericDataCollectionsTableModel::data( const QModelIndex &index, int r
         returnList.append(getLinkEditValues(fieldSchema->getLinkTableName(), fieldSchema->getLinkDisplayField()));
         return returnList;
       }
-      return object->getValue(m_table->getPropertyName(index.column()));
+      return object->get(ref);
     }
     else if (role == Qt::DisplayRole)
     {
@@ -155,14 +225,14 @@ QVariant GenericDataCollectionsTableModel::data( const QModelIndex &index, int r
       if (fieldSchema->isCurrency())
       {
         QLocale locale;
-        return locale.toCurrencyString(object->getValueNative(fieldName).toDouble());
+        return locale.toCurrencyString(object->get(ref).toDouble());
       }
       else if (m_useLinks && fieldSchema->isLinkField())
       {
-        int linkId = object->getInt(m_table->getPropertyName(index.column()));
+        int linkId = object->getInt(ref);
         return getLinkValues(fieldSchema->getLinkTableName(), linkId, fieldSchema->getLinkDisplayField());
       }
-      return object->getValue(m_table->getPropertyName(index.column()));
+      return object->get(ref);
     }
   }
   return QVariant();
@@ -195,10 +265,19 @@ QStringList GenericDataCollectionsTableModel::getLinkEditValues(const QString& t
   // List that will be returned
   QStringList list;
 
+  // Resolve the fields once rather than for every row.
+  const FieldRef idRef = table->resolve("id");
+  const QList<FieldRef> fieldRefs = table->resolveAll(fields);
+  QList<const DescribeSqlField*> fieldSchemas;
+  for (int iField=0; iField < fields.size(); ++iField)
+  {
+    fieldSchemas.append(schema->getFieldByName(fields.at(iField)));
+  }
+
   for (int iRow=0; iRow < table->rowCount(); ++iRow)
   {
     const GenericDataObject* row = table->getObjectByRow(iRow);
-    int rowId = row->getInt("id");
+    int rowId = row->getInt(idRef);
     const QString* cachedValue = m_linkCache.getCacheValue(cacheId, rowId);
 
     if (cachedValue != nullptr)
@@ -212,11 +291,10 @@ QStringList GenericDataCollectionsTableModel::getLinkEditValues(const QString& t
         if (iField > 0) {
           s = s.append(('/'));
         }
-        QString fieldName = fields.at(iField);
-        const DescribeSqlField* fieldSchema = schema->getFieldByName(fieldName);
-        int linkId = row->getInt(fieldName);
+        const DescribeSqlField* fieldSchema = fieldSchemas.at(iField);
         if (fieldSchema->isLinkField())
         {
+          int linkId = row->getInt(fieldRefs.at(iField));
           QString fieldCacheId = innerFieldToCacheId[iField];
           // Test for a cached value
           const QString* cachedValue = m_linkCache.getCacheValue(fieldCacheId, linkId);
@@ -231,7 +309,7 @@ QStringList GenericDataCollectionsTableModel::getLinkEditValues(const QString& t
         }
         else
         {
-          s = s.append(row->getString(fieldName));
+          s = s.append(row->getString(fieldRefs.at(iField)));
         }
       }
       const_cast<LinkedFieldSelectionCache&>(m_linkCache).addCacheValue(cacheId, rowId, s);
@@ -353,6 +431,7 @@ void GenericDataCollectionsTableModel::getRowsAscending(const QModelIndexList& l
 
 void GenericDataCollectionsTableModel::addRow()
 {
+  fetchAll();
   GenericDataObject* newData = m_table->createEmptyObject();
   QStack<ChangedObject<GenericDataObject>*> * lastChanges = m_isTracking ? new QStack<ChangedObject<GenericDataObject>*>() : nullptr;
 
@@ -397,11 +476,9 @@ void GenericDataCollectionsTableModel::deleteRows(const QModelIndexList &list)
         }
         lastChanges->push(new ChangedObject<GenericDataObject>(row, -1, "", ChangedObjectBase::Delete, nullptr, oldData) );
       }
-      qDebug() << "Removing row "<< row;
-      beginRemoveRows(QModelIndex(), row, row);
-      m_table->removeRow(row);
-      endRemoveRows();
     }
+
+    removeRowsWithNotify(rows);
     if (m_isTracking)
     {
       m_changeTracker.push(lastChanges);
@@ -409,9 +486,238 @@ void GenericDataCollectionsTableModel::deleteRows(const QModelIndexList &list)
   }
 }
 
+void GenericDataCollectionsTableModel::removeRowsWithNotify(const QList<int>& rows)
+{
+  // Group the rows into contiguous ranges so that each range is one model notification.
+  QList<int> rangeStarts;
+  for (int i=0; i<rows.size(); ++i)
+  {
+    if (i == 0 || rows.at(i) != rows.at(i-1) + 1)
+    {
+      rangeStarts.append(i);
+    }
+  }
 
-bool GenericDataCollectionsTableModel::saveTrackedChanges(const QString& tableName, GenericDataCollection &data, QSqlDatabase &db, const DescribeSqlTables& schema)
+  // Too many separate notifications is slower than having the view start over.
+  const int maxRangeNotifications = 100;
+  qDebug() << "Removing" << rows.size() << "rows in" << rangeStarts.size() << "ranges";
+  if (rangeStarts.size() > maxRangeNotifications)
+  {
+    beginResetModel();
+    m_table->removeRows(rows);
+    endResetModel();
+  }
+  else
+  {
+    // Remove from the bottom up so that the row numbers in earlier ranges do not change.
+    for (int r=rangeStarts.size() - 1; r>=0; --r)
+    {
+      int start = rangeStarts.at(r);
+      int end = (r + 1 < rangeStarts.size()) ? rangeStarts.at(r + 1) : rows.size();
+      beginRemoveRows(QModelIndex(), rows.at(start), rows.at(end - 1));
+      m_table->removeRows(rows.mid(start, end - start));
+      endRemoveRows();
+    }
+  }
+}
+
+void GenericDataCollectionsTableModel::mergeRows(const QList<int>& keys, const QList<QList<QVariant> >& rows, const QList<int>& deletedIds)
+{
+  if (m_table == nullptr)
+  {
+    return;
+  }
+
+  QList<int> deletedRows;
+  for (int i=0; i<deletedIds.size(); ++i)
+  {
+    int row = m_table->getIndexOf(deletedIds.at(i));
+    if (row >= 0)
+    {
+      deletedRows.append(row);
+    }
+  }
+  if (!deletedRows.isEmpty())
+  {
+    std::sort(deletedRows.begin(), deletedRows.end());
+    removeRowsWithNotify(deletedRows);
+  }
+
+  // Changed rows stay where they are.
+  QList<int> newRows;
+  const int lastColumn = columnCount() - 1;
+  for (int i=0; i<keys.size(); ++i)
+  {
+    int row = m_table->getIndexOf(keys.at(i));
+    if (row < 0)
+    {
+      newRows.append(i);
+    }
+    else if (m_table->updateValues(keys.at(i), rows.at(i)))
+    {
+      emit dataChanged(index(row, 0), index(row, lastColumn));
+    }
+  }
+
+  // New rows are appended as a single block.
+  if (!newRows.isEmpty())
+  {
+    int first = m_table->rowCount();
+    beginInsertRows(QModelIndex(), first, first + newRows.size() - 1);
+    for (int i=0; i<newRows.size(); ++i)
+    {
+      m_table->appendValues(keys.at(newRows.at(i)), rows.at(newRows.at(i)));
+    }
+    endInsertRows();
+  }
+  qDebug() << "Merged" << deletedRows.size() << "deleted," << (keys.size() - newRows.size()) << "changed, and" << newRows.size() << "new rows";
+}
+
+
+void GenericDataCollectionsTableModel::invalidateLinkedTables(const QStringList& tableNames)
+{
+  // Follow the links back until no other table depends on a changed table.
+  QSet<QString> affected;
+  for (int i=0; i<tableNames.size(); ++i) {
+    affected.insert(tableNames.at(i).toLower());
+  }
+  const QStringList loadedTables = m_tables.getNames();
+  bool added = true;
+  while (added) {
+    added = false;
+    for (int i=0; i<loadedTables.size(); ++i) {
+      const QString lowerName = loadedTables.at(i).toLower();
+      const DescribeSqlTable* tableSchema = m_schemas.getTableByName(loadedTables.at(i));
+      if (affected.contains(lowerName) || tableSchema == nullptr) {
+        continue;
+      }
+      for (int j=0; j<tableSchema->getFieldCount(); ++j) {
+        const DescribeSqlField* field = tableSchema->getFieldByIndex(j);
+        if (field != nullptr && field->isLinkField() && affected.contains(field->getLinkTableName().toLower())) {
+          affected.insert(lowerName);
+          added = true;
+          break;
+        }
+      }
+    }
+  }
+
+  for (QSet<QString>::const_iterator it = affected.constBegin(); it != affected.constEnd(); ++it) {
+    m_linkCache.invalidateTable(*it);
+  }
+  if (rowCount() > 0 && columnCount() > 0) {
+    emit dataChanged(index(0, 0), index(rowCount() - 1, columnCount() - 1));
+  }
+}
+
+void GenericDataCollectionsTableModel::addMemoryUsage(MemoryUsage& usage) const
 {
+  m_tables.addMemoryUsage(usage);
+  usage.setComponent(tr("Link cache"));
+  m_linkCache.addMemoryUsage(usage);
+  usage.setComponent(tr("Change history"));
+  m_changeTracker.addMemoryUsage(usage);
+}
+
+void GenericDataCollectionsTableModel::coalesceTrackedChanges(QList<int>& insertIds, QList<int>& deleteIds, QMap<int, QStringList>& editedFields) const
+{
+  insertIds.clear();
+  deleteIds.clear();
+  editedFields.clear();
+  QSet<int> inserted;
+  QSet<int> deleted;
+
+  // The tracker is only read; it is cleared after the changes are committed.
+  for (int iChange=0; iChange<m_changeTracker.size(); ++iChange)
+  {
+    // Start at the bottom and work to the top so that the changes are seen in the order they were made.
+    const QStack<ChangedObject<GenericDataObject>*> * changes = m_changeTracker.value(iChange);
+    if (changes == nullptr)
+    {
+      continue;
+    }
+    for (int iObject=0; iObject<changes->size(); ++iObject)
+    {
+      const ChangedObject<GenericDataObject>* bottomObject = changes->at(iObject);
+      if (bottomObject == nullptr)
+      {
+        continue;
+      }
+      if (bottomObject->getChangeType() == ChangedObjectBase::Add)
+      {
+        GenericDataObject* newData = bottomObject->getNewData();
+        if (newData != nullptr)
+        {
+          // The INSERT uses the final values, so earlier edits do not matter.
+          // If the id was deleted first, the DELETE is still done before the INSERT.
+          int id = newData->getInt("id");
+          inserted.insert(id);
+          editedFields.remove(id);
+        }
+      }
+      else if (bottomObject->getChangeType() == ChangedObjectBase::Delete)
+      {
+        GenericDataObject* oldData = bottomObject->getOldData();
+        if (oldData != nullptr)
+        {
+          // A row that was added and then deleted was never written.
+          int id = oldData->getInt("id");
+          editedFields.remove(id);
+          if (!inserted.remove(id))
+          {
+            deleted.insert(id);
+          }
+        }
+      }
+      else if (bottomObject->getChangeType() == ChangedObjectBase::Edit)
+      {
+        // TODO: What if changed a key field referenced by another table.
+        // Info contains the modified field name!
+        GenericDataObject* oldData = bottomObject->getOldData();
+        int id = (oldData != nullptr) ? oldData->getInt("id") : -1;
+        if (oldData != nullptr && !inserted.contains(id))
+        {
+          QStringList& fields = editedFields[id];
+          if (!fields.contains(bottomObject->getChangeInfo(), Qt::CaseInsensitive))
+          {
+            fields << bottomObject->getChangeInfo();
+          }
+        }
+      }
+      else
+      {
+        qDebug("Unknown change type while saving");
+      }
+    }
+  }
+
+  insertIds = inserted.values();
+  std::sort(insertIds.begin(), insertIds.end());
+  deleteIds = deleted.values();
+  std::sort(deleteIds.begin(), deleteIds.end());
+}
+
+bool GenericDataCollectionsTableModel::execBatch(QSqlQuery* query, const QList<QVariantList>& values, QString& errorMessage)
+{
+  if (query == nullptr)
+  {
+    return false;
+  }
+  for (int i=0; i<values.size(); ++i)
+  {
+    query->bindValue(i, values.at(i));
+  }
+  if (!query->execBatch())
+  {
+    errorMessage = query->lastError().text();
+    return false;
+  }
+  return true;
+}
+
+bool GenericDataCollectionsTableModel::saveTrackedChanges(const QString& tableName, GenericDataCollection &data, QSqlDatabase &db, const DescribeSqlTables& schema, PreparedQueryCache& queryCache, QString& errorMessage)
+{
+  errorMessage.clear();
   qDebug() << "Enter GenericDataCollectionsTableModel::saveTrackedChanges";
   bool trackState = isTracking();
   setTracking(false);
@@ -425,151 +731,155 @@ bool GenericDataCollectionsTableModel::saveTrackedChanges(const QString& tableNa
 
   bool setUpdateField = (tableSchema != nullptr && tableSchema->containsField("updated"));
 
+  // Fold the history into one change per row; ten edits to a row become one UPDATE.
+  QList<int> insertIds;
+  QList<int> deleteIds;
+  QMap<int, QStringList> editedFields;
+  coalesceTrackedChanges(insertIds, deleteIds, editedFields);
+  qDebug() << "Saving" << insertIds.size() << "added," << deleteIds.size() << "deleted, and" << editedFields.size() << "edited rows";
+
   DBTransactionHandler transactionHandler(db);
 
-  while (!m_changeTracker.isEmpty() && !errorOccurred)
+  // Delete first so that an id that was deleted and then used for a new row can be inserted.
+  if (!deleteIds.isEmpty())
+  {
+    QVariantList ids;
+    for (int i=0; i<deleteIds.size(); ++i)
+    {
+      ids << deleteIds.at(i);
+    }
+    QSharedPointer<QSqlQuery> query = queryCache.prepare(db, QString("DELETE FROM %1 WHERE %2=?").arg(tableName, "id"), errorMessage);
+    if (!execBatch(query.data(), QList<QVariantList>() << ids, errorMessage))
+    {
+      qDebug() << "Failed to delete rows" << errorMessage;
+      errorOccurred = true;
+    }
+  }
+
+  if (!errorOccurred && !insertIds.isEmpty())
   {
-    // While persisting changes, start at the bottom and work to the top.
-    // Undo must start at the top and work to the bottom.
+    const int numColumns = data.getPropertNames().size();
+    QStringList placeholders;
+    for (int iCol=0; iCol<numColumns; ++iCol)
+    {
+      placeholders << "?";
+    }
+    QString sSQL = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(tableName, data.getPropertNames().join(", "), placeholders.join(", "));
 
-    QStack<ChangedObject<GenericDataObject>*> * firstChanges = m_changeTracker.takeAt(0);
-    if (firstChanges != nullptr)
+    // Final values for each new row, one list for each column.
+    QList<QVariantList> values(numColumns);
+    for (int i=0; i<insertIds.size(); ++i)
     {
-      while (!firstChanges->isEmpty()) {
-        ChangedObject<GenericDataObject>* bottomObject = firstChanges->takeFirst();
-        if (bottomObject != nullptr)
+      const GenericDataObject* newData = data.getObjectById(insertIds.at(i));
+      if (newData == nullptr)
+      {
+        qDebug() << "Added row" << insertIds.at(i) << "is no longer in the table";
+        continue;
+      }
+      for (int iCol=0; iCol<numColumns; ++iCol)
+      {
+        if (!newData->containsValue(data.getPropertyName(iCol)))
         {
-          if (bottomObject->getChangeType() == ChangedObjectBase::Add)
-          {
-            qDebug() << "Add record to the DB!";
-
-            GenericDataObject* newData = bottomObject->getNewData();
-            if (newData != nullptr)
-            {
-              QSqlQuery query(db);
-              QString s = QString("INSERT INTO %1 (").arg(tableName);
-              QString sValues = " VALUES (";
-              bool aFieldAdded = false;
-              for (int iCol=0; iCol<data.getPropertNames().size(); ++iCol)
-              {
-                if (aFieldAdded) {
-                  s = s.append(", ");
-                  sValues = sValues.append(", ");
-                }
-                s = s.append(data.getPropertyName(iCol));
-                sValues = sValues.append(":").append(data.getPropertyName(iCol));
-                aFieldAdded = true;
-              }
-              QString sSQL = s.append(") ").append(sValues).append(")");
-              query.prepare(sSQL);
-              for (int iCol=0; iCol<data.getPropertNames().size(); ++iCol)
-              {
-                if (!newData->containsValue(data.getPropertyName(iCol)))
-                {
-                    TypeMapper mapper;
-                    query.bindValue(QString(":%1").arg(data.getPropertyName(iCol)), QVariant(QMetaType((data.getPropertyTypeMeta(iCol)))));
-                } else {
-                    // Assume that it converts to the correct type!
-                    query.bindValue(QString(":%1").arg(data.getPropertyName(iCol)), newData->getValueNative(data.getPropertyName(iCol)));
-                }
-              }
-              if (!query.exec())
-              {
-                qDebug("Failed to add row");
-              }
-            }
-          }
-          else if (bottomObject->getChangeType() == ChangedObjectBase::Delete)
-          {
-            GenericDataObject* oldData = bottomObject->getOldData();
-            if (oldData != nullptr)
-            {
-              QSqlQuery query(db);
-              QString s = QString("DELETE FROM %1 WHERE %2=:id").arg(tableName, "id");
-              query.prepare(s);
-              query.bindValue(":id", oldData->getInt("id"));
-              if (!query.exec())
-              {
-                qDebug("Failed to delete row");
-              }
-            }
-          }
-          else if (bottomObject->getChangeType() == ChangedObjectBase::Edit)
+          values[iCol] << QVariant(QMetaType(data.getPropertyTypeMeta(iCol)));
+        } else {
+          // Assume that it converts to the correct type!
+          values[iCol] << newData->getValueNative(data.getPropertyName(iCol));
+        }
+      }
+    }
+    QSharedPointer<QSqlQuery> query = queryCache.prepare(db, sSQL, errorMessage);
+    if (!values.isEmpty() && !values.first().isEmpty() && !execBatch(query.data(), values, errorMessage))
+    {
+      qDebug() << "Failed to add rows" << errorMessage;
+      errorOccurred = true;
+    }
+  }
+
+  if (!errorOccurred && !editedFields.isEmpty())
+  {
+    QDateTime now = QDateTime::currentDateTime();
+
+    // Rows that changed the same fields share one UPDATE, which is run once with every row.
+    QMap<QString, QStringList> fieldsForGroup;
+    QMap<QString, QList<int> > idsForGroup;
+    for (QMap<int, QStringList>::const_iterator it = editedFields.constBegin(); it != editedFields.constEnd(); ++it)
+    {
+      QStringList fields = it.value();
+      // Do not force the updated field WHILE setting the updated field.
+      if (setUpdateField && !fields.contains("updated", Qt::CaseInsensitive))
+      {
+        fields << "updated";
+        GenericDataObject* currentObj = data.getObjectById(it.key());
+        if (currentObj != nullptr)
+        {
+          currentObj->setValueNative("updated", now);
+        }
+      }
+      QString groupKey = fields.join(",").toLower();
+      fieldsForGroup.insert(groupKey, fields);
+      idsForGroup[groupKey] << it.key();
+    }
+
+    for (QMap<QString, QStringList>::const_iterator it = fieldsForGroup.constBegin(); it != fieldsForGroup.constEnd() && !errorOccurred; ++it)
+    {
+      const QStringList& fields = it.value();
+      const QList<int>& ids = idsForGroup.value(it.key());
+      QStringList assignments;
+      for (int iField=0; iField<fields.size(); ++iField)
+      {
+        assignments << QString("%1=?").arg(fields.at(iField));
+      }
+      QString s = QString("UPDATE %1 SET %2 WHERE %3=?").arg(tableName, assignments.join(", "), "id");
+
+      // One list for each field, then the ids.
+      QList<QVariantList> values(fields.size() + 1);
+      for (int i=0; i<ids.size(); ++i)
+      {
+        const GenericDataObject* currentObj = data.getObjectById(ids.at(i));
+        for (int iField=0; iField<fields.size(); ++iField)
+        {
+          const QString& fieldName = fields.at(iField);
+          if (currentObj != nullptr && currentObj->containsValue(fieldName))
           {
-            // TODO: What if changed a key field referenced by another table.
-            QString fieldName = bottomObject->getChangeInfo();
-            qDebug() << "Edit record in the DB! where fieldName = " << fieldName;
-
-            // Info contains the modified field name!
-            GenericDataObject* oldData = bottomObject->getOldData();
-            GenericDataObject* newData = bottomObject->getNewData();
-            if (oldData != nullptr && newData != nullptr)
-            {
-              QSqlQuery query(db);
-              QString sWithUpdated    = QString("UPDATE %1 SET %2=:%2, updated=:updated WHERE %3=:id").arg(tableName, fieldName, "id");
-              QString sWithoutUpdated = QString("UPDATE %1 SET %2=:%2 WHERE %3=:id").arg(tableName, fieldName, "id");
-
-              // Do not force the updated field WHILE setting the updated field.
-              bool useWithoutUpdated = !setUpdateField || fieldName.compare("updated", Qt::CaseInsensitive) == 0;
-
-              QString s = useWithoutUpdated ? sWithoutUpdated : sWithUpdated;
-              query.prepare(s);
-              query.bindValue(":id", oldData->getInt("id"));
-              if (!useWithoutUpdated) {
-                QDateTime now = QDateTime::currentDateTime();
-                query.bindValue(":updated", now);
-                GenericDataObject* currentObj = data.getObjectById(newData->getInt("id"));
-                if (currentObj != nullptr)
-                {
-                  currentObj->setValueNative("updated", now);
-                }
-              }
-              qDebug() << "[" << oldData->getInt("id") << "] where id = " << s;
-
-              if (newData->containsValue(fieldName))
-              {
-                // Assume that it converts to the correct type!
-                // This should be the normal path. Why would the new data NOT contain the field?
-                query.bindValue(QString(":%1").arg(fieldName), newData->getValueNative(fieldName));
-              } else if (m_schema.containsField(fieldName)) {
-                // This still feels wrong, but it should work because at least we know about the field.
-                qDebug() << "Why are we trying to update field named: " << fieldName;
-                qDebug() << "The new data does not contain the field but the schema knows about it.";
-                TypeMapper mapper;
-                query.bindValue(QString(":%1").arg(fieldName), QVariant(QMetaType(data.getPropertyTypeMeta(fieldName))));
-              } else {
-                  qDebug() << "This is probably an error and will probably cause a core dump.";
-                  qDebug() << "Why are we trying to update field named: " << fieldName;
-                  TypeMapper mapper;
-                  query.bindValue(QString(":%1").arg(fieldName), QVariant(QMetaType(data.getPropertyTypeMeta(fieldName))));
-              }
-              if (!query.exec())
-              {
-                qDebug("Failed to update row");
-              }
-            }
+            // Assume that it converts to the correct type!
+            values[iField] << currentObj->getValueNative(fieldName);
           }
           else
           {
-            qDebug("Unknown change type in undo");
+            // The value was removed, or the row is gone, so write a null of the right type.
+            values[iField] << QVariant(QMetaType(data.getPropertyTypeMeta(fieldName)));
           }
-          delete bottomObject;
         }
+        values[fields.size()] << ids.at(i);
+      }
+      qDebug() << "Update" << ids.size() << "rows with" << s;
+
+      QSharedPointer<QSqlQuery> query = queryCache.prepare(db, s, errorMessage);
+      if (!execBatch(query.data(), values, errorMessage))
+      {
+        qDebug() << "Failed to update rows" << errorMessage;
+        errorOccurred = true;
       }
-      delete firstChanges;
     }
   }
-  m_changeTracker.clear();
+
   setTracking(trackState);
   if (errorOccurred)
   {
     transactionHandler.rollback();
   }
-  else
+  else if (!transactionHandler.commit())
   {
-    transactionHandler.commit();
+    errorMessage = db.lastError().text();
+    qDebug() << "Failed to commit the tracked changes for " << tableName << ": " << errorMessage;
+    errorOccurred = true;
   }
-  return errorOccurred;
+  // Nothing was written if the transaction failed, so the changes are kept to save again or undo.
+  if (!errorOccurred)
+  {
+    m_changeTracker.clear();
+  }
+  return !errorOccurred;
 }
 
 void GenericDataCollectionsTableModel::undoChange()
@@ -772,6 +1082,7 @@ QList<int> GenericDataCollectionsTableModel::duplicateRows(const QModelIndexList
 {
   QList<int> addedIds;
   qDebug() << "duplicateRows " << list.size();
+  fetchAll();
 
   // Will contain a sorted list or row numbers in the list.
   QList<int> rows;
@@ -821,7 +1132,7 @@ QList<int> GenericDataCollectionsTableModel::duplicateRows(const QModelIndexList
             qDebug() << "contains table catalog : " << m_tables.contains("catalog");
 
             // This does contain the table, but be paranoid!
-            const GenericDataCollection* cat_table = m_tables["catalog"];
+            GenericDataCollection* cat_table = m_tables["catalog"];
             const GenericDataObject* cat_object = (cat_table != nullptr)
                     ? cat_table->getObjectById(this_cat_id) : nullptr;
 
@@ -840,6 +1151,10 @@ QList<int> GenericDataCollectionsTableModel::duplicateRows(const QModelIndexList
                 values << scott << cat_object->getString("countryid") << cat_object->getString("typeid");
                 // There should be but one!
                 // Should I write a find first version to just get out?
+                // Index the Scott number so that duplicating many rows does not scan the catalog for each row.
+                if (!cat_table->hasIndex("scott")) {
+                    cat_table->createIndex("scott");
+                }
                 QList<const GenericDataObject*> list = cat_table->getMatchingValues(names, values, Qt::CaseSensitive);
                 if (list.count() != 1) {
                     qDebug() << "Warning, found more than one matching catalog entry for scott " << scott;
@@ -7,9 +7,11 @@
 #include "changetracker.h"
 // #include "linkedfieldcache.h"
 #include "linkedfieldselectioncache.h"
+#include "tablepagereader.h"
 
 #include <QDialog>
 #include <QAbstractTableModel>
+#include <QMap>
 
 class QTableView;
 class GenericDataCollectionTableModel;
@@ -19,6 +21,9 @@ class StampDB;
 class DescribeSqlTables;
 class GenericDataCollections;
 class QSqlDatabase;
+class MemoryUsage;
+class PreparedQueryCache;
+class QSqlQuery;
 
 
 //**************************************************************************
@@ -46,6 +51,33 @@ public:
    */
   explicit GenericDataCollectionsTableModel(const bool useLinks, const QString& tableName, GenericDataCollections& tables, DescribeSqlTables& schema, int defaultSourceId = -1, QObject *parent = nullptr);
 
+  /*! \brief Destructor deletes the page reader. */
+  ~GenericDataCollectionsTableModel();
+
+  //**************************************************************************
+  /*! \brief Set the reader used to load the rest of a table that was only partially read.
+   *
+   *  \param [in] reader Reader that this model now owns, may be nullptr if the table is complete.
+   ***************************************************************************/
+  void setPageReader(TablePageReader* reader);
+
+  //**************************************************************************
+  /*! \brief Returns true if there are more rows to read from the database.
+   *  \param [in] parent Parent item when using a tree type model.
+   ***************************************************************************/
+  bool canFetchMore(const QModelIndex &parent) const;
+
+  //**************************************************************************
+  /*! \brief Read the next page of rows from the database and append them to the table.
+   *  \param [in] parent Parent item when using a tree type model.
+   ***************************************************************************/
+  void fetchMore(const QModelIndex &parent);
+
+  //**************************************************************************
+  /*! \brief Read every remaining page. New IDs are based on the largest ID, so the whole table must be present before rows are added.
+   ***************************************************************************/
+  void fetchAll();
+
   //**************************************************************************
   /*! \brief Returns the flags used to describe the item identified by the index.
    *
@@ -125,8 +157,39 @@ public:
    ***************************************************************************/
   void getRowsAscending(const QModelIndexList &list, QList<int> &rows) const;
 
-  // Write tracked changes to the backing DB.
-  bool saveTrackedChanges(const QString& tableName, GenericDataCollection& data, QSqlDatabase& db, const DescribeSqlTables& schema);
+  //**************************************************************************
+  /*! \brief Merge rows read by StampDB::readTableChanges; views are told which rows changed rather than being reset.
+   *
+   *  Deleted rows are removed, changed rows are updated where they are, and new rows are appended.
+   *  Changes are not tracked, they came from the database.
+   *
+   *  \param [in] keys Key for each changed or new row.
+   *  \param [in] rows Values for each changed or new row in property order.
+   *  \param [in] deletedIds Keys of rows to remove.
+   ***************************************************************************/
+  void mergeRows(const QList<int>& keys, const QList<QList<QVariant> >& rows, const QList<int>& deletedIds);
+
+  //**************************************************************************
+  /*! \brief Linked tables changed, so drop the cached link values built from them and redraw.
+   *
+   *  A cached value from a table whose link fields point to a changed table is dropped as well,
+   *  because its display value may include text from the changed table.
+   *
+   *  \param [in] tableNames Linked tables that were read again.
+   ***************************************************************************/
+  void invalidateLinkedTables(const QStringList& tableNames);
+
+  //**************************************************************************
+  /*! \brief Add the memory used by the tables, the link cache, and the change history; each is a separate component.
+   *
+   *  \param [in, out] usage Receives the bytes.
+   ***************************************************************************/
+  void addMemoryUsage(MemoryUsage& usage) const;
+
+  // Write tracked changes to the backing DB. Statements come from the query cache so that each is only prepared once.
+  // Returns true if every change was written and committed; the tracker is only cleared then.
+  // On failure nothing is written, the changes are kept, and errorMessage says why.
+  bool saveTrackedChanges(const QString& tableName, GenericDataCollection& data, QSqlDatabase& db, const DescribeSqlTables& schema, PreparedQueryCache& queryCache, QString& errorMessage);
 
   //**************************************************************************
   /*! \brief Builds the display value such as "USA/123/Postal"
@@ -193,6 +256,31 @@ public slots:
   QList<int> duplicateRows(const QModelIndexList& list, const bool autoIncrement, const bool appendChar, const char charToAppend);
 
 private:
+  friend class TestAll;
+
+  /*! \brief Resolve the field handle and schema for every column so that data() does not look up names per cell. */
+  void resolveColumns() const;
+
+  /*! \brief Remove rows (ascending, no duplicates) from the table, notifying views once per contiguous range. */
+  void removeRowsWithNotify(const QList<int>& rows);
+
+  /*! \brief Reduce the change tracker to the smallest set of changes for each row; the tracker is not changed.
+   *
+   *  A row that is added and then edited is only inserted, a row that is added and then deleted is
+   *  not written, and every field edited in a row is written with one UPDATE. The final values are
+   *  taken from the table when the changes are saved.
+   *
+   *  \param [out] insertIds Rows to insert, ascending.
+   *  \param [out] deleteIds Rows to delete, ascending.
+   *  \param [out] editedFields Field names edited for each row that exists in the DB.
+   */
+  void coalesceTrackedChanges(QList<int>& insertIds, QList<int>& deleteIds, QMap<int, QStringList>& editedFields) const;
+
+  /*! \brief Bind a list of values to each positional placeholder and run the query once for each row.
+   *  \return True on success; on failure errorMessage is set.
+   */
+  bool execBatch(QSqlQuery* query, const QList<QVariantList>& values, QString& errorMessage);
+
   /*! The DescribeSqlTable object can be configured to list a field as linked to another table.
    * Setting this to true causes linked fields to be displayed as the linked value rather than as the key it is.
    */
@@ -219,6 +307,15 @@ private:
 
   /*! Used when editing the value table. When a value is updated, the "source" is set. */
   int m_defaultSourceId = -1;
+
+  /*! Reads the rest of the primary table if only the first page was read. Owned by this object. */
+  TablePageReader* m_pageReader = nullptr;
+
+  /*! Resolved field for each column of the primary table. */
+  mutable QList<FieldRef> m_columnRefs;
+
+  /*! Field schema for each column of the primary table. */
+  mutable QList<const DescribeSqlField*> m_columnSchemas;
 };
 
 inline int GenericDataCollectionsTableModel::getIndexOf(const int id) const
@@ -9,6 +9,9 @@
 #include "genericdatacollectionstableproxy.h"
 #include "genericdatacollectiontablesearchdialog.h"
 #include "globals.h"
+#include "scrollmessagebox.h"
+#include "memoryusage.h"
+#include "memoryusagedialog.h"
 
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -26,18 +29,20 @@
 #include <QDebug>
 #include <QScopedPointer>
 #include <QShortcut>
+#include <QTimer>
 
 GenericDataCollectionTableDialog::GenericDataCollectionTableDialog(const QString& tableName, GenericDataCollection &data, StampDB &db, DescribeSqlTables& schema, GenericDataCollections *tables, int defaultSourceId, QWidget *parent) :
   QDialog(parent),
   m_duplicateButton(nullptr), m_duplicateButtonIncrement(nullptr),
   m_duplicateButtonAppendLowerA(nullptr), m_duplicateButtonAppendUpperA(nullptr),
   m_addButton(nullptr), m_deleteButton(nullptr), m_undoButton(nullptr),
-  m_saveChangesButton(nullptr), m_searchButton(nullptr),
+  m_saveChangesButton(nullptr), m_searchButton(nullptr), m_refreshButton(nullptr),
   m_table(data), m_tables(tables), m_tableView(nullptr),
   m_tableName(tableName), m_tableModel(nullptr),m_searchWindow(nullptr),
   m_db(db), m_schema(schema), m_defaultSourceId(defaultSourceId)
 {
   buildDialog();
+  connect(&m_db, SIGNAL(tablesChanged(QStringList,QObject*)), this, SLOT(tablesChanged(QStringList,QObject*)));
 }
 
 GenericDataCollectionTableDialog::~GenericDataCollectionTableDialog()
@@ -55,6 +60,12 @@ void GenericDataCollectionTableDialog::buildDialog()
   Q_ASSERT_X(m_tables != nullptr, "GenericDataCollectionTableDialog::buildDialog()", "m_tables is null");
   m_tableModel = new GenericDataCollectionsTableModel(true, m_tableName, *m_tables, m_schema, m_defaultSourceId);
 
+  // A large table is read one page at a time (see MainWindow::editTable); read the rest while the dialog is in use.
+  if (m_table.getObjectCount() >= TablePageReader::DefaultPageSize) {
+    m_tableModel->setPageReader(new TablePageReader(m_db, m_tableName, m_table.getLargestId()));
+    QTimer::singleShot(0, this, SLOT(fetchMoreRows()));
+  }
+
   // I could use QSortFilterProxyModel(this), but I want to use a
   // "natural" sort, which recognizes numbers.
   // see http://qt-project.org/doc/qt-5/qsortfilterproxymodel.html
@@ -97,6 +108,9 @@ void GenericDataCollectionTableDialog::buildDialog()
   m_searchButton = new QPushButton(tr("Find"));
   connect(m_searchButton, SIGNAL(clicked()), this, SLOT(searchDialog()));
   hLayout->addWidget(m_searchButton);
+  m_refreshButton = new QPushButton(tr("Refresh"));
+  connect(m_refreshButton, SIGNAL(clicked()), this, SLOT(refreshRows()));
+  hLayout->addWidget(m_refreshButton);
   vLayout->addLayout(hLayout);
 
   hLayout = new QHBoxLayout();
@@ -169,6 +183,7 @@ void GenericDataCollectionTableDialog::buildDialog()
   connect(new QShortcut(tr("Ctrl+Shift+D"), this), SIGNAL(activated()), this, SLOT(copyCellFrom1Above()));
   connect(new QShortcut(tr("Ctrl+D"), this), SIGNAL(activated()), this, SLOT(copyCellFrom1Below()));
   connect(new QShortcut(tr("Ctrl+Z"), this), SIGNAL(activated()), this, SLOT(undoChange()));
+  connect(new QShortcut(tr("Ctrl+Shift+M"), this), SIGNAL(activated()), this, SLOT(showMemoryUsage()));
 
   connect(m_addButton, SIGNAL(clicked()), this, SLOT(addRow()));
   connect(m_deleteButton, SIGNAL(clicked()), this, SLOT(deleteRow()));
@@ -188,6 +203,40 @@ void GenericDataCollectionTableDialog::buildDialog()
   restoreState();
   connect(m_tableView->selectionModel(), SIGNAL(selectionChanged(const QItemSelection &, const QItemSelection &)), this, SLOT(selectionChanged(const QItemSelection &, const QItemSelection &)));
   enableButtons();
+  if (!m_tableModel->canFetchMore(QModelIndex())) {
+    logMemoryUsage();
+  }
+}
+
+void GenericDataCollectionTableDialog::fetchMoreRows()
+{
+  if (m_tableModel != nullptr && m_tableModel->canFetchMore(QModelIndex())) {
+    m_tableModel->fetchMore(QModelIndex());
+    QTimer::singleShot(0, this, SLOT(fetchMoreRows()));
+  } else if (m_tableModel != nullptr) {
+    // Add and duplicate wait for the last page.
+    enableButtons();
+    logMemoryUsage();
+  }
+}
+
+void GenericDataCollectionTableDialog::showMemoryUsage()
+{
+  MemoryUsage usage;
+  m_tableModel->addMemoryUsage(usage);
+  usage.log();
+  MemoryUsageDialog dlg(usage, this);
+  dlg.exec();
+}
+
+void GenericDataCollectionTableDialog::logMemoryUsage() const
+{
+  // Walking every value is not free, so only do it if someone is listening.
+  if (memoryUsageCategory().isDebugEnabled()) {
+    MemoryUsage usage;
+    m_tableModel->addMemoryUsage(usage);
+    usage.log();
+  }
 }
 
 void GenericDataCollectionTableDialog::selectionChanged( const QItemSelection & selected, const QItemSelection & deselected )
@@ -219,24 +268,30 @@ void GenericDataCollectionTableDialog::disableButtons()
     m_undoButton->setEnabled(false);
     m_saveChangesButton->setEnabled(false);
     m_searchButton->setEnabled(false);
+    m_refreshButton->setEnabled(false);
 }
 
 void GenericDataCollectionTableDialog::enableButtons()
 {
   bool somethingSelected = isRowSelected();
-  m_duplicateButton->setEnabled(somethingSelected);
-  m_duplicateButtonIncrement->setEnabled(somethingSelected);
-  m_duplicateButtonAppendLowerA->setEnabled(somethingSelected);
-  m_duplicateButtonAppendUpperA->setEnabled(somethingSelected);
-  m_addButton->setEnabled(true);
+  // New IDs follow the largest ID, which is not known until every row is read.
+  bool allRowsRead = !m_tableModel->canFetchMore(QModelIndex());
+  m_duplicateButton->setEnabled(somethingSelected && allRowsRead);
+  m_duplicateButtonIncrement->setEnabled(somethingSelected && allRowsRead);
+  m_duplicateButtonAppendLowerA->setEnabled(somethingSelected && allRowsRead);
+  m_duplicateButtonAppendUpperA->setEnabled(somethingSelected && allRowsRead);
+  m_addButton->setEnabled(allRowsRead);
   m_deleteButton->setEnabled(somethingSelected);
   m_undoButton->setEnabled(!m_tableModel->trackerIsEmpty());
   m_saveChangesButton->setEnabled(!m_tableModel->trackerIsEmpty());
   m_searchButton->setEnabled(true);
+  // Unsaved changes would be overwritten.
+  m_refreshButton->setEnabled(m_tableModel->trackerIsEmpty() && m_table.containsProperty("updated"));
 }
 
 void GenericDataCollectionTableDialog::addRow()
 {
+  reserveNewIds();
   m_tableModel->addRow();
   enableButtons();
 }
@@ -261,10 +316,147 @@ void GenericDataCollectionTableDialog::undoChange()
 void GenericDataCollectionTableDialog::saveChanges()
 {
   disableButtons();
-  m_tableModel->saveTrackedChanges(m_tableName, m_table, m_db.getDB(), m_schema);
+  QString errorMessage;
+  if (m_tableModel->saveTrackedChanges(m_tableName, m_table, m_db.getDB(), m_schema, m_db.getQueryCache(), errorMessage))
+  {
+    // Other windows that show this table, or link to it, are now out of date.
+    m_db.notifyTablesChanged(QStringList() << m_tableName, this);
+  }
+  else
+  {
+    // The changes are still tracked so they can be saved again or undone.
+    ScrollMessageBox::information(this, tr("ERROR"), tr("The changes to %1 were not saved.\n%2").arg(m_tableName, errorMessage));
+  }
+  enableButtons();
+}
+
+void GenericDataCollectionTableDialog::refreshRows()
+{
+  if (!m_tableModel->trackerIsEmpty())
+  {
+    ScrollMessageBox::information(this, tr("Refresh"), tr("Save or undo your changes before refreshing."));
+    return;
+  }
+  disableButtons();
+  reloadStaleLinkedTables();
+  // Rows not yet paged in would look like new rows.
+  m_tableModel->fetchAll();
+  if (!mergeTableChanges())
+  {
+    ScrollMessageBox::information(this, tr("Refresh"), tr("Table %1 cannot be refreshed, close and open it again.").arg(m_tableName));
+  }
   enableButtons();
 }
 
+bool GenericDataCollectionTableDialog::mergeTableChanges()
+{
+  QList<int> keys;
+  QList<QList<QVariant> > rows;
+  QList<int> deletedIds;
+  if (!m_db.readTableChanges(m_tableName, m_table, keys, rows, deletedIds))
+  {
+    return false;
+  }
+  m_tableModel->mergeRows(keys, rows, deletedIds);
+  return true;
+}
+
+void GenericDataCollectionTableDialog::tablesChanged(const QStringList& tableNames, QObject* source)
+{
+  if (source == this)
+  {
+    return;
+  }
+
+  // A poll may repeat every second, so it must not read whole tables.
+  const bool fromMonitor = (source != nullptr && source == m_db.getChangeMonitor());
+  QStringList changedTables;
+  bool primaryChanged = false;
+  for (int i=0; i<tableNames.size(); ++i)
+  {
+    if (tableNames.at(i).compare(m_tableName, Qt::CaseInsensitive) == 0)
+    {
+      primaryChanged = true;
+    }
+    else if (m_tables->contains(tableNames.at(i)))
+    {
+      // Linked tables are not edited here, so they can be replaced.
+      GenericDataCollection* linkedTable = m_tables->getTable(tableNames.at(i));
+      if (fromMonitor ? m_db.refreshTable(tableNames.at(i), *linkedTable) : m_db.reloadTable(tableNames.at(i), *linkedTable))
+      {
+        changedTables << tableNames.at(i);
+        m_staleLinkedTables.removeAll(tableNames.at(i));
+      }
+      else if (fromMonitor)
+      {
+        if (!m_staleLinkedTables.contains(tableNames.at(i)))
+        {
+          m_staleLinkedTables << tableNames.at(i);
+        }
+      }
+      else
+      {
+        qDebug() << "Failed to reload linked table " << tableNames.at(i);
+      }
+    }
+  }
+
+  if (primaryChanged)
+  {
+    // Merging would lose unsaved changes, and rows not yet read are read from the database anyway.
+    if (!m_tableModel->trackerIsEmpty() || m_tableModel->canFetchMore(QModelIndex()))
+    {
+      qDebug() << "Table " << m_tableName << " changed in the database; it is refreshed once the changes are saved and every row is read";
+    }
+    else if (mergeTableChanges())
+    {
+      // The table may link to itself.
+      changedTables << m_tableName;
+    }
+    else
+    {
+      qDebug() << "Table " << m_tableName << " changed in the database and cannot be refreshed";
+    }
+  }
+
+  if (!changedTables.isEmpty())
+  {
+    m_tableModel->invalidateLinkedTables(changedTables);
+  }
+}
+
+void GenericDataCollectionTableDialog::reloadStaleLinkedTables()
+{
+  if (!m_staleLinkedTables.isEmpty())
+  {
+    QStringList staleTables = m_staleLinkedTables;
+    m_staleLinkedTables.clear();
+    tablesChanged(staleTables, nullptr);
+  }
+}
+
+void GenericDataCollectionTableDialog::changeEvent(QEvent* evt)
+{
+  QDialog::changeEvent(evt);
+  if (evt->type() == QEvent::ActivationChange && isActiveWindow())
+  {
+    reloadStaleLinkedTables();
+  }
+}
+
+void GenericDataCollectionTableDialog::reserveNewIds()
+{
+  // Rows that were not read (a failed page) or that another connection added must not be reused.
+  if (m_table.containsProperty("id"))
+  {
+    int maxId = m_db.getMaxId(m_tableName);
+    if (maxId > m_table.getLargestId())
+    {
+      m_table.setLargestId(maxId);
+    }
+  }
+}
+
 void GenericDataCollectionTableDialog::duplicateRow()
 {
   // autoIncrement
@@ -333,6 +525,7 @@ void GenericDataCollectionTableDialog::privateRowDuplicator(const bool autoIncre
   for (int i=0; i<proxyList.size(); ++i) {
     mappedList.append(m_proxyModel->mapToSource(proxyList.at(i)));
   }
+  reserveNewIds();
   QList<int> addedIds = m_tableModel->duplicateRows(mappedList, autoIncrement, appendChar, charToAppend);
   if (!addedIds.isEmpty())
   {
@@ -361,7 +554,7 @@ void GenericDataCollectionTableDialog::selectCell(const QModelIndex& index)
 
 void GenericDataCollectionTableDialog::displayHelp()
 {
-  QMessageBox::about(this, "Supported Keys", "F1 - Help\nF2 - Edit cell\nF3 - Find Next\nShift+F3 - Find Previous\nF10 - Increment current cell\nShift+F10 - Decrement current cell\nCtrl+n - Copy one cell from n above\nAlt+n - Copy n cells from above\nShift+Ctrl+n - Copy one cell from n below\nAlt+Shift+n - Copy n cells from below\nCtrl+D - Copy value from column above\nCtrl+d - Copy value from column below\nESC - Cancel");
+  QMessageBox::about(this, "Supported Keys", "F1 - Help\nF2 - Edit cell\nF3 - Find Next\nShift+F3 - Find Previous\nF10 - Increment current cell\nShift+F10 - Decrement current cell\nCtrl+n - Copy one cell from n above\nAlt+n - Copy n cells from above\nShift+Ctrl+n - Copy one cell from n below\nAlt+Shift+n - Copy n cells from below\nCtrl+D - Copy value from column above\nCtrl+d - Copy value from column below\nCtrl+Shift+M - Memory usage\nESC - Cancel");
 }
 
 void GenericDataCollectionTableDialog::restoreState()
@@ -647,6 +840,13 @@ bool GenericDataCollectionTableDialog::genericSearch(const bool findNext, const
       return false;
     }
 
+    QModelIndex matchIndex;
+    if (fullTextFind(options, m_tableView->currentIndex(), false, matchIndex))
+    {
+      selectCell(matchIndex);
+      return matchIndex.isValid();
+    }
+
     qDebug() << "Search from row " << currentRow << " col " << currentColumn;
     QModelIndex startIndex = m_proxyModel->index(currentRow, currentColumn);
     QModelIndexList list = m_proxyModel->search(startIndex, options);
@@ -668,6 +868,13 @@ bool GenericDataCollectionTableDialog::genericSearch(const bool findNext, const
 
 bool GenericDataCollectionTableDialog::doFind(const SearchOptions& options, const bool includeCurrent)
 {
+  QModelIndex matchIndex;
+  if (fullTextFind(options, m_tableView->currentIndex(), includeCurrent, matchIndex))
+  {
+    selectCell(matchIndex);
+    return matchIndex.isValid();
+  }
+
   if (includeCurrent)
   {
     QModelIndexList list = m_proxyModel->search(m_tableView->currentIndex(), options);
@@ -703,6 +910,63 @@ bool GenericDataCollectionTableDialog::doFind(const SearchOptions& options, cons
 }
 
 
+bool GenericDataCollectionTableDialog::fullTextFind(const SearchOptions& options, const QModelIndex& startIndex, const bool includeStart, QModelIndex& matchIndex)
+{
+  matchIndex = QModelIndex();
+  if (!startIndex.isValid() || options.isAllColumns() || !options.isMatchAsString() || !options.isContains() || options.isCaseSensitive() || options.isReplace() || !m_tableModel->trackerIsEmpty())
+  {
+    return false;
+  }
+  const int column = m_proxyModel->mapToSource(startIndex).column();
+  const QString fieldName = m_table.getPropertyName(column);
+  if (!m_db.hasFullTextIndex(m_tableName, fieldName))
+  {
+    return false;
+  }
+
+  QList<int> ids;
+  QString errorMessage;
+  if (!m_db.searchText(m_tableName, options.getFindValue(), ids, errorMessage, QStringList() << fieldName))
+  {
+    if (!errorMessage.isEmpty())
+    {
+      qDebug() << "Full text search failed: " << errorMessage;
+    }
+    return false;
+  }
+
+  // The matching row closest to the start in the search direction, wrapping at the end.
+  const int numRows = m_proxyModel->rowCount();
+  const int startRow = startIndex.row();
+  int bestDistance = numRows + 1;
+  for (int i=0; i<ids.size(); ++i)
+  {
+    // Rows that are not read yet or are filtered out are skipped, as they are by a search of the cells.
+    int row = m_tableModel->getIndexOf(ids.at(i));
+    if (row < 0)
+    {
+      continue;
+    }
+    QModelIndex proxyIndex = m_proxyModel->mapFromSource(m_tableModel->index(row, column));
+    if (!proxyIndex.isValid())
+    {
+      continue;
+    }
+    int distance = options.isBackwards() ? (startRow - proxyIndex.row() + numRows) % numRows : (proxyIndex.row() - startRow + numRows) % numRows;
+    if (distance == 0 && !includeStart)
+    {
+      distance = numRows;
+    }
+    if (distance < bestDistance)
+    {
+      bestDistance = distance;
+      matchIndex = proxyIndex;
+    }
+  }
+  qDebug() << "Full text search found " << ids.size() << " rows";
+  return true;
+}
+
 void GenericDataCollectionTableDialog::searchDialog()
 {
   genericSearch(false, false, true);
@@ -109,6 +109,24 @@ public slots:
   void saveChanges();
   void searchDialog();
 
+  /*! \brief Merge rows changed in the database since the table was read. */
+  void refreshRows();
+
+  /*! \brief Bring the table and its linked tables up to date after the database changed.
+   *
+   *  Linked tables are read again and their cached link values are dropped. The primary table
+   *  is merged as with refreshRows, but only if there are no unsaved changes and every row is read;
+   *  otherwise it is left for the user to refresh.
+   *
+   *  A change found by the StampDB change monitor only uses refreshTable; a linked table that
+   *  cannot be refreshed that way is read again when this window is next activated or refreshed,
+   *  so that polling never reads whole tables.
+   *
+   *  \param [in] tableNames Tables that changed.
+   *  \param [in] source Object that made the change; a change made by this dialog is ignored.
+   */
+  void tablesChanged(const QStringList& tableNames, QObject* source);
+
   // Copy 1 cell from n above
   void copyCellFrom1Above();
   void copyCellFrom2Above();
@@ -166,14 +184,26 @@ public slots:
   /*! \brief Verify cancel with unsaved changes. */
   void clickedCancel();
 
+  /*! \brief Read the next page of a partially read table and schedule the next read so the dialog stays responsive. */
+  void fetchMoreRows();
+
+  /*! \brief Show the memory used by the tables, link cache, and change history. */
+  void showMemoryUsage();
+
 protected:
   /*! \brief Handle special key press events such as F3 (find next) */
   virtual void keyPressEvent(QKeyEvent* evt);
 
+  /*! \brief Read the linked tables that went stale while this window was not active. */
+  virtual void changeEvent(QEvent* evt);
+
 private:
 
   void privateRowDuplicator(const bool autoIncrement, const bool appendChar=false, const char charToAppend='a');
 
+  /*! \brief Make sure that new IDs are larger than every ID in the database, not only the rows that were read. */
+  void reserveNewIds();
+
   /*! \brief Copy cell from the same column to the current row.
    *
    * Each row copied (one cell) creates one undo operation.
@@ -201,6 +231,9 @@ private:
   /*! \brief Enable/disable buttons based on dialog values. */
   void enableButtons();
 
+  /*! \brief Write the memory usage to the debug log if the memory usage logging category is enabled. */
+  void logMemoryUsage() const;
+
   /*! \brief disable ALL buttons. */
   void disableButtons();
 
@@ -209,6 +242,27 @@ private:
 
   void selectCell(const QModelIndex& index);
 
+  /*! \brief Read the rows changed in the database since the table was read and merge them into the model.
+   *  \return False if the table cannot be refreshed this way.
+   */
+  bool mergeTableChanges();
+
+  /*! \brief Read again the linked tables that the change monitor could not refresh. */
+  void reloadStaleLinkedTables();
+
+  /*! \brief Find the next (or previous) matching row with the full text index rather than reading every cell.
+   *
+   *  Only used for a case insensitive "contains" search of one column with a full text index,
+   *  and only if there are no unsaved changes, because that is what the index can answer.
+   *
+   *  \param [in] options Search options used to direct the search.
+   *  \param [in] startIndex The search starts in the row after this one, or before it if searching backwards.
+   *  \param [in] includeStart If true, the start row is checked first rather than last.
+   *  \param [out] matchIndex Matching cell, or an invalid index if nothing matches.
+   *  \return True if the index was used, in which case matchIndex is the answer.
+   */
+  bool fullTextFind(const SearchOptions& options, const QModelIndex& startIndex, const bool includeStart, QModelIndex& matchIndex);
+
   virtual void displayHelp();
 
   /*! \brief Copy the selected rows */
@@ -225,6 +279,8 @@ private:
   /*! \brief Persist pending changes to the DB */
   QPushButton* m_saveChangesButton;
   QPushButton* m_searchButton;
+  /*! \brief Read rows changed elsewhere since the table was read */
+  QPushButton* m_refreshButton;
 
   /*! \brief Identifies the columns and the types. */
   GenericDataCollection& m_table;
@@ -253,6 +309,9 @@ private:
 
   /*! \brief Used only if it is relevant because the bookvalue field was updated. So only used for a single table listing what a stamp is worth. */
   int m_defaultSourceId = -1;
+
+  /*! \brief Linked tables that changed in the database, but are not yet read again. */
+  QStringList m_staleLinkedTables;
 };
 
 
@@ -48,6 +48,7 @@ QVariant GenericDataCollectionTableModel::data( const QModelIndex &index, int ro
   if (object != nullptr)
   {
     QString fieldName = m_collection.getPropertyName(index.column());
+    const FieldRef ref = m_collection.resolve(index.column());
     if (role == Qt::DisplayRole)
     {
       if (fieldName.compare("paid", Qt::CaseInsensitive) == 0 ||
@@ -56,13 +57,13 @@ QVariant GenericDataCollectionTableModel::data( const QModelIndex &index, int ro
       {
         // TODO: For a face value, can potentially use a better locale for non-US stamps.
         QLocale locale;
-        return locale.toCurrencyString(object->getValueNative(fieldName).toDouble());
+        return locale.toCurrencyString(object->get(ref).toDouble());
       }
     }
 
     if (role == Qt::DisplayRole || role == Qt::EditRole)
     {
-      return object->getValue(m_collection.getPropertyName(index.column()));
+      return object->get(ref);
     }
   }
   return QVariant();
@@ -0,0 +1,708 @@
+#include "genericdatacolumn.h"
+#include "memoryusage.h"
+
+#include <QDataStream>
+
+GenericDataColumn::GenericDataColumn(const QMetaType::Type columnType, const int slotCount) :
+  m_metaType(columnType), m_kind(storageKindForType(columnType)), m_maxDistinct(DefaultMaxDistinct)
+{
+  resize(slotCount);
+}
+
+GenericDataColumn::StorageKind GenericDataColumn::storageKindForType(const QMetaType::Type columnType)
+{
+  switch (columnType)
+  {
+  case QMetaType::Bool :
+  case QMetaType::Int :
+  case QMetaType::UInt :
+  case QMetaType::LongLong :
+    return IntegerStorage;
+  case QMetaType::Double :
+    return DoubleStorage;
+  case QMetaType::QString :
+    return StringStorage;
+  case QMetaType::QDate :
+    return DateStorage;
+  case QMetaType::QDateTime :
+    return DateTimeStorage;
+  case QMetaType::QTime :
+    return TimeStorage;
+  default:
+    break;
+  }
+  return VariantStorage;
+}
+
+void GenericDataColumn::resize(const int slotCount)
+{
+  if (m_kind == DictionaryStorage)
+  {
+    // Slots that go away no longer use their codes.
+    for (int slot=qMax(0, slotCount); slot<m_codes.size(); ++slot)
+    {
+      releaseCode(slot);
+    }
+  }
+  m_present.resize(slotCount);
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    m_integers.resize(slotCount);
+    break;
+  case DoubleStorage :
+    m_doubles.resize(slotCount);
+    break;
+  case StringStorage :
+    m_strings.resize(slotCount);
+    break;
+  case DateStorage :
+    m_dates.resize(slotCount);
+    break;
+  case DateTimeStorage :
+    m_dateTimes.resize(slotCount);
+    break;
+  case TimeStorage :
+    m_times.resize(slotCount);
+    break;
+  case VariantStorage :
+    m_variants.resize(slotCount);
+    break;
+  case DictionaryStorage :
+    m_codes.resize(slotCount, -1);
+    break;
+  }
+}
+
+void GenericDataColumn::reserve(const int slotCount)
+{
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    m_integers.reserve(slotCount);
+    break;
+  case DoubleStorage :
+    m_doubles.reserve(slotCount);
+    break;
+  case StringStorage :
+    m_strings.reserve(slotCount);
+    break;
+  case DateStorage :
+    m_dates.reserve(slotCount);
+    break;
+  case DateTimeStorage :
+    m_dateTimes.reserve(slotCount);
+    break;
+  case TimeStorage :
+    m_times.reserve(slotCount);
+    break;
+  case VariantStorage :
+    m_variants.reserve(slotCount);
+    break;
+  case DictionaryStorage :
+    m_codes.reserve(slotCount);
+    break;
+  }
+}
+
+QVariant GenericDataColumn::value(const int slot) const
+{
+  if (!m_present.testBit(slot))
+  {
+    return QVariant();
+  }
+  if (!m_overflow.isEmpty())
+  {
+    QHash<int, QVariant>::const_iterator it = m_overflow.constFind(slot);
+    if (it != m_overflow.constEnd())
+    {
+      return it.value();
+    }
+  }
+
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    switch (m_metaType)
+    {
+    case QMetaType::Bool :
+      return QVariant(m_integers.at(slot) != 0);
+    case QMetaType::Int :
+      return QVariant(static_cast<int>(m_integers.at(slot)));
+    case QMetaType::UInt :
+      return QVariant(static_cast<uint>(m_integers.at(slot)));
+    default:
+      return QVariant(static_cast<qlonglong>(m_integers.at(slot)));
+    }
+  case DoubleStorage :
+    return QVariant(m_doubles.at(slot));
+  case StringStorage :
+    return QVariant(m_strings.at(slot));
+  case DateStorage :
+    return QVariant(m_dates.at(slot));
+  case DateTimeStorage :
+    return QVariant(m_dateTimes.at(slot));
+  case TimeStorage :
+    return QVariant(m_times.at(slot));
+  case DictionaryStorage :
+    return QVariant(m_dictionary.at(m_codes.at(slot)));
+  case VariantStorage :
+    break;
+  }
+  return m_variants.at(slot);
+}
+
+QString GenericDataColumn::toString(const int slot) const
+{
+  if (!m_present.testBit(slot))
+  {
+    return "";
+  }
+  if (!m_overflow.isEmpty() && m_overflow.contains(slot))
+  {
+    return m_overflow.value(slot).toString();
+  }
+  if (m_kind == StringStorage)
+  {
+    return m_strings.at(slot);
+  }
+  if (m_kind == DictionaryStorage)
+  {
+    return m_dictionary.at(m_codes.at(slot));
+  }
+  if (m_kind == IntegerStorage && m_metaType != QMetaType::Bool)
+  {
+    return QString::number(m_integers.at(slot));
+  }
+  return value(slot).toString();
+}
+
+void GenericDataColumn::setValue(const int slot, const QVariant& value)
+{
+  m_present.setBit(slot);
+  if (m_kind == VariantStorage)
+  {
+    m_variants[slot] = value;
+    return;
+  }
+
+  if (value.metaType().id() != m_metaType)
+  {
+    // Store it exactly as it was provided.
+    clearTypedValue(slot);
+    m_overflow.insert(slot, value);
+    return;
+  }
+
+  if (!m_overflow.isEmpty())
+  {
+    m_overflow.remove(slot);
+  }
+
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    m_integers[slot] = (m_metaType == QMetaType::Bool) ? (value.toBool() ? 1 : 0) : value.toLongLong();
+    break;
+  case DoubleStorage :
+    m_doubles[slot] = value.toDouble();
+    break;
+  case StringStorage :
+    m_strings[slot] = value.toString();
+    break;
+  case DateStorage :
+    m_dates[slot] = value.toDate();
+    break;
+  case DateTimeStorage :
+    m_dateTimes[slot] = value.toDateTime();
+    break;
+  case TimeStorage :
+    m_times[slot] = value.toTime();
+    break;
+  case DictionaryStorage :
+    // Released first so that replacing the only use of a value does not count against the limit.
+    releaseCode(slot);
+    if (m_maxDistinct > 0 && getDictionaryCount() >= m_maxDistinct && !m_dictionaryCodes.contains(value.toString()))
+    {
+      // Too many distinct values to be worth encoding.
+      decodeDictionary();
+      m_strings[slot] = value.toString();
+    }
+    else
+    {
+      int code = dictionaryCodeFor(value.toString());
+      m_codes[slot] = code;
+      ++m_codeCounts[code];
+    }
+    break;
+  case VariantStorage :
+    break;
+  }
+}
+
+void GenericDataColumn::removeValue(const int slot)
+{
+  m_present.clearBit(slot);
+  if (!m_overflow.isEmpty())
+  {
+    m_overflow.remove(slot);
+  }
+  clearTypedValue(slot);
+}
+
+void GenericDataColumn::clearTypedValue(const int slot)
+{
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    m_integers[slot] = 0;
+    break;
+  case DoubleStorage :
+    m_doubles[slot] = 0.0;
+    break;
+  case StringStorage :
+    m_strings[slot] = QString();
+    break;
+  case DateStorage :
+    m_dates[slot] = QDate();
+    break;
+  case DateTimeStorage :
+    m_dateTimes[slot] = QDateTime();
+    break;
+  case TimeStorage :
+    m_times[slot] = QTime();
+    break;
+  case VariantStorage :
+    m_variants[slot] = QVariant();
+    break;
+  case DictionaryStorage :
+    releaseCode(slot);
+    break;
+  }
+}
+
+void GenericDataColumn::moveSlot(const int from, const int to)
+{
+  if (from == to)
+  {
+    return;
+  }
+  m_present.setBit(to, m_present.testBit(from));
+  if (!m_overflow.isEmpty())
+  {
+    m_overflow.remove(to);
+    if (m_overflow.contains(from))
+    {
+      m_overflow.insert(to, m_overflow.value(from));
+    }
+  }
+
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    m_integers[to] = m_integers.at(from);
+    break;
+  case DoubleStorage :
+    m_doubles[to] = m_doubles.at(from);
+    break;
+  case StringStorage :
+    m_strings[to] = m_strings.at(from);
+    break;
+  case DateStorage :
+    m_dates[to] = m_dates.at(from);
+    break;
+  case DateTimeStorage :
+    m_dateTimes[to] = m_dateTimes.at(from);
+    break;
+  case TimeStorage :
+    m_times[to] = m_times.at(from);
+    break;
+  case VariantStorage :
+    m_variants[to] = m_variants.at(from);
+    break;
+  case DictionaryStorage :
+    releaseCode(to);
+    m_codes[to] = m_codes.at(from);
+    if (m_codes.at(to) >= 0)
+    {
+      ++m_codeCounts[m_codes.at(to)];
+    }
+    break;
+  }
+}
+
+void GenericDataColumn::removeLast()
+{
+  int n = size() - 1;
+  if (n < 0)
+  {
+    return;
+  }
+  if (!m_overflow.isEmpty())
+  {
+    m_overflow.remove(n);
+  }
+  resize(n);
+}
+
+int GenericDataColumn::dictionaryCodeFor(const QString& value)
+{
+  QHash<QString, int>::const_iterator it = m_dictionaryCodes.constFind(value);
+  if (it != m_dictionaryCodes.constEnd())
+  {
+    return it.value();
+  }
+  int code = m_dictionary.size();
+  if (!m_freeCodes.isEmpty())
+  {
+    code = m_freeCodes.takeLast();
+    m_dictionary[code] = value;
+    m_codeCounts[code] = 0;
+  }
+  else
+  {
+    m_dictionary.append(value);
+    m_codeCounts.append(0);
+  }
+  m_dictionaryCodes.insert(value, code);
+  return code;
+}
+
+void GenericDataColumn::releaseCode(const int slot)
+{
+  int code = m_codes.at(slot);
+  if (code < 0)
+  {
+    return;
+  }
+  m_codes[slot] = -1;
+  if (--m_codeCounts[code] == 0)
+  {
+    m_dictionaryCodes.remove(m_dictionary.at(code));
+    m_dictionary[code] = QString();
+    m_freeCodes.append(code);
+  }
+}
+
+void GenericDataColumn::rebuildCodeCounts()
+{
+  m_codeCounts = QList<int>(m_dictionary.size(), 0);
+  m_freeCodes.clear();
+  m_dictionaryCodes.clear();
+  m_dictionaryCodes.reserve(m_dictionary.size());
+  for (int slot=0; slot<m_codes.size(); ++slot)
+  {
+    if (m_codes.at(slot) >= 0)
+    {
+      ++m_codeCounts[m_codes.at(slot)];
+    }
+  }
+  for (int code=0; code<m_dictionary.size(); ++code)
+  {
+    if (m_codeCounts.at(code) == 0)
+    {
+      m_dictionary[code] = QString();
+      m_freeCodes.append(code);
+    }
+    else
+    {
+      m_dictionaryCodes.insert(m_dictionary.at(code), code);
+    }
+  }
+}
+
+bool GenericDataColumn::encodeAsDictionary(const int maxDistinct)
+{
+  if (m_kind != StringStorage)
+  {
+    return m_kind == DictionaryStorage;
+  }
+
+  ChunkedList<qint32> codes(size(), -1);
+  QStringList dictionary;
+  QHash<QString, int> dictionaryCodes;
+  int numValues = 0;
+  for (int slot=0; slot<size(); ++slot)
+  {
+    if (!m_present.testBit(slot) || (!m_overflow.isEmpty() && m_overflow.contains(slot)))
+    {
+      continue;
+    }
+    ++numValues;
+    const QString& s = m_strings.at(slot);
+    QHash<QString, int>::const_iterator it = dictionaryCodes.constFind(s);
+    if (it != dictionaryCodes.constEnd())
+    {
+      codes[slot] = it.value();
+    }
+    else
+    {
+      if (dictionary.size() >= maxDistinct)
+      {
+        return false;
+      }
+      codes[slot] = dictionary.size();
+      dictionaryCodes.insert(s, dictionary.size());
+      dictionary.append(s);
+    }
+  }
+
+  // Not worth it unless the values repeat.
+  if (numValues == 0 || dictionary.size() * 4 > numValues)
+  {
+    return false;
+  }
+
+  m_kind = DictionaryStorage;
+  m_maxDistinct = maxDistinct;
+  m_codes = codes;
+  m_dictionary = dictionary;
+  m_strings.clear();
+  rebuildCodeCounts();
+  return true;
+}
+
+void GenericDataColumn::writeBinary(QDataStream& stream) const
+{
+  stream << static_cast<qint32>(m_kind) << m_present;
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    stream << m_integers;
+    break;
+  case DoubleStorage :
+    stream << m_doubles;
+    break;
+  case StringStorage :
+    stream << m_strings;
+    break;
+  case DateStorage :
+    stream << m_dates;
+    break;
+  case DateTimeStorage :
+    stream << m_dateTimes;
+    break;
+  case TimeStorage :
+    stream << m_times;
+    break;
+  case VariantStorage :
+    stream << m_variants;
+    break;
+  case DictionaryStorage :
+    stream << m_codes << m_dictionary;
+    break;
+  }
+  stream << m_overflow;
+}
+
+bool GenericDataColumn::readBinary(QDataStream& stream)
+{
+  qint32 kind = 0;
+  stream >> kind >> m_present;
+  const StorageKind typeKind = storageKindForType(m_metaType);
+  if (stream.status() != QDataStream::Ok || (kind != typeKind && !(kind == DictionaryStorage && typeKind == StringStorage)))
+  {
+    return false;
+  }
+  m_kind = static_cast<StorageKind>(kind);
+  int numValues = -1;
+  switch (m_kind)
+  {
+  case IntegerStorage :
+    stream >> m_integers;
+    numValues = m_integers.size();
+    break;
+  case DoubleStorage :
+    stream >> m_doubles;
+    numValues = m_doubles.size();
+    break;
+  case StringStorage :
+    stream >> m_strings;
+    numValues = m_strings.size();
+    break;
+  case DateStorage :
+    stream >> m_dates;
+    numValues = m_dates.size();
+    break;
+  case DateTimeStorage :
+    stream >> m_dateTimes;
+    numValues = m_dateTimes.size();
+    break;
+  case TimeStorage :
+    stream >> m_times;
+    numValues = m_times.size();
+    break;
+  case VariantStorage :
+    stream >> m_variants;
+    numValues = m_variants.size();
+    break;
+  case DictionaryStorage :
+    m_strings.clear();
+    stream >> m_codes >> m_dictionary;
+    numValues = m_codes.size();
+    break;
+  }
+  stream >> m_overflow;
+  if (stream.status() != QDataStream::Ok || numValues != m_present.size())
+  {
+    return false;
+  }
+
+  if (m_kind == DictionaryStorage)
+  {
+    // A code outside of the dictionary would be read past the end of the list.
+    for (int slot=0; slot<m_codes.size(); ++slot)
+    {
+      if (m_codes.at(slot) >= m_dictionary.size() || (m_codes.at(slot) < 0 && m_present.testBit(slot) && !m_overflow.contains(slot)))
+      {
+        return false;
+      }
+    }
+    // The limit is not in the stream; the default keeps edits from growing the dictionary without bound.
+    m_maxDistinct = (m_dictionary.size() > DefaultMaxDistinct) ? m_dictionary.size() : DefaultMaxDistinct;
+    rebuildCodeCounts();
+  }
+  return true;
+}
+
+bool GenericDataColumn::beginDictionary(const int maxDistinct)
+{
+  if (m_kind != StringStorage || size() > 0 || maxDistinct <= 0)
+  {
+    return m_kind == DictionaryStorage;
+  }
+  m_kind = DictionaryStorage;
+  m_maxDistinct = maxDistinct;
+  m_codes.clear();
+  m_dictionary.clear();
+  m_dictionaryCodes.clear();
+  m_codeCounts.clear();
+  m_freeCodes.clear();
+  return true;
+}
+
+bool GenericDataColumn::finishDictionary()
+{
+  if (m_kind != DictionaryStorage)
+  {
+    return false;
+  }
+
+  // Same rule as encodeAsDictionary; not worth it unless the values repeat.
+  int numValues = 0;
+  for (int slot=0; slot<m_codes.size(); ++slot)
+  {
+    if (m_codes.at(slot) >= 0)
+    {
+      ++numValues;
+    }
+  }
+  if (numValues == 0 || getDictionaryCount() * 4 > numValues)
+  {
+    decodeDictionary();
+    return false;
+  }
+  return true;
+}
+
+void GenericDataColumn::decodeDictionary()
+{
+  if (m_kind != DictionaryStorage)
+  {
+    return;
+  }
+  m_strings.resize(m_codes.size());
+  for (int slot=0; slot<m_codes.size(); ++slot)
+  {
+    if (m_codes.at(slot) >= 0)
+    {
+      m_strings[slot] = m_dictionary.at(m_codes.at(slot));
+    }
+  }
+  m_kind = StringStorage;
+  m_codes.clear();
+  m_dictionary.clear();
+  m_dictionaryCodes.clear();
+  m_codeCounts.clear();
+  m_freeCodes.clear();
+}
+
+QDateTime GenericDataColumn::latestDateTime() const
+{
+  QDateTime latest;
+  const bool typed = (m_kind == DateTimeStorage);
+  for (int slot=0; slot<m_present.size(); ++slot)
+  {
+    if (!m_present.testBit(slot))
+    {
+      continue;
+    }
+    // An overflow value, or a column of another type, is converted through value.
+    QDateTime dateTime = (typed && (m_overflow.isEmpty() || !m_overflow.contains(slot))) ? m_dateTimes.at(slot) : value(slot).toDateTime();
+    if (dateTime.isValid() && (!latest.isValid() || dateTime > latest))
+    {
+      latest = dateTime;
+    }
+  }
+  return latest;
+}
+
+QBitArray GenericDataColumn::findMatches(const QString& compareValue, const Qt::CaseSensitivity sensitive) const
+{
+  const int n = size();
+  QBitArray matches(n);
+  if (m_kind == DictionaryStorage)
+  {
+    // Compare each distinct value once, then match on the codes.
+    QBitArray codeMatches(m_dictionary.size());
+    for (int code=0; code<m_dictionary.size(); ++code)
+    {
+      codeMatches.setBit(code, m_dictionary.at(code).compare(compareValue, sensitive) == 0);
+    }
+    for (int slot=0; slot<n; ++slot)
+    {
+      if (m_present.testBit(slot))
+      {
+        int code = m_codes.at(slot);
+        matches.setBit(slot, (code >= 0) ? codeMatches.testBit(code) : (toString(slot).compare(compareValue, sensitive) == 0));
+      }
+    }
+    return matches;
+  }
+
+  for (int slot=0; slot<n; ++slot)
+  {
+    if (m_present.testBit(slot) && toString(slot).compare(compareValue, sensitive) == 0)
+    {
+      matches.setBit(slot);
+    }
+  }
+  return matches;
+}
+
+void GenericDataColumn::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::RowObjects, m_present.size() / 8 + static_cast<qint64>(sizeof(QBitArray)));
+  usage.add(MemoryUsage::RowObjects, MemoryUsage::listBytes(m_integers) + MemoryUsage::listBytes(m_doubles) + MemoryUsage::listBytes(m_dates) + MemoryUsage::listBytes(m_dateTimes) + MemoryUsage::listBytes(m_times) + MemoryUsage::listBytes(m_codes));
+
+  usage.add(MemoryUsage::RowObjects, MemoryUsage::listBytes(m_strings));
+  for (int slot=0; slot<m_strings.size(); ++slot)
+  {
+    usage.addString(m_strings.at(slot));
+  }
+
+  usage.add(MemoryUsage::VariantPayloads, MemoryUsage::listBytes(m_variants));
+  for (int slot=0; slot<m_variants.size(); ++slot)
+  {
+    usage.addVariantPayload(m_variants.at(slot));
+  }
+
+  usage.addStringList(MemoryUsage::RowObjects, m_dictionary);
+  usage.add(MemoryUsage::IndexStructures, MemoryUsage::hashBytes(m_dictionaryCodes) + MemoryUsage::listBytes(m_codeCounts) + MemoryUsage::listBytes(m_freeCodes));
+
+  usage.add(MemoryUsage::VariantPayloads, MemoryUsage::hashBytes(m_overflow));
+  for (QHash<int, QVariant>::const_iterator it = m_overflow.constBegin(); it != m_overflow.constEnd(); ++it)
+  {
+    usage.addVariantPayload(it.value());
+  }
+}
@@ -0,0 +1,234 @@
+#ifndef GENERICDATACOLUMN_H
+#define GENERICDATACOLUMN_H
+
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QBitArray>
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+#include <QMetaType>
+
+#include "chunkedlist.h"
+
+class MemoryUsage;
+class QDataStream;
+
+//**************************************************************************
+/*! \class GenericDataColumn
+ * \brief Typed storage for a single property (column) in a GenericDataCollection.
+ *
+ * Values are stored in a chunked list that matches the column type; for example, an integer
+ * column stores qint64 values and a string column stores QString values. A bit array
+ * tracks which slots contain a value so that a missing (null) value costs one bit.
+ *
+ * A value whose type does not exactly match the column type is kept in a small
+ * overflow hash so that a value always comes back out exactly as it went in.
+ *
+ * A string column with few distinct values (grade, condition, and similar) can be
+ * dictionary encoded; each slot then holds a small integer code into a shared list
+ * of distinct strings, and searches and sorts work on the codes.
+ *
+ * Slots are positions in the storage, they are not row numbers or IDs. The owning
+ * collection maps IDs to slots.
+ *
+ * All of the contained containers are implicitly shared, so copying a column is cheap.
+ * After a copy, setting a value copies only the ChunkedList chunk that holds the slot
+ * (and the null bits, one bit per slot), not the whole column.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class GenericDataColumn
+{
+public:
+  /*! \brief Most distinct values in a dictionary encoded column that was read with readBinary. */
+  static const int DefaultMaxDistinct = 256;
+
+  /*! \brief Constructor
+   *  \param [in] columnType Type of the values stored in this column.
+   *  \param [in] slotCount Initial number of slots, all of which are empty.
+   */
+  explicit GenericDataColumn(const QMetaType::Type columnType = QMetaType::UnknownType, const int slotCount = 0);
+
+  /*! \return Type of the values stored in this column. */
+  QMetaType::Type getMetaType() const { return m_metaType; }
+
+  /*! \return Number of slots, which includes empty slots. */
+  int size() const { return m_present.size(); }
+
+  /*! \brief Change the number of slots. New slots are empty.
+   *  \param [in] slotCount New number of slots.
+   */
+  void resize(const int slotCount);
+
+  /*! \brief Reserve space so that appending slots does not reallocate.
+   *  \param [in] slotCount Expected number of slots.
+   */
+  void reserve(const int slotCount);
+
+  /*! \brief Determine if a slot contains a value.
+   *  \param [in] slot Slot of interest, must be valid.
+   *  \return True if there is a value in the slot.
+   */
+  bool contains(const int slot) const { return m_present.testBit(slot); }
+
+  /*! \brief Get the value in a slot.
+   *  \param [in] slot Slot of interest, must be valid.
+   *  \return Value in the slot, or an invalid QVariant if the slot is empty.
+   */
+  QVariant value(const int slot) const;
+
+  /*! \brief Get the value in a slot as a string without creating a QVariant where possible.
+   *  \param [in] slot Slot of interest, must be valid.
+   *  \return Value in the slot as a string, or "" if the slot is empty.
+   */
+  QString toString(const int slot) const;
+
+  /*! \brief Set the value in a slot.
+   *  \param [in] slot Slot of interest, must be valid.
+   *  \param [in] value Value to store, the slot is marked as containing a value even if the value is not valid.
+   */
+  void setValue(const int slot, const QVariant& value);
+
+  /*! \brief Mark a slot as empty.
+   *  \param [in] slot Slot of interest, must be valid.
+   */
+  void removeValue(const int slot);
+
+  /*! \brief Copy the contents of one slot to another; the source slot is left as is.
+   *  \param [in] from Source slot.
+   *  \param [in] to Destination slot.
+   */
+  void moveSlot(const int from, const int to);
+
+  /*! \brief Remove the last slot. */
+  void removeLast();
+
+  /*! \brief Convert a string column to dictionary encoding if it has few distinct values.
+   *
+   *  Encoding is only done if most values repeat; at least four values per distinct value.
+   *  Values set later are added to the dictionary as needed; once there would be more than
+   *  maxDistinct distinct values, the column goes back to plain strings.
+   *
+   *  \param [in] maxDistinct Maximum number of distinct values allowed.
+   *  \return True if the column is now dictionary encoded.
+   */
+  bool encodeAsDictionary(const int maxDistinct);
+
+  /*! \brief Dictionary encode an empty string column while values are appended, so that each value is encoded as it arrives.
+   *
+   *  Once there are more than maxDistinct distinct values, the column goes back to plain strings.
+   *  Call finishDictionary when the values are loaded.
+   *
+   *  \param [in] maxDistinct Maximum number of distinct values allowed.
+   *  \return True if the column is now dictionary encoded.
+   */
+  bool beginDictionary(const int maxDistinct);
+
+  /*! \brief Finish the load started by beginDictionary; go back to plain strings unless most values repeat.
+   *
+   *  The limit on distinct values stays in force for values set later.
+   *  \return True if the column is still dictionary encoded.
+   */
+  bool finishDictionary();
+
+  /*! \return True if this column stores dictionary codes. */
+  bool isDictionaryEncoded() const { return m_kind == DictionaryStorage; }
+
+  /*! \return Distinct strings in a dictionary encoded column; a code is an index into this list. A code that no slot uses holds an empty string until it is reused. */
+  const QStringList& getDictionary() const { return m_dictionary; }
+
+  /*! \return Number of distinct strings used by at least one slot. */
+  int getDictionaryCount() const { return m_dictionary.size() - m_freeCodes.size(); }
+
+  /*! \brief Get the dictionary code for a slot.
+   *  \param [in] slot Slot of interest, must be valid.
+   *  \return Code of the value in the slot, or -1 if the slot is empty, the column is not dictionary encoded, or the value is not a string.
+   */
+  int getDictionaryCode(const int slot) const { return (m_kind == DictionaryStorage && m_present.testBit(slot)) ? m_codes.at(slot) : -1; }
+
+  /*! \brief Find the slots whose value as a string matches; a dictionary encoded column compares each distinct value once.
+   *  \param [in] compareValue Value against which to compare.
+   *  \param [in] sensitive Case sensitivity of the compare.
+   *  \return One bit per slot, set if the slot contains a matching value.
+   */
+  QBitArray findMatches(const QString& compareValue, const Qt::CaseSensitivity sensitive) const;
+
+  /*! \brief Find the latest date and time in the column, reading the typed values directly.
+   *  \return Latest valid value, or an invalid QDateTime if there is none.
+   */
+  QDateTime latestDateTime() const;
+
+  /*! \brief Write the storage as it is: the null bits, the typed values, the dictionary, and the overflow values.
+   *  \param [in, out] stream Stream to which the column is written.
+   */
+  void writeBinary(QDataStream& stream) const;
+
+  /*! \brief Replace the contents with a column written by writeBinary for a column of the same type.
+   *  \param [in, out] stream Stream from which the column is read.
+   *  \return True if the column was read and is consistent.
+   */
+  bool readBinary(QDataStream& stream);
+
+  /*! \brief Add the memory used by this column; the values are row objects unless they are strings or variants.
+   *  \param [in, out] usage Receives the bytes for the current component.
+   */
+  void addMemoryUsage(MemoryUsage& usage) const;
+
+private:
+  /*! \brief Identifies which vector holds the data. */
+  enum StorageKind { IntegerStorage, DoubleStorage, StringStorage, DateStorage, DateTimeStorage, TimeStorage, VariantStorage, DictionaryStorage };
+
+  static StorageKind storageKindForType(const QMetaType::Type columnType);
+
+  /*! \brief Get the code for a string in a dictionary encoded column, adding it to the dictionary if needed; a free code is reused first. */
+  int dictionaryCodeFor(const QString& value);
+
+  /*! \brief Drop the code in a slot; a code that no slot uses any longer is freed for reuse. */
+  void releaseCode(const int slot);
+
+  /*! \brief Count the slots that use each code, free the codes that no slot uses, and rebuild m_dictionaryCodes. */
+  void rebuildCodeCounts();
+
+  /*! \brief Reset the typed value in a slot so that it does not hold memory. */
+  void clearTypedValue(const int slot);
+
+  /*! \brief Convert a dictionary encoded column back to plain strings. */
+  void decodeDictionary();
+
+  QMetaType::Type m_metaType;
+  StorageKind m_kind;
+
+  /*! \brief One bit per slot, set if the slot contains a value. */
+  QBitArray m_present;
+
+  ChunkedList<qint64> m_integers;
+  ChunkedList<double> m_doubles;
+  ChunkedList<QString> m_strings;
+  ChunkedList<QDate> m_dates;
+  ChunkedList<QDateTime> m_dateTimes;
+  ChunkedList<QTime> m_times;
+  ChunkedList<QVariant> m_variants;
+
+  /*! \brief Dictionary encoding; a code per slot (-1 if none), the distinct strings, and a map from string to code. */
+  ChunkedList<qint32> m_codes;
+  QStringList m_dictionary;
+  QHash<QString, int> m_dictionaryCodes;
+
+  /*! \brief Number of slots that use each code, and the codes that no slot uses. */
+  QList<int> m_codeCounts;
+  QList<int> m_freeCodes;
+
+  /*! \brief Most distinct values before a dictionary encoded column is decoded. */
+  int m_maxDistinct;
+
+  /*! \brief Values whose type does not match the column type, keyed by slot. This is expected to be empty. */
+  QHash<int, QVariant> m_overflow;
+};
+
+#endif // GENERICDATACOLUMN_H
@@ -2,40 +2,227 @@
 #include "genericdatacollection.h"
 #include "sqlfieldtype.h"
 #include "typemapper.h"
+#include "memoryusage.h"
 
 #include <QUuid>
 #include <QSqlQuery>
+#include <QDebug>
 
-GenericDataObject::GenericDataObject(QObject *parent) :
-  QObject(parent)
+GenericDataObject::GenericDataObject() :
+  m_collection(nullptr), m_slot(-1)
 {
 }
 
-GenericDataObject::GenericDataObject(const GenericDataObject& obj, QObject *parent) : QObject(parent)
+GenericDataObject::GenericDataObject(const GenericDataObject& obj) : m_collection(nullptr), m_slot(-1)
 {
   GenericDataObject::operator=(obj);
 }
 
+GenericDataObject::~GenericDataObject()
+{
+}
+
+bool GenericDataObject::lookupValue(const QString& lowerCaseName, QVariant& value) const
+{
+  if (m_collection != nullptr)
+  {
+    return m_collection->slotValue(m_slot, lowerCaseName, value);
+  }
+  QHash<QString, QVariant>::const_iterator it = m_properties.constFind(lowerCaseName);
+  if (it == m_properties.constEnd())
+  {
+    return false;
+  }
+  value = it.value();
+  return true;
+}
+
+QHash<QString, QVariant> GenericDataObject::getProperties() const
+{
+  return (m_collection != nullptr) ? m_collection->slotProperties(m_slot) : m_properties;
+}
+
+void GenericDataObject::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::RowObjects, sizeof(GenericDataObject));
+  if (isBound())
+  {
+    return;
+  }
+  usage.add(MemoryUsage::VariantPayloads, MemoryUsage::hashBytes(m_properties));
+  for (QHash<QString, QVariant>::const_iterator it = m_properties.constBegin(); it != m_properties.constEnd(); ++it)
+  {
+    usage.addString(it.key());
+    usage.addVariantPayload(it.value());
+  }
+}
+
+const QVariant GenericDataObject::getValueNative(const QString& name) const
+{
+  QVariant v;
+  lookupValue(name.toLower(), v);
+  return v;
+}
+
+void GenericDataObject::setValueNative(const QString &name, const QVariant& value)
+{
+  if (m_collection != nullptr)
+  {
+    m_collection->setSlotValue(m_slot, name.toLower(), value);
+  }
+  else
+  {
+    m_properties.insert(name.toLower(), value);
+  }
+}
+
+bool GenericDataObject::containsValue(const QString& name) const
+{
+  return containsValueNoCase(name.toLower());
+}
+
+bool GenericDataObject::containsValueNoCase(const QString& name) const
+{
+  return (m_collection != nullptr) ? m_collection->slotContainsValue(m_slot, name) : m_properties.contains(name);
+}
+
+GenericDataObject* GenericDataObject::clone() const
+{
+  return new GenericDataObject(*this);
+}
+
+const GenericDataColumn* GenericDataObject::boundColumn(const FieldRef& ref) const
+{
+  return (m_collection != nullptr && ref.getCollection() == m_collection) ? &m_collection->m_columns.at(ref.getIndex()) : nullptr;
+}
+
+bool GenericDataObject::lookupValue(const FieldRef& ref, QVariant& value) const
+{
+  const GenericDataColumn* column = boundColumn(ref);
+  if (column == nullptr)
+  {
+    return lookupValue(ref.getLowerCaseName(), value);
+  }
+  if (!column->contains(m_slot))
+  {
+    return false;
+  }
+  value = column->value(m_slot);
+  return true;
+}
+
+FieldRef GenericDataObject::resolveSortField(const TableSortField& sortField) const
+{
+  if (m_collection != nullptr)
+  {
+    FieldRef ref = m_collection->resolve(sortField.fieldIndex());
+    if (ref.getLowerCaseName() == sortField.fieldName())
+    {
+      return ref;
+    }
+  }
+  return FieldRef(sortField.fieldName());
+}
+
+bool GenericDataObject::contains(const FieldRef& ref) const
+{
+  const GenericDataColumn* column = boundColumn(ref);
+  return (column != nullptr) ? column->contains(m_slot) : containsValueNoCase(ref.getLowerCaseName());
+}
+
+QVariant GenericDataObject::get(const FieldRef& ref) const
+{
+  QVariant v;
+  lookupValue(ref, v);
+  return v;
+}
+
+QString GenericDataObject::getString(const FieldRef& ref) const
+{
+  const GenericDataColumn* column = boundColumn(ref);
+  if (column != nullptr)
+  {
+    return column->toString(m_slot);
+  }
+  QVariant v;
+  return lookupValue(ref.getLowerCaseName(), v) ? v.toString() : "";
+}
+
+int GenericDataObject::getInt(const FieldRef& ref, const int defaultValue) const
+{
+  QVariant v;
+  if (lookupValue(ref, v))
+  {
+    bool ok = false;
+    int i = v.toInt(&ok);
+    if (ok)
+    {
+      return i;
+    }
+  }
+  return defaultValue;
+}
+
+double GenericDataObject::getDouble(const FieldRef& ref, const double defaultValue) const
+{
+  QVariant v;
+  if (lookupValue(ref, v))
+  {
+    bool ok = false;
+    double d = v.toDouble(&ok);
+    if (ok)
+    {
+      return d;
+    }
+  }
+  return defaultValue;
+}
+
+void GenericDataObject::set(const FieldRef& ref, const QVariant& value)
+{
+  if (boundColumn(ref) != nullptr)
+  {
+    m_collection->setColumnValue(ref.getIndex(), m_slot, value);
+  }
+  else if (m_collection != nullptr)
+  {
+    m_collection->setSlotValue(m_slot, ref.getLowerCaseName(), value);
+  }
+  else
+  {
+    m_properties.insert(ref.getLowerCaseName(), value);
+  }
+}
+
+bool GenericDataObject::valueIs(const QString& lowerCaseName, const QString& compareValue, const Qt::CaseSensitivity sensitive) const
+{
+  QVariant v;
+  return lookupValue(lowerCaseName, v) && (v.toString().compare(compareValue, sensitive) == 0);
+}
+
 QString GenericDataObject::getString(const QString& name) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toString() : "";
+  QVariant v;
+  return lookupValue(lower, v) ? v.toString() : "";
 }
 
 QString GenericDataObject::getString(const QString& name, const QString& defaultValue) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toString() : defaultValue;
+  QVariant v;
+  return lookupValue(lower, v) ? v.toString() : defaultValue;
 }
 
 
 int GenericDataObject::getInt(const QString& name, const int defaultValue) const
 {
   QString lower = name.toLower();
-  if (containsValueNoCase(lower))
+  QVariant v;
+  if (lookupValue(lower, v))
   {
     bool ok = false;
-    int i = m_properties.value(lower).toInt(&ok);
+    int i = v.toInt(&ok);
     if (ok)
     {
       return i;
@@ -47,10 +234,11 @@ int GenericDataObject::getInt(const QString& name, const int defaultValue) const
 double GenericDataObject::getDouble(const QString& name, const double defaultValue) const
 {
   QString lower = name.toLower();
-  if (containsValueNoCase(lower))
+  QVariant v;
+  if (lookupValue(lower, v))
   {
     bool ok = false;
-    double i = m_properties.value(lower).toDouble(&ok);
+    double i = v.toDouble(&ok);
     if (ok)
     {
       return i;
@@ -62,39 +250,45 @@ double GenericDataObject::getDouble(const QString& name, const double defaultVal
 QDate GenericDataObject::getDate(const QString& name) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toDate() : QDate::currentDate();
+  QVariant v;
+  return lookupValue(lower, v) ? v.toDate() : QDate::currentDate();
 }
 
 QDate GenericDataObject::getDate(const QString& name, const QDate& defaultValue) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toDate() : defaultValue;
+  QVariant v;
+  return lookupValue(lower, v) ? v.toDate() : defaultValue;
 }
 
 
 QDateTime GenericDataObject::getDateTime(const QString& name) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toDateTime() : QDateTime::currentDateTime();
+  QVariant v;
+  return lookupValue(lower, v) ? v.toDateTime() : QDateTime::currentDateTime();
 }
 
 QDateTime GenericDataObject::getDateTime(const QString& name, const QDateTime& defaultValue) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toDateTime() : defaultValue;
+  QVariant v;
+  return lookupValue(lower, v) ? v.toDateTime() : defaultValue;
 }
 
 
 QTime GenericDataObject::getTime(const QString& name) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toTime() : QTime::currentTime();
+  QVariant v;
+  return lookupValue(lower, v) ? v.toTime() : QTime::currentTime();
 }
 
 QTime GenericDataObject::getTime(const QString& name, const QTime& defaultValue) const
 {
   QString lower = name.toLower();
-  return containsValueNoCase(lower) ? m_properties.value(lower).toTime() : defaultValue;
+  QVariant v;
+  return lookupValue(lower, v) ? v.toTime() : defaultValue;
 }
 
 const GenericDataObject& GenericDataObject::operator=(const GenericDataObject& obj)
@@ -102,12 +296,13 @@ const GenericDataObject& GenericDataObject::operator=(const GenericDataObject& o
   // Note that the parent object is NOT copied.
   if (this != &obj)
   {
-    m_properties.clear();
-    QHashIterator<QString, QVariant> i(obj.m_properties);
-    while (i.hasNext())
+    if (m_collection != nullptr)
     {
-      i.next();
-      m_properties.insert(i.key(), i.value());
+      m_collection->setSlotProperties(m_slot, obj.getProperties());
+    }
+    else
+    {
+      m_properties = obj.getProperties();
     }
   }
   return *this;
@@ -127,21 +322,24 @@ int GenericDataObject::compare(const GenericDataObject& obj, const QList<TableSo
         const TableSortField* sortField = i.next();
         if (sortField != nullptr)
         {
-            if (!obj.containsValueNoCase(sortField->fieldName()))
+            // Resolved once per field, so the values are read by column index.
+            const FieldRef ref = resolveSortField(*sortField);
+            QVariant v1;
+            QVariant v2;
+            bool hasV1 = lookupValue(ref, v1);
+            if (!obj.lookupValue(ref, v2))
             {
-                if (containsValueNoCase(sortField->fieldName()))
+                if (hasV1)
                 {
                     return sortField->isAscending() ? 1 : -1;
                 }
             }
-            else if (!containsValueNoCase(sortField->fieldName()))
+            else if (!hasV1)
             {
                 return sortField->isAscending() ? -1 : 1;
             }
             else
             {
-                QVariant v1 = getValue(sortField->fieldName());
-                QVariant v2 = obj.getValue(sortField->fieldName());
                 rc = sortField->valueCompare(v1, v2);
             }
         }
@@ -228,25 +426,25 @@ int GenericDataObject::compare(const GenericDataObject& obj, const QStringList&
 
 bool GenericDataObject::isDateTime(const QString& name) const
 {
-  const QVariant v = m_properties.value(name.toLower());
+  const QVariant v = getValueNative(name);
   return (QMetaType::QDateTime == v.metaType().id());
 }
 
 bool GenericDataObject::isDate(const QString& name) const
 {
-  const QVariant v = m_properties.value(name.toLower());
+  const QVariant v = getValueNative(name);
   return (QMetaType::QDate == v.metaType().id());
 }
 
 bool GenericDataObject::isTime(const QString& name) const
 {
-  const QVariant v = m_properties.value(name.toLower());
+  const QVariant v = getValueNative(name);
   return (QMetaType::QTime == v.metaType().id());
 }
 
 bool GenericDataObject::increment(const QString& name, const double incValue, QVariant& variantValue)
 {
-  const QVariant v = m_properties.value(name.toLower());
+  const QVariant v = getValueNative(name);
   //qDebug() << "GenericDataObject::increment name:" << name << " value:" << v << " add " << incValue;
   if (incValue == 0.0) {
     variantValue = v;
@@ -288,7 +486,7 @@ bool GenericDataObject::increment(const QString& name, const int incValue, QVari
 
 const QVariant GenericDataObject::getValue(const QString& name) const
 {
-  return m_properties.value(name.toLower());
+  return getValueNative(name);
 }
 
 bool GenericDataObject::fieldNameMeansDate(const QString &name)
@@ -304,9 +502,9 @@ bool GenericDataObject::fieldNameMeansDateTime(const QString &name)
 
 bool GenericDataObject::setBindValue(QSqlQuery& query, const QString& paramName, const QString& fieldName, const SqlFieldType& fieldType, bool missingMeansNull) const
 {
-    QString lower = fieldName.toLower();
-    if (containsValueNoCase(lower)) {
-        query.bindValue(paramName, m_properties.value(lower));
+    QVariant v;
+    if (lookupValue(fieldName.toLower(), v)) {
+        query.bindValue(paramName, v);
     } else {
         if (missingMeansNull) {
             TypeMapper mapper;
@@ -419,4 +617,3 @@ bool GenericDataObject::setBindValue(QSqlQuery& query, const QString& paramName,
     return true;
 }
 
-
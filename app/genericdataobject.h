@@ -1,16 +1,20 @@
 #ifndef GENERICDATAOBJECT_H
 #define GENERICDATAOBJECT_H
 
-#include <QObject>
+#include <QString>
 #include <QStringList>
 #include <QHash>
 #include <QVariant>
 #include <QDate>
 #include <QDateTime>
 #include "tablesortfield.h"
+#include "fieldref.h"
 
 class QSqlQuery;
 class SqlFieldType;
+class MemoryUsage;
+class GenericDataCollection;
+class GenericDataColumn;
 
 //**************************************************************************
 /*! \class GenericDataObject
@@ -20,36 +24,41 @@ class SqlFieldType;
  *
  * This adds the ability to bind named values to SQL parameters and to compare values.
  *
+ * An object is either detached, in which case it owns its values, or it is a light weight
+ * view of a row stored in a GenericDataCollection. A view is created and owned by the
+ * collection; reading or writing a view reads or writes the collection's column storage.
+ * A clone is always detached.
+ *
+ * This is intentionally not a QObject; a table may contain hundreds of thousands of rows.
+ *
  * \author Andrew Pitonyak
  * \copyright Andrew Pitonyak, but you may use without restriction.
  * \date 2012-2019
  **************************************************************************/
-class GenericDataObject : public QObject
+class GenericDataObject
 {
-  Q_OBJECT
 public:
-  /*! \brief Constructor
-   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
-   */
-  explicit GenericDataObject(QObject *parent = nullptr);
+  /*! \brief Constructor creates a detached object with no properties. */
+  GenericDataObject();
 
   /*! \brief Replace all of the "properties" in this object. The properties are the only thing that is copied.
-   *  \param [in] obj Object from which the properties are copied.
-   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
+   *  \param [in] obj Object from which the properties are copied; the new object is always detached.
    */
-  GenericDataObject(const GenericDataObject& obj, QObject *parent = nullptr);
+  GenericDataObject(const GenericDataObject& obj);
+
+  virtual ~GenericDataObject();
 
   /*! \brief Determine if the property was set. Tests based on the lower case value of the property name.
    *  \param [in] name Property name of interest.
    *  \return True if there is a value for this property. Note that null values are generally not added and this is how you can test for that.
    */
-  inline bool containsValue(const QString& name) const;
+  bool containsValue(const QString& name) const;
 
   /*! \brief Determine if the property was set.
    *  \param [in] name Lowercase version of the property name of interest.
    *  \return True if there is a value for this property. Note that null values are generally not added and this is how you can test for that.
    */
-  inline bool containsValueNoCase(const QString& name) const;
+  bool containsValueNoCase(const QString& name) const;
 
   /*! \brief Get the value associated to the name with no checking or smart translations.
    *
@@ -199,11 +208,10 @@ public:
    */
   virtual const GenericDataObject& operator=(const GenericDataObject& obj);
 
-  /*! \brief Return a new object containing the same properties as this object. Parent is not copied, you must provide it if you want it. You own the pointer.
-   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
-   *  \return Cloned copy of this object; you own the object (unless the parent does).
+  /*! \brief Return a new detached object containing the same properties as this object. You own the pointer.
+   *  \return Cloned copy of this object; you own the object.
    */
-  virtual GenericDataObject* clone(QObject *parent = nullptr) const;
+  virtual GenericDataObject* clone() const;
 
   /*! \brief Does this object contain the named property with the specified string value.
    *  \param [in] lowerCaseName Lower case name of the property of interest.
@@ -231,42 +239,86 @@ public:
 
   bool setBindValue(QSqlQuery& query, const QString& paramName, const QString& fieldName, const SqlFieldType& fieldType, bool missingMeansNull=true) const;
 
-signals:
-  
-public slots:
+  /*! \brief Determine if the property was set using a resolved field.
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \return True if there is a value for this property.
+   */
+  bool contains(const FieldRef& ref) const;
+
+  /*! \brief Get the value using a resolved field with no checking or smart translations.
+   *
+   *  A view of the collection that resolved the field reads the column directly, so there is no string hashing.
+   *
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \return Return the property value, or, a defaultly constructed object if it does not exist.
+   */
+  QVariant get(const FieldRef& ref) const;
+
+  /*! \brief Get the property as a string using a resolved field.
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \return Return the property as a string value. Return "" if the property does not exist.
+   */
+  QString getString(const FieldRef& ref) const;
+
+  /*! \brief Get the property as an int using a resolved field.
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \param [in] defaultValue Returned if the property does not exist.
+   *  \return Return the property as an int value or defaultValue if the property does not exist.
+   */
+  int getInt(const FieldRef& ref, const int defaultValue = -1) const;
+
+  /*! \brief Get the property as a double using a resolved field.
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \param [in] defaultValue Returned if the property does not exist.
+   *  \return Return the property as a double value or defaultValue if the property does not exist.
+   */
+  double getDouble(const FieldRef& ref, const double defaultValue = 0.0) const;
+
+  /*! \brief Set the value using a resolved field.
+   *  \param [in] ref Field resolved by GenericDataCollection::resolve.
+   *  \param [in] value Property value that must be of the correct type.
+   */
+  void set(const FieldRef& ref, const QVariant& value);
+
+  /*! \return True if this object is a view of a row in a collection. */
+  bool isBound() const { return m_collection != nullptr; }
+
+  /*! \brief Get a copy of all of the properties keyed by lower case name.
+   *  \return All of the properties that are set.
+   */
+  QHash<QString, QVariant> getProperties() const;
+
+  /*! \brief Add the memory used by this object. The values of a view are counted by its collection, so only the view itself is added.
+   *  \param [in, out] usage Receives the bytes for the current component.
+   */
+  void addMemoryUsage(MemoryUsage& usage) const;
 
 private:
-  QHash<QString, QVariant> m_properties;
-};
+  friend class GenericDataCollection;
+  friend class GenericDataObjectPool;
 
-inline const QVariant GenericDataObject::getValueNative(const QString& name) const
-{
-  return m_properties.value(name.toLower());
-}
+  /*! \brief Get a value without any conversions.
+   *  \param [in] lowerCaseName Lower case name of the property of interest.
+   *  \param [out] value Set to the value if it exists.
+   *  \return True if the property exists.
+   */
+  bool lookupValue(const QString& lowerCaseName, QVariant& value) const;
+  bool lookupValue(const FieldRef& ref, QVariant& value) const;
 
-inline void GenericDataObject::setValueNative(const QString &name, const QVariant& value)
-{
-  m_properties.insert(name.toLower(), value);
-}
+  /*! \brief Get the column for a resolved field if this is a view of the collection that resolved it, nullptr otherwise. */
+  const GenericDataColumn* boundColumn(const FieldRef& ref) const;
 
-inline bool GenericDataObject::containsValue(const QString& name) const
-{
-  return containsValueNoCase(name.toLower());
-}
+  /*! \brief Resolve a sort field against this object's collection. The sort field already knows its column index. */
+  FieldRef resolveSortField(const TableSortField& sortField) const;
 
-inline bool GenericDataObject::containsValueNoCase(const QString& name) const
-{
-  return m_properties.contains(name);
-}
+  /*! \brief Property values for a detached object keyed by lower case name. Not used by a view. */
+  QHash<QString, QVariant> m_properties;
 
-inline GenericDataObject* GenericDataObject::clone(QObject *parent) const
-{
-    return new GenericDataObject(*this, parent);
-}
+  /*! \brief Collection that holds the values for a view, or nullptr for a detached object. */
+  GenericDataCollection* m_collection;
 
-inline bool GenericDataObject::valueIs(const QString& lowerCaseName, const QString& compareValue, const Qt::CaseSensitivity sensitive) const
-{
-  return containsValueNoCase(lowerCaseName) && (m_properties.value(lowerCaseName).toString().compare(compareValue, sensitive) == 0);
-}
+  /*! \brief Storage slot in the collection for a view. */
+  int m_slot;
+};
 
 #endif // GENERICDATAOBJECT_H
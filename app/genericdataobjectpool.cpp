@@ -0,0 +1,65 @@
+#include "genericdataobjectpool.h"
+#include "genericdataobject.h"
+
+GenericDataObjectPool::GenericDataObjectPool() : m_usedInLastSlab(SlabSize)
+{
+}
+
+GenericDataObjectPool::~GenericDataObjectPool()
+{
+  clear();
+}
+
+GenericDataObject* GenericDataObjectPool::acquire(GenericDataCollection* collection, const int slot)
+{
+  GenericDataObject* obj = nullptr;
+  if (!m_free.isEmpty())
+  {
+    obj = m_free.takeLast();
+  }
+  else
+  {
+    if (m_usedInLastSlab >= SlabSize)
+    {
+      m_slabs.append(new GenericDataObject[SlabSize]);
+      m_usedInLastSlab = 0;
+    }
+    obj = m_slabs.last() + m_usedInLastSlab;
+    ++m_usedInLastSlab;
+  }
+  obj->m_collection = collection;
+  obj->m_slot = slot;
+  return obj;
+}
+
+void GenericDataObjectPool::release(GenericDataObject* obj)
+{
+  if (obj != nullptr)
+  {
+    obj->m_collection = nullptr;
+    obj->m_slot = -1;
+    obj->m_properties.clear();
+    m_free.append(obj);
+  }
+}
+
+void GenericDataObjectPool::clear()
+{
+  for (int i=0; i<m_slabs.size(); ++i)
+  {
+    delete[] m_slabs.at(i);
+  }
+  m_slabs.clear();
+  m_free.clear();
+  m_usedInLastSlab = SlabSize;
+}
+
+int GenericDataObjectPool::getAllocatedCount() const
+{
+  return m_slabs.isEmpty() ? 0 : (m_slabs.size() - 1) * SlabSize + m_usedInLastSlab;
+}
+
+qint64 GenericDataObjectPool::getAllocatedBytes() const
+{
+  return static_cast<qint64>(m_slabs.size()) * SlabSize * static_cast<qint64>(sizeof(GenericDataObject)) + static_cast<qint64>(m_slabs.capacity() + m_free.capacity()) * static_cast<qint64>(sizeof(GenericDataObject*));
+}
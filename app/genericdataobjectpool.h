@@ -0,0 +1,72 @@
+#ifndef GENERICDATAOBJECTPOOL_H
+#define GENERICDATAOBJECTPOOL_H
+
+#include <QList>
+#include <QtGlobal>
+
+class GenericDataObject;
+class GenericDataCollection;
+
+//**************************************************************************
+/*! \class GenericDataObjectPool
+ * \brief Slab allocator for the row views handed out by a GenericDataCollection.
+ *
+ * Views are carved out of fixed size arrays (slabs) rather than allocated one at
+ * a time. A released view goes on a free list for reuse, and clear() releases
+ * every slab at once, so tearing down a large collection is a handful of deletes.
+ *
+ * The pool owns every object that it hands out; never delete one directly.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class GenericDataObjectPool
+{
+public:
+  GenericDataObjectPool();
+
+  /*! \brief Destructor releases all slabs. */
+  ~GenericDataObjectPool();
+
+  /*! \brief Get a view bound to a slot in a collection.
+   *  \param [in] collection Collection that owns the data.
+   *  \param [in] slot Storage slot in the collection.
+   *  \return View owned by this pool.
+   */
+  GenericDataObject* acquire(GenericDataCollection* collection, const int slot);
+
+  /*! \brief Return a view to the pool so that it can be reused. Null is ignored.
+   *  \param [in] obj View previously returned by acquire.
+   */
+  void release(GenericDataObject* obj);
+
+  /*! \brief Release every slab. All views handed out become invalid. */
+  void clear();
+
+  /*! \return Number of objects that have been allocated, including those on the free list. */
+  int getAllocatedCount() const;
+
+  /*! \return Number of objects on the free list. */
+  int getFreeCount() const { return m_free.size(); }
+
+  /*! \return Bytes allocated for the slabs and the free list. */
+  qint64 getAllocatedBytes() const;
+
+private:
+  Q_DISABLE_COPY(GenericDataObjectPool)
+
+  /*! \brief Number of objects in each slab. */
+  static const int SlabSize = 256;
+
+  /*! \brief Each slab is an array of SlabSize objects. */
+  QList<GenericDataObject*> m_slabs;
+
+  /*! \brief Number of objects handed out from the last slab. */
+  int m_usedInLastSlab;
+
+  /*! \brief Released objects available for reuse. */
+  QList<GenericDataObject*> m_free;
+};
+
+#endif // GENERICDATAOBJECTPOOL_H
@@ -0,0 +1,33 @@
+#include "genericdatavalueindex.h"
+#include "memoryusage.h"
+
+GenericDataValueIndex::GenericDataValueIndex(const Qt::CaseSensitivity sensitive) : m_sensitive(sensitive)
+{
+}
+
+void GenericDataValueIndex::insert(const QString& value, const int id)
+{
+  m_ids[key(value)].insert(id);
+}
+
+void GenericDataValueIndex::remove(const QString& value, const int id)
+{
+  QHash<QString, QSet<int> >::iterator it = m_ids.find(key(value));
+  if (it != m_ids.end())
+  {
+    it.value().remove(id);
+    if (it.value().isEmpty())
+    {
+      m_ids.erase(it);
+    }
+  }
+}
+
+void GenericDataValueIndex::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::IndexStructures, MemoryUsage::hashBytes(m_ids));
+  for (QHash<QString, QSet<int> >::const_iterator it = m_ids.constBegin(); it != m_ids.constEnd(); ++it)
+  {
+    usage.add(MemoryUsage::IndexStructures, MemoryUsage::stringBytes(it.key()) + MemoryUsage::setBytes(it.value()));
+  }
+}
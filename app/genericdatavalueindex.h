@@ -0,0 +1,87 @@
+#ifndef GENERICDATAVALUEINDEX_H
+#define GENERICDATAVALUEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+class MemoryUsage;
+
+//**************************************************************************
+/*! \class GenericDataValueIndex
+ * \brief Secondary index for one property in a GenericDataCollection, maps a value to the IDs that contain it.
+ *
+ * Values are indexed by their string representation, which is how the collection
+ * compares values in getObjectByValue, countValues, and getMatchingValues. A case
+ * insensitive index stores case folded keys, so it can answer both case sensitive
+ * and case insensitive searches; a case sensitive index can only answer case
+ * sensitive searches.
+ *
+ * The collection owns the index and keeps it current as values change.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class GenericDataValueIndex
+{
+public:
+  /*! \brief Constructor
+   *  \param [in] sensitive Case sensitivity of the keys.
+   */
+  explicit GenericDataValueIndex(const Qt::CaseSensitivity sensitive = Qt::CaseInsensitive);
+
+  /*! \return Case sensitivity of the keys. */
+  Qt::CaseSensitivity getCaseSensitivity() const { return m_sensitive; }
+
+  /*! \brief Determine if this index can be used for a search.
+   *  \param [in] sensitive Case sensitivity of the search.
+   *  \return True if every match is found in the index.
+   */
+  bool canSearch(const Qt::CaseSensitivity sensitive) const { return m_sensitive == Qt::CaseInsensitive || sensitive == Qt::CaseSensitive; }
+
+  /*! \brief Add an ID for a value.
+   *  \param [in] value String representation of the value.
+   *  \param [in] id Object ID that contains the value.
+   */
+  void insert(const QString& value, const int id);
+
+  /*! \brief Remove an ID for a value in constant time.
+   *  \param [in] value String representation of the value previously inserted for this ID.
+   *  \param [in] id Object ID that contained the value.
+   */
+  void remove(const QString& value, const int id);
+
+  /*! \brief Find candidate IDs for a value.
+   *
+   *  If the index is case insensitive, the candidates are all IDs whose value is equal ignoring case.
+   *
+   *  \param [in] value String representation of the value.
+   *  \return IDs whose value has the same key, in no particular order.
+   */
+  QList<int> find(const QString& value) const { return m_ids.value(key(value)).values(); }
+
+  /*! \brief Remove everything from the index. */
+  void clear() { m_ids.clear(); }
+
+  /*! \brief Add the memory used by this index, keys included, as index structures.
+   *  \param [in, out] usage Receives the bytes for the current component.
+   */
+  void addMemoryUsage(MemoryUsage& usage) const;
+
+private:
+  /*! \return Key used in the hash for this value. */
+  QString key(const QString& value) const { return (m_sensitive == Qt::CaseSensitive) ? value : value.toCaseFolded(); }
+
+  Qt::CaseSensitivity m_sensitive;
+
+  /*! \brief Key is the (possibly case folded) value, and the value is the set of IDs.
+   *
+   *  A set rather than a list so that removing an ID from a common value, such as a
+   *  country shared by most rows, does not scan every other ID with that value.
+   */
+  QHash<QString, QSet<int> > m_ids;
+};
+
+#endif // GENERICDATAVALUEINDEX_H
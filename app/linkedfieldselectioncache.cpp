@@ -1,4 +1,5 @@
 #include "linkedfieldselectioncache.h"
+#include "memoryusage.h"
 
 LinkedFieldSelectionCache::LinkedFieldSelectionCache(QObject *parent) :
     QObject(parent)
@@ -78,6 +79,24 @@ void LinkedFieldSelectionCache::clear()
   m_tableFieldToCashIdentifierName.clear();
 }
 
+void LinkedFieldSelectionCache::invalidateTable(const QString& targetTableName)
+{
+  // Every cache identifier starts with the target table name.
+  const QString prefix = targetTableName + "|";
+  QStringList cacheIds = m_cachedLists.keys();
+  cacheIds << m_cachedValueToId.keys();
+  cacheIds << m_IdToCachedValue.keys();
+  for (int i=0; i<cacheIds.size(); ++i)
+  {
+    if (cacheIds.at(i).startsWith(prefix, Qt::CaseInsensitive))
+    {
+      m_cachedLists.remove(cacheIds.at(i));
+      m_cachedValueToId.remove(cacheIds.at(i));
+      m_IdToCachedValue.remove(cacheIds.at(i));
+    }
+  }
+}
+
 const QString* LinkedFieldSelectionCache::getCacheValueBySourceTable(const QString& tableName, const QString& fieldName, const int id) const
 {
   if (hasCacheIdentifier(tableName, fieldName))
@@ -118,3 +137,32 @@ int LinkedFieldSelectionCache::getIdForCachedValue(const QString& cacheId, const
   }
   return -1;
 }
+
+void LinkedFieldSelectionCache::addMemoryUsage(MemoryUsage& usage) const
+{
+  usage.add(MemoryUsage::CacheEntries, MemoryUsage::hashBytes(m_cachedLists) + MemoryUsage::hashBytes(m_cachedValueToId) + MemoryUsage::hashBytes(m_IdToCachedValue) + MemoryUsage::hashBytes(m_tableFieldToCashIdentifierName));
+  for (QHash<QString, QStringList>::const_iterator it = m_cachedLists.constBegin(); it != m_cachedLists.constEnd(); ++it)
+  {
+    usage.addString(it.key());
+    usage.addStringList(MemoryUsage::CacheEntries, it.value());
+  }
+
+  // The value to ID keys share their text with the ID to value values, so the text is only counted once.
+  for (QHash<QString, QHash<QString, int> >::const_iterator it = m_cachedValueToId.constBegin(); it != m_cachedValueToId.constEnd(); ++it)
+  {
+    usage.add(MemoryUsage::CacheEntries, MemoryUsage::hashBytes(it.value()));
+  }
+  for (QHash<QString, QHash<int, QString> >::const_iterator it = m_IdToCachedValue.constBegin(); it != m_IdToCachedValue.constEnd(); ++it)
+  {
+    usage.add(MemoryUsage::CacheEntries, MemoryUsage::hashBytes(it.value()));
+    for (QHash<int, QString>::const_iterator valueIt = it.value().constBegin(); valueIt != it.value().constEnd(); ++valueIt)
+    {
+      usage.addString(valueIt.value());
+    }
+  }
+
+  for (QHash<QString, QHash<QString, QString> >::const_iterator it = m_tableFieldToCashIdentifierName.constBegin(); it != m_tableFieldToCashIdentifierName.constEnd(); ++it)
+  {
+    usage.add(MemoryUsage::CacheEntries, MemoryUsage::hashBytes(it.value()));
+  }
+}
@@ -5,6 +5,8 @@
 #include <QHash>
 #include <QStringList>
 
+class MemoryUsage;
+
 //**************************************************************************
 /*! \class LinkedFieldSelectionCache
  *
@@ -67,6 +69,14 @@ public:
 
     void clear();
 
+    /*! \brief Remove the cached values and lists taken from a table so that they are built again from the current data.
+     *
+     *  The identifiers that associate a source field to a table are kept, they do not depend on the data.
+     *
+     *  \param [in] targetTableName Table from which the values were taken, not case sensitive.
+     */
+    void invalidateTable(const QString& targetTableName);
+
     bool hasCachedList(const QString& cacheIdentifier) const;
     QStringList getCachedList(const QString& cacheIdentifier) const;
     void setCachedList(const QString& cacheIdentifier, QStringList list);
@@ -77,6 +87,12 @@ public:
 
     int getIdForCachedValue(const QString& cacheId, const QString& cachedValue) const;
 
+    /*! \brief Add the memory used by the cache; the hashes and lists are cache entries and the text is string data.
+     *
+     *  \param [in, out] usage Receives the bytes for the current component.
+     */
+    void addMemoryUsage(MemoryUsage& usage) const;
+
   signals:
 
   public slots:
@@ -13,6 +13,8 @@
 #include "globals.h"
 #include "configuredialog.h"
 #include "imageutility.h"
+#include "tablepagereader.h"
+#include "stampdbasync.h"
 
 #include <QDebug>
 #include <QMessageBox>
@@ -25,13 +27,18 @@
 #include <QXmlStreamWriter>
 #include <QInputDialog>
 #include <QScopedPointer>
+#include <QElapsedTimer>
+#include <QProgressDialog>
 
 #include <QSqlQuery>
 
 MainWindow::MainWindow(QWidget *parent) :
   QMainWindow(parent),
   ui(new Ui::MainWindow),
-  m_db(nullptr)
+  m_db(nullptr),
+  m_asyncDb(nullptr),
+  m_progressDialog(nullptr),
+  m_asyncRequestId(-1)
 {
   initializeSettings();
   ui->setupUi(this);
@@ -46,6 +53,9 @@ MainWindow::~MainWindow()
   QScopedPointer<QSettings> pSettings(getQSettings());
   pSettings->setValue(Constants::Settings_MainWindowGeometry, saveGeometry());
   qDebug() << "file name for settings: " << pSettings->fileName();
+  // Waits for the worker thread to stop.
+  delete m_asyncDb;
+  m_asyncDb = nullptr;
   delete ui;
 }
 
@@ -149,6 +159,9 @@ bool MainWindow::createDBWorker()
     }
     m_db = new StampDB(this);
     m_db->pathToDB(QDir::cleanPath(path + QDir::separator() + dbName));
+    // Off unless the user asks for it, the cache holds a copy of the data.
+    m_db->setSnapshotCacheEnabled(pSettings->value(Constants::Settings_UseSnapshotCache, false).toBool());
+    connect(m_db, SIGNAL(snapshotStale(QString,QStringList,QStringList)), this, SLOT(rebuildStaleSnapshot(QString,QStringList,QStringList)));
   }
   if (!m_db->openDB()) {
     QMessageBox msgBox;
@@ -178,9 +191,115 @@ bool MainWindow::createDBWorker()
 
     return false;
   }
+  // Tell open windows when the worker thread, or another program, changes the database.
+  m_db->startChangeMonitor();
+  createAsyncWorker();
   return true;
 }
 
+bool MainWindow::createAsyncDB()
+{
+  if (m_asyncRequestId >= 0) {
+    ScrollMessageBox::information(this, "WARN", tr("Wait for the current import or export to finish."));
+    return false;
+  }
+  if (!createDBWorker()) {
+    return false;
+  }
+  if (m_asyncDb != nullptr && m_asyncDb->pathToDB() != m_db->pathToDB()) {
+    delete m_asyncDb;
+    m_asyncDb = nullptr;
+  }
+  createAsyncWorker();
+  return true;
+}
+
+void MainWindow::createAsyncWorker()
+{
+  if (m_asyncDb == nullptr) {
+    m_asyncDb = new StampDBAsync(m_db->pathToDB(), this);
+    connect(m_asyncDb, SIGNAL(finished(int,bool)), this, SLOT(asyncFinished(int,bool)));
+    connect(m_asyncDb, SIGNAL(progress(int,int,int,QString)), this, SLOT(asyncProgress(int,int,int,QString)));
+    connect(m_asyncDb, SIGNAL(message(QString,QString)), this, SLOT(asyncMessage(QString,QString)));
+    connect(m_asyncDb, SIGNAL(tablesChanged(QStringList)), this, SLOT(asyncTablesChanged(QStringList)));
+    m_asyncDb->setSnapshotCacheEnabled(m_db->isSnapshotCacheEnabled());
+    // Only the worker upgrades, so two connections never race, and filling an index does not freeze the window.
+    m_asyncDb->upgradeSchema();
+  }
+}
+
+void MainWindow::startAsyncRequest(const int requestId, const QString& label)
+{
+  m_asyncRequestId = requestId;
+  // Not modal, the window can be used while the request runs.
+  m_progressDialog = new QProgressDialog(label, tr("Cancel"), 0, 0, this);
+  m_progressDialog->setAutoClose(false);
+  m_progressDialog->setAutoReset(false);
+  m_progressDialog->setMinimumDuration(500);
+  connect(m_progressDialog, SIGNAL(canceled()), this, SLOT(cancelAsyncRequest()));
+}
+
+void MainWindow::asyncProgress(int requestId, int done, int total, const QString& text)
+{
+  if (requestId != m_asyncRequestId || m_progressDialog == nullptr) {
+    return;
+  }
+  // A total of -1 shows a busy indicator.
+  m_progressDialog->setRange(0, qMax(0, total));
+  if (total > 0) {
+    m_progressDialog->setValue(done);
+  }
+  m_progressDialog->setLabelText(text);
+}
+
+void MainWindow::asyncMessage(const QString& title, const QString& text)
+{
+  ScrollMessageBox::information(this, title, text);
+}
+
+void MainWindow::asyncTablesChanged(const QStringList& tableNames)
+{
+  if (m_db != nullptr) {
+    m_db->notifyTablesChanged(tableNames, m_asyncDb);
+  }
+}
+
+void MainWindow::rebuildStaleSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList)
+{
+  // Not shown with a progress dialog; asyncFinished ignores the request.
+  if (m_asyncDb != nullptr) {
+    m_asyncDb->rebuildSnapshot(tableName, fieldNames, orderByList);
+  }
+}
+
+void MainWindow::cancelAsyncRequest()
+{
+  if (m_asyncDb != nullptr && m_asyncRequestId >= 0) {
+    m_asyncDb->cancel(m_asyncRequestId);
+  }
+}
+
+void MainWindow::asyncFinished(int requestId, bool ok)
+{
+  if (requestId != m_asyncRequestId) {
+    return;
+  }
+  m_asyncRequestId = -1;
+  if (m_progressDialog != nullptr) {
+    bool wasCanceled = m_progressDialog->wasCanceled();
+    m_progressDialog->deleteLater();
+    m_progressDialog = nullptr;
+    if (wasCanceled) {
+      return;
+    }
+  }
+  if (ok && !m_asyncDoneMessage.isEmpty()) {
+    ScrollMessageBox::information(this, "Done", m_asyncDoneMessage);
+  } else if (!ok) {
+    ScrollMessageBox::information(this, "ERROR", tr("The operation failed."));
+  }
+}
+
 void MainWindow::createSchema()
 {
   if (!createDBWorker()) {
@@ -229,20 +348,21 @@ void MainWindow::readCSV()
     qDebug() << tr("Setting Path:(") << fileInfo.absolutePath() << ")";
     pSettings->setValue(Constants::Settings_LastCSVDirOpen, fileInfo.absolutePath());
   }
-  CSVReader reader(TypeMapper::PreferSigned | TypeMapper::PreferInt);
-  if (!reader.setStreamFromPath(fileReadPath))
+  // Allocated so that the import can take it to the worker thread.
+  QScopedPointer<CSVReader> reader(new CSVReader(TypeMapper::PreferSigned | TypeMapper::PreferInt));
+  if (!reader->setStreamFromPath(fileReadPath))
   {
     ScrollMessageBox::information(this, "ERROR", QString(tr("Read: Failed to open CSV file %1")).arg(fileReadPath));
   }
-  else if (!reader.readHeader())
+  else if (!reader->readHeader())
   {
     ScrollMessageBox::information(this, "ERROR", QString(tr("Failed to read CSV header from %1")).arg(fileReadPath));
   }
   else
   {
-    reader.readNLines(200);
-    reader.guessColumnTypes();
-    CSVReaderDialog dlg(&reader, this);
+    reader->readNLines(200);
+    reader->guessColumnTypes();
+    CSVReaderDialog dlg(reader.data(), this);
     if (dlg.exec() == QDialog::Rejected)
     {
       return;
@@ -259,12 +379,12 @@ void MainWindow::readCSV()
       }
       else
       {
-        writer.setHeader(reader.getHeader());
+        writer.setHeader(reader->getHeader());
         writer.writeHeader();
         int maxLines = 100;
-        for (int i=0; i<maxLines && reader.readNextRecord(false); ++i)
+        for (int i=0; i<maxLines && reader->readNextRecord(false); ++i)
         {
-          const CSVLine& readLine = reader.getLine(i);
+          const CSVLine& readLine = reader->getLine(i);
           CSVLine newLine;
           for (int k=0; k<readLine.size(); ++k)
           {
@@ -272,26 +392,27 @@ void MainWindow::readCSV()
             QVariant v = c.toVariant();
             newLine.append(CSVColumn(v.toString(), c.isQualified(), c.getType()));
           }
-          //writer.write(reader.getLine(i));
+          //writer.write(reader->getLine(i));
           writer.write(newLine);
         }
-        ScrollMessageBox::information(this, "INFO", reader.toString(false));
+        ScrollMessageBox::information(this, "INFO", reader->toString(false));
       }
     }
 #endif
 
     //??ScrollMessageBox::information(0, "Schema", QString("Table %1\n\n%2").arg(tableName, bigFieldString));
-    if (!createDBWorker()) {
+    if (!createAsyncDB()) {
       // An error message was probably already displayed
       ScrollMessageBox::information(this, "ERROR", tr("Failed to create or access the database."));
       return;
     }
 
-    // The previous line worked, so this should not be null.
-    if (m_db != nullptr && !m_db->loadCSV(reader, fileInfo.baseName()))
-    {
-      ScrollMessageBox::information(this, "ERROR", tr("Failed to load the CSV file into the database."));
-    }
+    // An upsert replaces rows that already exist, such as when loading a new price list.
+    bool upsert = QMessageBox::question(this, tr("Import CSV"), tr("Update rows whose id already exists?\n\nNo skips those rows.")) == QMessageBox::Yes;
+
+    // The import runs on the worker thread, which now owns the reader. loadCSV reports the result.
+    m_asyncDoneMessage.clear();
+    startAsyncRequest(m_asyncDb->loadCSV(reader.take(), fileInfo.baseName(), upsert), QString(tr("Importing %1...")).arg(fileInfo.fileName()));
   }
 }
 
@@ -333,7 +454,12 @@ void MainWindow::exportCSV()
     }
     pSettings->setValue(Constants::Settings_LastCSVDirWrite, writeDir.canonicalPath());
 
-    m_db->exportToCSV(writeDir.canonicalPath(), false);
+    if (!createAsyncDB()) {
+        return;
+    }
+    // The user agreed to overwrite the existing files.
+    m_asyncDoneMessage = tr("CSV Export Finished");
+    startAsyncRequest(m_asyncDb->exportToCSV(writeDir.canonicalPath(), true), tr("Exporting tables..."));
 }
 
 void MainWindow::exportInventoryCSV()
@@ -369,14 +495,18 @@ void MainWindow::exportInventoryCSV()
     }
     pSettings->setValue(Constants::Settings_LastCSVDirWrite, writeDir.canonicalPath());
 
-    QString sqlString = "SELECT CONCAT(country.a3, '/', catalog.scott, '/', catalogtype.name) AS scott, inventory.quantity, inventory.grade,  inventory.condition, inventory.selvage, inventory.centering, inventory.back, inventory.comment, catalog.description, catalog.facevalue, inventory.paid, bookvalues.bookvalue, inventory.valuemultiplier, inventory.certificate, inventory.purchasedate, catalog.releasedate, dealer.name AS dealer_name, stamplocation.name AS location_name, stamplocation.description AS location_description, inventory.updated , country.name AS 'country', country.a3, catalog.scott AS scott_num, catalogtype.name as type, inventory.id FROM inventory, catalog, bookvalues, country, stamplocation, valuetype, dealer, catalogtype WHERE  inventory.catalogid=catalog.id AND catalog.countryid=country.id AND inventory.dealerid=dealer.id AND stamplocation.id=inventory.locationid AND valuetype.description=inventory.grade AND bookvalues.valuetypeid=valuetype.id AND catalog.id=bookvalues.catalogid  AND catalogtype.id=catalog.typeid ORDER BY country.a3, ABS(catalog.scott), catalogtype.name";
+    const QString& sqlString = StampDB::FullInventorySql;
+    QElapsedTimer timer;
+    timer.start();
     QSqlDatabase& db = m_db->getDB();
     QSqlQuery query(db);
+    query.setForwardOnly(true);
     if (!query.exec(sqlString))
     {
         ScrollMessageBox::information(this, "ERROR", query.lastError().text());
         return;
     }
+    qDebug() << "Full inventory export query took" << timer.elapsed() << "ms";
     if (!query.isSelect()) {
         ScrollMessageBox::information(this, "ERROR", "Why is the query NOT a select? BUG!!!");
         return;
@@ -433,6 +563,7 @@ void MainWindow::exportInventoryCSV()
         writer.write(line);
     }
     writer.cleanup();
+    qDebug() << "Full inventory export took" << timer.elapsed() << "ms";
     ScrollMessageBox::information(this, "Done", "Full CSV Export Finished");
 }
 
@@ -560,22 +691,16 @@ void MainWindow::testing() {
 void MainWindow::addMissingBookValues()
 {
   if (createDBWorker()) {
-    // Get stamps with no entry in "book values"
-    QString sql = "select catalog.id from catalog left outer join bookvalues on catalog.id = bookvalues.catalogid where bookvalues.catalogid IS NULL";
-    QList<QSqlRecord> records;
-
-    // We only want the IDs, so, these fields will be ignored.
-    QString keyField;
-    QHash<int, int> keys;
-
-    if (!m_db->executeQuery(sql, records, keyField, keys)) {
+    // Count stamps with no entry in "book values"
+    int numMissing = m_db->countCatalogWithoutBookValues();
+    if (numMissing < 0) {
       QMessageBox::warning(this, tr("ERROR"), tr("Failed to execute SQL to find missing entries."));
       return;
-    } else if (records.size() < 1) {
+    } else if (numMissing < 1) {
       QMessageBox::warning(this, tr("No Records Found"), tr("No catalog entries found without values."));
       return;
     }
-    if (ScrollMessageBox::question(this, "Question", QString(tr("Add %1 stamps to the book values table?")).arg(records.size())) != QDialogButtonBox::Yes)
+    if (ScrollMessageBox::question(this, "Question", QString(tr("Add %1 stamps to the book values table?")).arg(numMissing)) != QDialogButtonBox::Yes)
     {
         return;
     }
@@ -583,30 +708,18 @@ void MainWindow::addMissingBookValues()
     // Set the sourceID based on the latest year that we have
     // select id from valuesource order by valuesource.year DESC limit 1
     int sourceId = m_db->selectValueSourceId(this);
+    if (sourceId <= 0) {
+      return;
+    }
 
-    QList<QSqlRecord> ignoredRecords;
-    int added = 0;
-    int failed = 0;
-
-    // Do the work!
-    for (int i=0; i<records.size() && failed == 0; ++i) {
-      int catalogId = records[i].value("id").toInt();
-      QString q1 = QString("INSERT INTO bookvalues (Catalogid, sourceid, valuetypeid, bookvalue) VALUES (%1, %2, 1, 0)").arg(catalogId).arg(sourceId);
-      QString q2 = QString("INSERT INTO bookvalues (Catalogid, sourceid, valuetypeid, bookvalue) VALUES (%1, %2, 2, 0)").arg(catalogId).arg(sourceId);
-      if (!m_db->executeQuery(q1, ignoredRecords, keyField, keys)) {
-        ++failed;
-        QMessageBox::warning(this, tr("ERROR"), q1);
-      } else {
-        ++added;
-        if (!m_db->executeQuery(q2, ignoredRecords, keyField, keys)) {
-          ++failed;
-          QMessageBox::warning(this, tr("ERROR"), q2);
-        } else {
-          ++added;
-        }
-      }
+    // Do the work! Value types 1 and 2 are mint and used.
+    QString errorMessage;
+    int added = m_db->addMissingBookValues(sourceId, QList<int>() << 1 << 2, errorMessage);
+    if (added < 0) {
+      QMessageBox::warning(this, tr("ERROR"), errorMessage);
+      return;
     }
-    ScrollMessageBox::question(this, "Done", QString(tr("Added %1 entries to the book values table. %2 failed.")).arg(added).arg(failed));
+    ScrollMessageBox::information(this, "Done", QString(tr("Added %1 entries to the book values table.")).arg(added));
   }
 }
 
@@ -857,7 +970,8 @@ void MainWindow::editTable()
         //GenericDataCollection* data = m_db->readTableBySchema(tableName);
 
         // This reads the table along with all linked / related tables.
-        GenericDataCollections* data = m_db->readTableWithLinks(tableName);
+        // Only the first page of the table is read, the dialog reads the rest.
+        GenericDataCollections* data = m_db->readTableWithLinks(tableName, -1, true, TablePageReader::DefaultPageSize);
         Q_ASSERT_X(data != nullptr, "MainWindow::editTable", "Returned data is null");
 
         //??ScrollMessageBox::information(this, "Supported Tables", data->getNames().join("\n"));
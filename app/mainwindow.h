@@ -18,6 +18,8 @@ namespace Ui {
 }
 
 class StampDB;
+class StampDBAsync;
+class QProgressDialog;
 
 class MainWindow : public QMainWindow
 {
@@ -45,6 +47,18 @@ public slots:
     void readCSV();
     void testing();
 
+private slots:
+    void asyncFinished(int requestId, bool ok);
+    void asyncProgress(int requestId, int done, int total, const QString& text);
+    void asyncMessage(const QString& title, const QString& text);
+
+    /*! \brief Tell open windows about the tables that the worker thread changed. */
+    void asyncTablesChanged(const QStringList& tableNames);
+    void cancelAsyncRequest();
+
+    /*! \brief Have the worker thread rebuild a snapshot that m_db found to be stale. */
+    void rebuildStaleSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList);
+
 private:
     //void setupToolBar();
 
@@ -65,6 +79,26 @@ private:
      ***************************************************************************/
     bool createDBWorker();
 
+    //**************************************************************************
+    /*! \brief Create m_asyncDb for the same database as m_db so that long operations do not freeze the window.
+     *
+     *  \return True if no other request is running and m_asyncDb is ready to use.
+     ***************************************************************************/
+    bool createAsyncDB();
+
+    //**************************************************************************
+    /*! \brief Create m_asyncDb if it does not exist, and have it upgrade the schema on the worker thread.
+     ***************************************************************************/
+    void createAsyncWorker();
+
+    //**************************************************************************
+    /*! \brief Remember the request and show a progress dialog that can cancel it.
+     *
+     *  \param [in] requestId Request returned by m_asyncDb.
+     *  \param [in] label Describes the request.
+     ***************************************************************************/
+    void startAsyncRequest(const int requestId, const QString& label);
+
     //**************************************************************************
     /*! \brief This currently does nothing.
      *
@@ -73,6 +107,18 @@ private:
 
     Ui::MainWindow *ui;
     StampDB* m_db;
+
+    /*! Runs imports and exports on a worker thread. */
+    StampDBAsync* m_asyncDb;
+
+    /*! Shows the progress of m_asyncRequestId. */
+    QProgressDialog* m_progressDialog;
+
+    /*! Request that is running, -1 if none. */
+    int m_asyncRequestId;
+
+    /*! Message shown when m_asyncRequestId finishes without an error. */
+    QString m_asyncDoneMessage;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,147 @@
+#include "memoryusage.h"
+
+#include <QLocale>
+#include <QObject>
+#include <QMetaType>
+
+Q_LOGGING_CATEGORY(memoryUsageCategory, "andy.memoryusage")
+
+MemoryUsage::MemoryUsage() : m_current(-1)
+{
+}
+
+void MemoryUsage::setComponent(const QString& name)
+{
+  m_current = m_componentNames.indexOf(name);
+  if (m_current < 0)
+  {
+    m_current = m_componentNames.size();
+    m_componentNames.append(name);
+    m_bytes.append(QList<qint64>(NumCategories, 0));
+  }
+}
+
+void MemoryUsage::add(const Category category, const qint64 bytes)
+{
+  if (m_current < 0)
+  {
+    setComponent("");
+  }
+  m_bytes[m_current][category] += bytes;
+}
+
+void MemoryUsage::addStringList(const Category category, const QStringList& list)
+{
+  add(category, listBytes(list));
+  for (int i=0; i<list.size(); ++i)
+  {
+    addString(list.at(i));
+  }
+}
+
+void MemoryUsage::addVariant(const QVariant& value)
+{
+  add(VariantPayloads, sizeof(QVariant));
+  addVariantPayload(value);
+}
+
+void MemoryUsage::addVariantPayload(const QVariant& value)
+{
+  if (!value.isValid())
+  {
+    return;
+  }
+  const int typeId = value.metaType().id();
+  if (typeId == QMetaType::QString)
+  {
+    add(StringData, stringBytes(value.toString()));
+  }
+  else if (typeId == QMetaType::QStringList)
+  {
+    addStringList(VariantPayloads, value.toStringList());
+  }
+  else if (value.metaType().sizeOf() > static_cast<int>(3 * sizeof(void*)))
+  {
+    // Too large to be stored inside of the QVariant.
+    add(VariantPayloads, value.metaType().sizeOf());
+  }
+}
+
+qint64 MemoryUsage::getBytes(const int component, const Category category) const
+{
+  return (0 <= component && component < m_bytes.size()) ? m_bytes.at(component).at(category) : 0;
+}
+
+qint64 MemoryUsage::getComponentTotal(const int component) const
+{
+  qint64 total = 0;
+  for (int category=0; category<NumCategories; ++category)
+  {
+    total += getBytes(component, static_cast<Category>(category));
+  }
+  return total;
+}
+
+qint64 MemoryUsage::getCategoryTotal(const Category category) const
+{
+  qint64 total = 0;
+  for (int component=0; component<m_bytes.size(); ++component)
+  {
+    total += m_bytes.at(component).at(category);
+  }
+  return total;
+}
+
+qint64 MemoryUsage::getTotal() const
+{
+  qint64 total = 0;
+  for (int component=0; component<m_bytes.size(); ++component)
+  {
+    total += getComponentTotal(component);
+  }
+  return total;
+}
+
+void MemoryUsage::log() const
+{
+  for (int component=0; component<m_componentNames.size(); ++component)
+  {
+    QStringList parts;
+    for (int category=0; category<NumCategories; ++category)
+    {
+      parts << QString("%1=%2").arg(getCategoryName(static_cast<Category>(category)), formatBytes(getBytes(component, static_cast<Category>(category))));
+    }
+    qCDebug(memoryUsageCategory) << m_componentNames.at(component) << formatBytes(getComponentTotal(component)) << parts.join(", ");
+  }
+  qCDebug(memoryUsageCategory) << "Total" << formatBytes(getTotal());
+}
+
+QString MemoryUsage::getCategoryName(const Category category)
+{
+  switch (category)
+  {
+  case RowObjects :
+    return QObject::tr("Row objects");
+  case VariantPayloads :
+    return QObject::tr("Variant payloads");
+  case StringData :
+    return QObject::tr("String data");
+  case IndexStructures :
+    return QObject::tr("Index structures");
+  case CacheEntries :
+    return QObject::tr("Cache entries");
+  case NumCategories :
+    break;
+  }
+  return "";
+}
+
+QString MemoryUsage::formatBytes(const qint64 bytes)
+{
+  return QLocale().formattedDataSize(bytes);
+}
+
+qint64 MemoryUsage::stringBytes(const QString& s)
+{
+  return s.isNull() ? 0 : static_cast<qint64>(sizeof(QArrayData)) + static_cast<qint64>(s.capacity() + 1) * static_cast<qint64>(sizeof(QChar));
+}
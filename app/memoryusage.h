@@ -0,0 +1,155 @@
+#ifndef MEMORYUSAGE_H
+#define MEMORYUSAGE_H
+
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QLoggingCategory>
+
+#include "chunkedlist.h"
+
+Q_DECLARE_LOGGING_CATEGORY(memoryUsageCategory)
+
+//**************************************************************************
+/*! \class MemoryUsage
+ * \brief Approximate heap bytes held by in memory structures, by component and by category.
+ *
+ * Each structure that supports reporting has an addMemoryUsage method that walks the
+ * structure and adds to the current component. Set the component before walking:
+ *
+ * \code
+ * MemoryUsage usage;
+ * usage.setComponent("inventory");
+ * collection->addMemoryUsage(usage);
+ * usage.log();
+ * \endcode
+ *
+ * Values are estimates based on the container capacities and element sizes; allocator
+ * overhead is ignored. Implicitly shared data is counted once for each owner, so the
+ * total can be larger than what is really used.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class MemoryUsage
+{
+public:
+  /*! \brief What the memory is used for. */
+  enum Category { RowObjects, VariantPayloads, StringData, IndexStructures, CacheEntries, NumCategories };
+
+  MemoryUsage();
+
+  /*! \brief Select the component to which bytes are added, it is created if needed.
+   *  \param [in] name Component name such as a table name.
+   */
+  void setComponent(const QString& name);
+
+  /*! \brief Add bytes to a category for the current component.
+   *  \param [in] category Category of the memory.
+   *  \param [in] bytes Number of bytes.
+   */
+  void add(const Category category, const qint64 bytes);
+
+  /*! \brief Add the character data for a string as StringData. */
+  void addString(const QString& s) { add(StringData, stringBytes(s)); }
+
+  /*! \brief Add a string list; the list as the container category and the characters as StringData.
+   *  \param [in] category Category for the list itself.
+   *  \param [in] list List of interest.
+   */
+  void addStringList(const Category category, const QStringList& list);
+
+  /*! \brief Add a QVariant that is not already counted as part of a container, and its payload. */
+  void addVariant(const QVariant& value);
+
+  /*! \brief Add only the data that a QVariant holds outside of itself; strings are StringData and the rest is VariantPayloads. */
+  void addVariantPayload(const QVariant& value);
+
+  /*! \return Number of components. */
+  int getComponentCount() const { return m_componentNames.size(); }
+
+  /*! \return Name of the component at the index. */
+  QString getComponentName(const int i) const { return m_componentNames.value(i); }
+
+  /*! \return Bytes for a component and category. */
+  qint64 getBytes(const int component, const Category category) const;
+
+  /*! \return Bytes for every category in a component. */
+  qint64 getComponentTotal(const int component) const;
+
+  /*! \return Bytes for a category in every component. */
+  qint64 getCategoryTotal(const Category category) const;
+
+  /*! \return Bytes for everything. */
+  qint64 getTotal() const;
+
+  /*! \brief Write one line per component and a total to the memoryUsageCategory debug log. */
+  void log() const;
+
+  /*! \return Display name for a category. */
+  static QString getCategoryName(const Category category);
+
+  /*! \return Bytes formatted for display such as "1.5 MiB". */
+  static QString formatBytes(const qint64 bytes);
+
+  /*! \return Heap bytes for the characters in a string; 0 for a null string. */
+  static qint64 stringBytes(const QString& s);
+
+  /*! \return Heap bytes for the elements of a list, not including what the elements point to. */
+  template <class T> static qint64 listBytes(const QList<T>& list);
+
+  /*! \return Heap bytes for the chunk list and the elements of each chunk, not including what the elements point to. */
+  template <class T> static qint64 listBytes(const ChunkedList<T>& list);
+
+  /*! \return Heap bytes for the entries and buckets of a hash, not including what the entries point to. */
+  template <class K, class V> static qint64 hashBytes(const QHash<K, V>& hash);
+
+  /*! \return Heap bytes for the entries and buckets of a set, not including what the entries point to. */
+  template <class T> static qint64 setBytes(const QSet<T>& set);
+
+private:
+  QStringList m_componentNames;
+
+  /*! \brief Bytes per category for each component. */
+  QList<QList<qint64> > m_bytes;
+
+  /*! \brief Index of the component that receives added bytes. */
+  int m_current;
+};
+
+template <class T>
+inline qint64 MemoryUsage::listBytes(const QList<T>& list)
+{
+  return (list.capacity() > 0) ? static_cast<qint64>(sizeof(QArrayData)) + static_cast<qint64>(list.capacity()) * static_cast<qint64>(sizeof(T)) : 0;
+}
+
+template <class T>
+inline qint64 MemoryUsage::listBytes(const ChunkedList<T>& list)
+{
+  qint64 bytes = listBytes(list.chunks());
+  for (int i=0; i<list.chunkCount(); ++i)
+  {
+    bytes += listBytes(list.chunk(i));
+  }
+  return bytes;
+}
+
+template <class K, class V>
+inline qint64 MemoryUsage::hashBytes(const QHash<K, V>& hash)
+{
+  // Entries plus a one byte offset per bucket.
+  return static_cast<qint64>(hash.size()) * static_cast<qint64>(sizeof(K) + sizeof(V)) + static_cast<qint64>(hash.capacity());
+}
+
+template <class T>
+inline qint64 MemoryUsage::setBytes(const QSet<T>& set)
+{
+  // Same layout as a hash with an empty value.
+  return static_cast<qint64>(set.size()) * static_cast<qint64>(sizeof(T)) + static_cast<qint64>(set.capacity());
+}
+
+#endif // MEMORYUSAGE_H
@@ -0,0 +1,68 @@
+#include "memoryusagedialog.h"
+
+#include <QVBoxLayout>
+#include <QTableWidget>
+#include <QTableWidgetItem>
+#include <QHeaderView>
+#include <QLabel>
+#include <QDialogButtonBox>
+
+MemoryUsageDialog::MemoryUsageDialog(const MemoryUsage& usage, QWidget *parent) :
+  QDialog(parent), m_usage(usage), m_table(nullptr)
+{
+  setWindowTitle(tr("Memory Usage"));
+  buildDialog();
+}
+
+void MemoryUsageDialog::buildDialog()
+{
+  const int numComponents = m_usage.getComponentCount();
+  const int numCategories = MemoryUsage::NumCategories;
+
+  m_table = new QTableWidget(numComponents + 1, numCategories + 1);
+  QStringList headers;
+  for (int category=0; category<numCategories; ++category)
+  {
+    headers << MemoryUsage::getCategoryName(static_cast<MemoryUsage::Category>(category));
+  }
+  headers << tr("Total");
+  m_table->setHorizontalHeaderLabels(headers);
+
+  QStringList rowNames;
+  for (int component=0; component<numComponents; ++component)
+  {
+    rowNames << m_usage.getComponentName(component);
+    for (int category=0; category<numCategories; ++category)
+    {
+      setCell(component, category, m_usage.getBytes(component, static_cast<MemoryUsage::Category>(category)));
+    }
+    setCell(component, numCategories, m_usage.getComponentTotal(component));
+  }
+  rowNames << tr("Total");
+  for (int category=0; category<numCategories; ++category)
+  {
+    setCell(numComponents, category, m_usage.getCategoryTotal(static_cast<MemoryUsage::Category>(category)));
+  }
+  setCell(numComponents, numCategories, m_usage.getTotal());
+  m_table->setVerticalHeaderLabels(rowNames);
+  m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  m_table->resizeColumnsToContents();
+
+  QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal);
+  connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+
+  QVBoxLayout *vLayout = new QVBoxLayout();
+  vLayout->addWidget(new QLabel(tr("Estimated bytes; shared data is counted once for each owner.")));
+  vLayout->addWidget(m_table);
+  vLayout->addWidget(buttonBox);
+  setLayout(vLayout);
+  resize(m_table->horizontalHeader()->length() + m_table->verticalHeader()->width() + 40, 400);
+}
+
+void MemoryUsageDialog::setCell(const int row, const int col, const qint64 bytes)
+{
+  QTableWidgetItem* item = new QTableWidgetItem(MemoryUsage::formatBytes(bytes));
+  item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  item->setToolTip(QString::number(bytes));
+  m_table->setItem(row, col, item);
+}
@@ -0,0 +1,42 @@
+#ifndef MEMORYUSAGEDIALOG_H
+#define MEMORYUSAGEDIALOG_H
+
+#include "memoryusage.h"
+
+#include <QDialog>
+
+class QTableWidget;
+
+//**************************************************************************
+/*! \class MemoryUsageDialog
+ *
+ * \brief Show a memory usage report as a table; a row per component and a column per category, with totals.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ ***************************************************************************/
+class MemoryUsageDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  //**************************************************************************
+  /*! \brief Constructor
+   *
+   *  \param [in] usage Report to show; it is copied.
+   *  \param [in] parent The object's owner. The parent's destructor destroys this object.
+   ***************************************************************************/
+  explicit MemoryUsageDialog(const MemoryUsage& usage, QWidget *parent = nullptr);
+
+private:
+  /*! \brief Create the table and fill it from the report. */
+  void buildDialog();
+
+  /*! \brief Set a right aligned, read-only cell. */
+  void setCell(const int row, const int col, const qint64 bytes);
+
+  MemoryUsage m_usage;
+  QTableWidget* m_table;
+};
+
+#endif // MEMORYUSAGEDIALOG_H
@@ -0,0 +1,183 @@
+#include "preparedquerycache.h"
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QMutexLocker>
+#include <QStringView>
+
+PreparedQueryCache::PreparedQueryCache(const int capacity) : m_capacity(qMax(2, capacity))
+{
+}
+
+PreparedQueryCache::~PreparedQueryCache()
+{
+  clear();
+}
+
+QSharedPointer<QSqlQuery> PreparedQueryCache::prepare(QSqlDatabase& db, const QString& sql, QString& errorMessage)
+{
+  const QString key = normalize(sql);
+  const QString connectionName = db.connectionName();
+  {
+    QMutexLocker locker(&m_mutex);
+    ConnectionQueries* connection = m_connections.value(connectionName, nullptr);
+    QSqlQuery* query = (connection != nullptr) ? connection->m_queries.value(key, nullptr) : nullptr;
+    if (query != nullptr && !connection->m_checkedOut.contains(key))
+    {
+      connection->m_order.removeOne(key);
+      connection->m_order.append(key);
+      connection->m_checkedOut.insert(key);
+      return QSharedPointer<QSqlQuery>(query, [this, connectionName, key](QSqlQuery* q) { release(connectionName, key, q); });
+    }
+  }
+
+  // The original SQL is prepared; a "--" comment may depend on its new line.
+  QSqlQuery* query = new QSqlQuery(db);
+  if (!query->prepare(sql))
+  {
+    errorMessage = QString("SQL: %1\n\nError:\n%2").arg(sql, query->lastError().text());
+    delete query;
+    return QSharedPointer<QSqlQuery>();
+  }
+
+  QMutexLocker locker(&m_mutex);
+  ConnectionQueries* connection = m_connections.value(connectionName, nullptr);
+  if (connection == nullptr)
+  {
+    connection = new ConnectionQueries();
+    m_connections.insert(connectionName, connection);
+  }
+  if (connection->m_queries.contains(key))
+  {
+    // The cached query is in use, so this one is only used once.
+    return QSharedPointer<QSqlQuery>(query);
+  }
+  connection->m_queries.insert(key, query);
+  connection->m_order.append(key);
+  connection->m_checkedOut.insert(key);
+  evictLocked(connection);
+  return QSharedPointer<QSqlQuery>(query, [this, connectionName, key](QSqlQuery* q) { release(connectionName, key, q); });
+}
+
+void PreparedQueryCache::release(const QString& connectionName, const QString& key, QSqlQuery* query)
+{
+  QMutexLocker locker(&m_mutex);
+  ConnectionQueries* connection = m_connections.value(connectionName, nullptr);
+  if (connection == nullptr || connection->m_queries.value(key, nullptr) != query)
+  {
+    // The connection was cleared while the query was in use.
+    delete query;
+    return;
+  }
+  query->finish();
+  connection->m_checkedOut.remove(key);
+  evictLocked(connection);
+}
+
+void PreparedQueryCache::evictLocked(ConnectionQueries* connection)
+{
+  for (int i=0; i<connection->m_order.size() && connection->m_order.size() > m_capacity; )
+  {
+    const QString key = connection->m_order.at(i);
+    if (connection->m_checkedOut.contains(key))
+    {
+      ++i;
+    }
+    else
+    {
+      connection->m_order.removeAt(i);
+      delete connection->m_queries.take(key);
+    }
+  }
+}
+
+QString PreparedQueryCache::normalize(const QString& sql)
+{
+  const QString trimmed = sql.trimmed();
+  QString normalized;
+  normalized.reserve(trimmed.size());
+  QChar quote;
+  bool lastWasSpace = false;
+  for (int i=0; i<trimmed.size(); ++i)
+  {
+    const QChar c = trimmed.at(i);
+    if (!quote.isNull())
+    {
+      // A doubled quote inside of a quoted string ends and restarts the quote, which is still correct.
+      if (c == quote)
+      {
+        quote = QChar();
+      }
+      normalized.append(c);
+    }
+    else if (c == '-' && i + 1 < trimmed.size() && trimmed.at(i + 1) == '-')
+    {
+      // Copy the comment and the new line that ends it.
+      int endOfLine = trimmed.indexOf('\n', i);
+      if (endOfLine < 0)
+      {
+        endOfLine = trimmed.size();
+      }
+      normalized.append(QStringView(trimmed).mid(i, endOfLine - i));
+      normalized.append('\n');
+      i = endOfLine;
+      lastWasSpace = true;
+      continue;
+    }
+    else if (c.isSpace())
+    {
+      if (!lastWasSpace)
+      {
+        normalized.append(' ');
+      }
+      lastWasSpace = true;
+      continue;
+    }
+    else
+    {
+      if (c == '\'' || c == '"')
+      {
+        quote = c;
+      }
+      normalized.append(c);
+    }
+    lastWasSpace = false;
+  }
+  return normalized;
+}
+
+void PreparedQueryCache::clear(const QString& connectionName)
+{
+  QMutexLocker locker(&m_mutex);
+  clearLocked(connectionName);
+}
+
+void PreparedQueryCache::clear()
+{
+  QMutexLocker locker(&m_mutex);
+  QStringList connectionNames = m_connections.keys();
+  for (int i=0; i<connectionNames.size(); ++i)
+  {
+    clearLocked(connectionNames.at(i));
+  }
+}
+
+void PreparedQueryCache::clearLocked(const QString& connectionName)
+{
+  ConnectionQueries* connection = m_connections.take(connectionName);
+  if (connection != nullptr)
+  {
+    QHashIterator<QString, QSqlQuery*> it(connection->m_queries);
+    while (it.hasNext())
+    {
+      it.next();
+      // A query that is in use is deleted when its handle is released.
+      if (!connection->m_checkedOut.contains(it.key()))
+      {
+        delete it.value();
+      }
+    }
+    delete connection;
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef PREPAREDQUERYCACHE_H
+#define PREPAREDQUERYCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class QSqlDatabase;
+class QSqlQuery;
+
+//**************************************************************************
+/*! \class PreparedQueryCache
+ * \brief Least recently used cache of prepared queries for each database connection.
+ *
+ * SQLite parses and plans a statement when it is prepared. Statements such as
+ * "UPDATE inventory SET paid=:paid WHERE id=:id" are run once per change, so
+ * preparing once and binding new values each time saves most of the work.
+ *
+ * Queries are keyed by the connection name and the SQL with its white space
+ * normalized. Each connection has its own list, so evicting a query never
+ * touches a query from another connection (and another thread).
+ *
+ * A returned query is checked out until the last copy of the handle is released,
+ * which finishes the query so that SQLite releases its read lock and returns it
+ * to the cache. A query that is checked out is never evicted or reset; asking for
+ * the same SQL while it is in use, such as from a nested call, prepares another
+ * query that is not cached. Release the handles before a connection is closed.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class PreparedQueryCache
+{
+public:
+  /*! \brief Number of queries kept for each connection unless told otherwise. */
+  static const int DefaultCapacity = 32;
+
+  /*! \brief Constructor
+   *  \param [in] capacity Maximum number of queries kept for each connection, at least two.
+   */
+  explicit PreparedQueryCache(const int capacity = DefaultCapacity);
+
+  /*! \brief Destructor deletes every query. */
+  ~PreparedQueryCache();
+
+  /*! \brief Get a prepared query for the SQL, preparing it if it is not cached.
+   *
+   *  The query is ready to bind values and execute.
+   *
+   *  \param [in] db Connection on which the query runs.
+   *  \param [in] sql SQL to prepare, may contain named placeholders such as ":id".
+   *  \param [out] errorMessage Set if the SQL cannot be prepared.
+   *  \return Handle that checks the query out until it is released, or null if the SQL cannot be prepared.
+   */
+  QSharedPointer<QSqlQuery> prepare(QSqlDatabase& db, const QString& sql, QString& errorMessage);
+
+  /*! \brief Delete every query for a connection; a query that is checked out is deleted when it is released.
+   *  \param [in] connectionName Name of the connection.
+   */
+  void clear(const QString& connectionName);
+
+  /*! \brief Delete every query for every connection. */
+  void clear();
+
+  /*! \brief Trim the SQL and collapse each run of white space outside of quotes to a single space.
+   *
+   *  A "--" comment keeps the new line that ends it, so SQL after the comment is not part of the comment.
+   *
+   *  \param [in] sql SQL text.
+   *  \return Normalized SQL, which is only used as the key; the SQL is prepared as it was given.
+   */
+  static QString normalize(const QString& sql);
+
+private:
+  Q_DISABLE_COPY(PreparedQueryCache)
+
+  /*! \brief Queries for one connection with the least recently used SQL first. */
+  class ConnectionQueries
+  {
+  public:
+    QHash<QString, QSqlQuery*> m_queries;
+    QStringList m_order;
+    /*! Keys of the queries that are in use. */
+    QSet<QString> m_checkedOut;
+  };
+
+  /*! \brief Called when the last handle for a cached query is released. */
+  void release(const QString& connectionName, const QString& key, QSqlQuery* query);
+
+  /*! \brief Delete the least recently used queries that are not in use until there are at most m_capacity; the mutex must be held. */
+  void evictLocked(ConnectionQueries* connection);
+
+  /*! \brief Delete the queries and the entry for a connection; the mutex must be held. */
+  void clearLocked(const QString& connectionName);
+
+  int m_capacity;
+
+  /*! \brief Keyed by connection name. */
+  QHash<QString, ConnectionQueries*> m_connections;
+
+  /*! \brief Guards m_connections and the queries; connections are used from reader threads. */
+  QMutex m_mutex;
+};
+
+#endif // PREPAREDQUERYCACHE_H
@@ -3,6 +3,7 @@
 #include "stampdb.h"
 #include "scrollmessagebox.h"
 #include "globals.h"
+#include "sqlqueryresultmodel.h"
 
 #include <QDialogButtonBox>
 #include <QPushButton>
@@ -10,15 +11,33 @@
 #include <QPlainTextEdit>
 #include <QSettings>
 #include <QStatusBar>
-#include <QTableWidget>
+#include <QTableView>
+#include <QHeaderView>
+#include <QFontMetrics>
 #include <QTextCursor>
 #include <QTextBlock>
+#include <QScopedPointer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLabel>
+#include <QRegularExpression>
+#include <QSplitter>
+#include <QSqlError>
 #include <QSqlQuery>
 #include <QSqlRecord>
-#include <QScopedPointer>
+#include <QTextStream>
+#include <QTreeWidget>
+#include <QTreeWidgetItem>
+#include <QHash>
+#include <QMap>
+#include <QBrush>
+#include <QDebug>
 
 SQLDialog::SQLDialog(StampDB &db, QWidget *parent) :
-  QDialog(parent), m_db(db), m_textEdit(nullptr), m_tableWidget(nullptr), m_statusBar(nullptr)
+  QDialog(parent), m_db(db), m_textEdit(nullptr), m_tableView(nullptr), m_resultModel(nullptr), m_loadMoreButton(nullptr),
+  m_suggestIndexButton(nullptr), m_timingLabel(nullptr), m_planTree(nullptr), m_statusBar(nullptr), m_loggedSessionHeader(false)
 {
 
   QScopedPointer<QSettings> pSettings(getQSettings());
@@ -47,13 +66,49 @@ SQLDialog::SQLDialog(StampDB &db, QWidget *parent) :
   QPushButton* sqlExecuteButton = new QPushButton(tr("&Execute SQL"));
   buttonBox->addButton(sqlExecuteButton, QDialogButtonBox::ActionRole);
 
+  m_loadMoreButton = new QPushButton(tr("Load &More"));
+  m_loadMoreButton->setEnabled(false);
+  buttonBox->addButton(m_loadMoreButton, QDialogButtonBox::ActionRole);
+
+  m_suggestIndexButton = new QPushButton(tr("Suggest &Index"));
+  m_suggestIndexButton->setEnabled(false);
+  buttonBox->addButton(m_suggestIndexButton, QDialogButtonBox::ActionRole);
+
   connect(sqlExecuteButton, SIGNAL(clicked()), this, SLOT(sqlButtonPressed()));
+  connect(m_loadMoreButton, SIGNAL(clicked()), this, SLOT(loadMoreButtonPressed()));
+  connect(m_suggestIndexButton, SIGNAL(clicked()), this, SLOT(suggestIndexButtonPressed()));
   //connect(buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
   connect(buttonBox, SIGNAL(rejected()), this, SLOT(closeButtonPressed()));
   vBox->addWidget(buttonBox);
 
-  m_tableWidget = new QTableWidget(1, 1);
-  vBox->addWidget(m_tableWidget);
+  // Rows are read as the view scrolls, so a large result does not create an item for every cell.
+  m_resultModel = new SqlQueryResultModel(this);
+  m_tableView = new QTableView();
+  m_tableView->setModel(m_resultModel);
+  m_tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+
+  // Timings and the query plan for the last statement.
+  QWidget* planPane = new QWidget();
+  QVBoxLayout* planBox = new QVBoxLayout();
+  planBox->setContentsMargins(0, 0, 0, 0);
+  m_timingLabel = new QLabel();
+  m_timingLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+  planBox->addWidget(m_timingLabel);
+  m_planTree = new QTreeWidget();
+  m_planTree->setHeaderLabels(QStringList() << tr("Query Plan"));
+  planBox->addWidget(m_planTree);
+  planPane->setLayout(planBox);
+
+  QSplitter* splitter = new QSplitter(Qt::Vertical);
+  splitter->addWidget(m_tableView);
+  splitter->addWidget(planPane);
+  splitter->setStretchFactor(0, 3);
+  splitter->setStretchFactor(1, 1);
+  vBox->addWidget(splitter);
+  connect(m_resultModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(updateStatus()));
+  // The last page may be empty, so no rows are inserted when reading stops.
+  connect(m_resultModel, SIGNAL(readingStopped()), this, SLOT(updateStatus()));
+  connect(m_resultModel, SIGNAL(readingStopped()), this, SLOT(readingStopped()));
 
   m_statusBar = new QStatusBar();
   vBox->addWidget(m_statusBar);
@@ -104,72 +159,267 @@ void SQLDialog::sqlButtonPressed()
 
 void SQLDialog::executeSql(const QString& sqlString)
 {
-  QSqlDatabase& db = m_db.getDB();
-  QSqlQuery query(db);
-  if (!query.exec(sqlString))
+  m_lastSql = sqlString;
+
+  // Explain first, the statement may change the tables.
+  showQueryPlan(sqlString);
+
+  QString errorMessage;
+  if (!m_resultModel->setQuery(m_db.getDB(), sqlString, errorMessage))
+  {
+    m_loadMoreButton->setEnabled(false);
+    m_timingLabel->clear();
+    m_statusBar->showMessage(errorMessage);
+    return;
+  }
+
+  if (m_resultModel->isSelect())
   {
-    m_statusBar->showMessage(query.lastError().text());
+    // Measure a sample rather than resizeColumnsToContents, which looks at every row.
+    QFontMetrics metrics(m_tableView->font());
+    const int maxWidth = metrics.horizontalAdvance(QLatin1Char('M')) * MaxColumnWidthChars;
+    for (int col=0; col<m_resultModel->columnCount(); ++col)
+    {
+      m_tableView->setColumnWidth(col, qMin(maxWidth, m_resultModel->estimateColumnWidth(col, metrics, ColumnWidthSampleRows)));
+    }
+    updateStatus();
   }
   else
   {
-    if (query.isSelect())
+    m_loadMoreButton->setEnabled(false);
+    m_timingLabel->setText(timingText());
+    logTimings(sqlString);
+    // Windows that show the changed tables can bring them up to date.
+    m_db.notifyTablesChanged(m_db.getTablesChangedBy(sqlString), this);
+    int numAffected = m_resultModel->getNumRowsAffected();
+    if (numAffected >= 0)
     {
-      if (m_tableWidget == nullptr)
-      {
-        m_statusBar->showMessage(tr("Select not displayed because table widget is null"));
-      }
-      else
-      {
-        QSqlRecord rec = query.record();
+      m_statusBar->showMessage(QString(tr("Successful query with %1 rows arrected")).arg(numAffected));
+    }
+    else
+    {
+      m_statusBar->showMessage(QString(tr("Successful query!")));
+    }
+  }
+}
 
-        int numCols = rec.count();
-        int numRows = query.size() + 1;
+void SQLDialog::loadMoreButtonPressed()
+{
+  m_resultModel->raiseRowCap();
+  updateStatus();
+}
 
-        m_tableWidget->clear();
-        m_tableWidget->setColumnCount(numCols);
-        m_tableWidget->setRowCount(numRows);
+void SQLDialog::readingStopped()
+{
+  // Logged once the rows are read so that the fetch time covers every row.
+  logTimings(m_lastSql);
+}
 
-        QStringList fieldNames;
-        int i;
-        for (i=0; i<rec.count(); ++i)
-        {
-          fieldNames << rec.fieldName(i);
-        }
-        m_tableWidget->setHorizontalHeaderLabels(fieldNames);
+void SQLDialog::updateStatus()
+{
+  if (!m_resultModel->isSelect())
+  {
+    return;
+  }
+  m_loadMoreButton->setEnabled(m_resultModel->isCapped());
+  m_timingLabel->setText(timingText());
+  if (m_resultModel->atEnd())
+  {
+    m_statusBar->showMessage(QString(tr("Read %1 records")).arg(m_resultModel->rowCount()));
+  }
+  else
+  {
+    m_statusBar->showMessage(QString(tr("Read %1 records, stopped at the limit; use Load More for more")).arg(m_resultModel->rowCount()));
+  }
+}
+
+void SQLDialog::showQueryPlan(const QString& sqlString)
+{
+  m_planTree->clear();
+  m_scannedTables.clear();
+  m_suggestIndexButton->setEnabled(false);
+
+  QSqlQuery query(m_db.getDB());
+  query.setForwardOnly(true);
+  if (!query.exec("EXPLAIN QUERY PLAN " + sqlString))
+  {
+    // Not every statement can be explained; that is not an error for the statement itself.
+    qDebug() << "No query plan: " << query.lastError().text();
+    return;
+  }
+
+  // SQLite 3.24 and later return id, parent, notused, detail; earlier versions do not have a parent.
+  const QSqlRecord rec = query.record();
+  const int idCol = rec.indexOf("id");
+  const int parentCol = rec.indexOf("parent");
+  const int detailCol = rec.indexOf("detail");
+  if (detailCol < 0)
+  {
+    return;
+  }
+
+  const QStringList tableNames = m_db.getDB().tables();
+  QRegularExpression scanRegExp("^SCAN (?:TABLE )?(\\w+)(?: AS (\\w+))?");
+  QHash<int, QTreeWidgetItem*> items;
+  while (query.next())
+  {
+    const QString detail = query.value(detailCol).toString();
+    QTreeWidgetItem* parentItem = (parentCol >= 0) ? items.value(query.value(parentCol).toInt(), nullptr) : nullptr;
+    QTreeWidgetItem* item = (parentItem != nullptr) ? new QTreeWidgetItem(parentItem) : new QTreeWidgetItem(m_planTree);
+    item->setText(0, detail);
+    if (idCol >= 0)
+    {
+      items.insert(query.value(idCol).toInt(), item);
+    }
 
-        int row=0;
-        while (query.isActive() && query.next())
+    // A scan that uses an index, or the rowid, is not a full table scan.
+    QRegularExpressionMatch match = scanRegExp.match(detail);
+    if (match.hasMatch() && !detail.contains(" INDEX ") && !detail.contains("INTEGER PRIMARY KEY"))
+    {
+      QString tableName = resolveTableName(match.captured(1), sqlString);
+      if (!tableName.isEmpty() && tableNames.contains(tableName, Qt::CaseInsensitive))
+      {
+        item->setForeground(0, QBrush(Qt::red));
+        item->setToolTip(0, tr("Full table scan"));
+        if (!m_scannedTables.contains(tableName, Qt::CaseInsensitive))
         {
-          for (int col=0; col<numCols; ++col)
-          {
-            QTableWidgetItem *newItem = new  QTableWidgetItem(query.value(col).toString());
-            if (numRows <= row)
-            {
-              numRows = row + 1;
-              m_tableWidget->setRowCount(numRows);
-            }
-            m_tableWidget->setItem(row, col, newItem);
-          }
-          ++row;
-          //ScrollMessageBox::information(this, "Got a row!", QString("Have row %1 and size is %2").arg(row).arg(query.size()));
+          m_scannedTables << tableName;
         }
-        m_tableWidget->resizeColumnsToContents();
-        m_statusBar->showMessage(QString(tr("Read %1 records")).arg(row));
       }
     }
-    else
+    else if (detail.contains("USE TEMP B-TREE"))
+    {
+      item->setForeground(0, QBrush(Qt::darkYellow));
+      item->setToolTip(0, tr("Temporary b-tree, an index may avoid the sort"));
+    }
+  }
+  m_planTree->expandAll();
+  m_suggestIndexButton->setEnabled(!m_scannedTables.isEmpty());
+}
+
+QString SQLDialog::resolveTableName(const QString& name, const QString& sqlString) const
+{
+  const QStringList tableNames = m_db.getDB().tables();
+  for (int i=0; i<tableNames.size(); ++i)
+  {
+    if (tableNames.at(i).compare(name, Qt::CaseInsensitive) == 0)
+    {
+      return tableNames.at(i);
+    }
+  }
+
+  // Newer versions of SQLite show the alias rather than the table.
+  QRegularExpression aliasRegExp(QString("(\\w+)\\s+(?:AS\\s+)?%1\\b").arg(QRegularExpression::escape(name)), QRegularExpression::CaseInsensitiveOption);
+  QRegularExpressionMatchIterator it = aliasRegExp.globalMatch(sqlString);
+  while (it.hasNext())
+  {
+    const QString candidate = it.next().captured(1);
+    for (int i=0; i<tableNames.size(); ++i)
+    {
+      if (tableNames.at(i).compare(candidate, Qt::CaseInsensitive) == 0)
+      {
+        return tableNames.at(i);
+      }
+    }
+  }
+  return "";
+}
+
+void SQLDialog::suggestIndexButtonPressed()
+{
+  // Only look after FROM so that the selected columns are not used.
+  int fromPos = m_lastSql.indexOf(QRegularExpression("\\bFROM\\b", QRegularExpression::CaseInsensitiveOption));
+  const QString filterText = (fromPos >= 0) ? m_lastSql.mid(fromPos) : m_lastSql;
+
+  QStringList statements;
+  for (int i=0; i<m_scannedTables.size(); ++i)
+  {
+    const QString& tableName = m_scannedTables.at(i);
+    QSqlRecord rec = m_db.getDB().record(tableName);
+
+    // Columns that the statement names, in the order it names them; id already has an index.
+    QMap<int, QString> columnsByPosition;
+    for (int col=0; col<rec.count(); ++col)
     {
-      int numAffected = query.numRowsAffected();
-      if (numAffected >= 0)
+      const QString fieldName = rec.fieldName(col);
+      if (fieldName.compare("id", Qt::CaseInsensitive) == 0)
       {
-        m_statusBar->showMessage(QString(tr("Successful query with %1 rows arrected")).arg(numAffected));
+        continue;
       }
-      else
+      QRegularExpressionMatch match = QRegularExpression(QString("\\b%1\\b").arg(QRegularExpression::escape(fieldName)), QRegularExpression::CaseInsensitiveOption).match(filterText);
+      if (match.hasMatch())
       {
-        m_statusBar->showMessage(QString(tr("Successful query!")));
+        columnsByPosition.insert(match.capturedStart(), fieldName);
       }
     }
-    // Handle things here!
+    if (!columnsByPosition.isEmpty())
+    {
+      const QStringList columns = columnsByPosition.values();
+      statements << QString("CREATE INDEX IF NOT EXISTS idx_%1_%2 ON %1(%3);").arg(tableName, columns.join("_"), columns.join(", "));
+    }
+  }
+
+  if (statements.isEmpty())
+  {
+    ScrollMessageBox::information(this, tr("Suggest Index"), tr("The query does not name a column that an index could use."));
+    return;
+  }
+
+  // Add the statements and place the cursor on the first one so that Execute SQL runs it.
+  m_textEdit->appendPlainText(statements.join("\n"));
+  QTextCursor cursor(m_textEdit->document()->findBlockByNumber(m_textEdit->document()->blockCount() - statements.size()));
+  m_textEdit->setTextCursor(cursor);
+  m_textEdit->setFocus();
+}
+
+QString SQLDialog::timingText() const
+{
+  const double prepareMs = m_resultModel->getPrepareTime() / 1000000.0;
+  const double execMs = m_resultModel->getExecTime() / 1000000.0;
+  const double fetchMs = m_resultModel->getFetchTime() / 1000000.0;
+  QString text = QString(tr("Prepare %1 ms, execute %2 ms, fetch %3 ms")).arg(prepareMs, 0, 'f', 3).arg(execMs, 0, 'f', 3).arg(fetchMs, 0, 'f', 3);
+  if (m_resultModel->isSelect() && execMs + fetchMs > 0.0)
+  {
+    const double rowsPerSecond = m_resultModel->rowCount() * 1000.0 / (execMs + fetchMs);
+    text += QString(tr(", %1 rows at %2 rows/s")).arg(m_resultModel->rowCount()).arg(rowsPerSecond, 0, 'f', 0);
   }
+  return text;
+}
+
+QString SQLDialog::timingLogPath()
+{
+  // Kept next to the settings file.
+  QScopedPointer<QSettings> pSettings(getQSettings());
+  return QFileInfo(pSettings->fileName()).absoluteDir().filePath("sqltimings.log");
 }
 
+void SQLDialog::logTimings(const QString& sqlString)
+{
+  const QString path = timingLogPath();
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+  {
+    qDebug() << "Unable to write the timing log " << path;
+    return;
+  }
+
+  // One tab separated line per statement so that two sessions can be compared with diff.
+  QTextStream out(&file);
+  if (!m_loggedSessionHeader)
+  {
+    out << "# session " << QDateTime::currentDateTime().toString(Qt::ISODate) << '\t' << m_db.pathToDB() << '\n';
+    out << "# prepare_ms\texec_ms\tfetch_ms\trows\trows_per_s\tstopped_at\tfull_scans\tsql\n";
+    m_loggedSessionHeader = true;
+  }
+  const double prepareMs = m_resultModel->getPrepareTime() / 1000000.0;
+  const double execMs = m_resultModel->getExecTime() / 1000000.0;
+  const double fetchMs = m_resultModel->getFetchTime() / 1000000.0;
+  const int numRows = m_resultModel->isSelect() ? m_resultModel->rowCount() : m_resultModel->getNumRowsAffected();
+  const double rowsPerSecond = (numRows > 0 && execMs + fetchMs > 0.0) ? numRows * 1000.0 / (execMs + fetchMs) : 0.0;
+  // A capped read is not every row, so it is not comparable to one that reached the end.
+  const QString stoppedAt = !m_resultModel->isSelect() ? QString("-") : (m_resultModel->atEnd() ? QString("end") : QString("cap"));
+  QString flatSql = sqlString.simplified();
+  out << QString::number(prepareMs, 'f', 3) << '\t' << QString::number(execMs, 'f', 3) << '\t' << QString::number(fetchMs, 'f', 3) << '\t'
+      << numRows << '\t' << QString::number(rowsPerSecond, 'f', 0) << '\t' << stoppedAt << '\t' << m_scannedTables.join(",") << '\t' << flatSql << '\n';
+}
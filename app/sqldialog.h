@@ -2,11 +2,16 @@
 #define SQLDIALOG_H
 
 #include <QDialog>
+#include <QStringList>
 
+class QLabel;
 class QPlainTextEdit;
-class QTableWidget;
+class QTableView;
+class QTreeWidget;
 class QStatusBar;
+class QPushButton;
 class StampDB;
+class SqlQueryResultModel;
 
 //**************************************************************************
 /*! \class SQLDialog
@@ -40,22 +45,73 @@ public:
 
   /*! \brief Execute the current line (or the selected text) as SQL and show the result in the table.
    *
-   *  The table is auto-adjusted to size to show all of the text.
+   *  Rows are read as the table scrolls, up to a cap; "Load More" reads past the cap.
+   *  Column widths are estimated from the first rows.
+   *  The prepare, execute, and fetch times and the query plan are shown below the table,
+   *  and the times are appended to the timing log.
    */
   void executeSql(const QString& sqlString);
 
+  /*! \return Full path to the file that receives one line of timings for each statement. */
+  static QString timingLogPath();
+
 signals:
   
 public slots:
   void closeButtonPressed();
   void sqlButtonPressed();
+  void loadMoreButtonPressed();
+
+  /*! \brief Add CREATE INDEX statements for the tables that the last query scanned to the end of the editor. */
+  void suggestIndexButtonPressed();
+
+private slots:
+  /*! \brief Show the number of rows read and the timings, and enable "Load More" if reading stopped at the cap. */
+  void updateStatus();
+
+  /*! \brief Log the timings once reading reaches the last row or the row cap. */
+  void readingStopped();
 
 private:
+  /*! \brief Show EXPLAIN QUERY PLAN for the SQL, highlight full table scans and temporary b-trees, and remember the scanned tables. */
+  void showQueryPlan(const QString& sqlString);
+
+  /*! \brief If name is not a table, look for "table name" or "table AS name" in the SQL.
+   *  \return Table name, or an empty string if it is not found.
+   */
+  QString resolveTableName(const QString& name, const QString& sqlString) const;
+
+  /*! \return Prepare, execute, and fetch times and rows per second for the last statement. */
+  QString timingText() const;
+
+  /*! \brief Append the timings for the last statement to the timing log, with the rows read so far and whether reading reached the end or the cap. */
+  void logTimings(const QString& sqlString);
+
+  /*! \brief Number of rows measured to set the column widths. */
+  static const int ColumnWidthSampleRows = 100;
+
+  /*! \brief Widest that a column is made automatically, in characters. */
+  static const int MaxColumnWidthChars = 60;
+
   StampDB& m_db;
   QPlainTextEdit* m_textEdit;
-  QTableWidget* m_tableWidget;
+  QTableView* m_tableView;
+  SqlQueryResultModel* m_resultModel;
+  QPushButton* m_loadMoreButton;
+  QPushButton* m_suggestIndexButton;
+  QLabel* m_timingLabel;
+  QTreeWidget* m_planTree;
   QStatusBar* m_statusBar;
 
+  /*! \brief SQL for the last statement that was run. */
+  QString m_lastSql;
+
+  /*! \brief Tables read with a full table scan by the last statement. */
+  QStringList m_scannedTables;
+
+  /*! \brief True once this dialog has written its session header to the timing log. */
+  bool m_loggedSessionHeader;
+
 };
 
 #endif // SQLDIALOG_H
@@ -0,0 +1,201 @@
+#include "sqlqueryresultmodel.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+
+SqlQueryResultModel::SqlQueryResultModel(QObject *parent) :
+  QAbstractTableModel(parent), m_isSelect(false), m_atEnd(true), m_rowCap(DefaultRowCap), m_numRowsAffected(-1), m_prepareTime(0), m_execTime(0), m_fetchTime(0)
+{
+}
+
+void SqlQueryResultModel::clear()
+{
+  beginResetModel();
+  m_fieldNames.clear();
+  m_rows.clear();
+  m_isSelect = false;
+  m_atEnd = true;
+  m_db = QSqlDatabase();
+  m_sql.clear();
+  m_rowCap = DefaultRowCap;
+  m_numRowsAffected = -1;
+  m_prepareTime = 0;
+  m_execTime = 0;
+  m_fetchTime = 0;
+  endResetModel();
+}
+
+bool SqlQueryResultModel::setQuery(QSqlDatabase& db, const QString& sql, QString& errorMessage)
+{
+  clear();
+  QSqlQuery query(db);
+  // Rows are copied as they are read, so the driver does not need to keep them.
+  query.setForwardOnly(true);
+
+  // Prepare and execute separately so that each can be timed.
+  QElapsedTimer timer;
+  timer.start();
+  if (!query.prepare(sql))
+  {
+    errorMessage = query.lastError().text();
+    return false;
+  }
+  m_prepareTime = timer.nsecsElapsed();
+  timer.restart();
+  if (!query.exec())
+  {
+    errorMessage = query.lastError().text();
+    return false;
+  }
+  m_execTime = timer.nsecsElapsed();
+
+  if (!query.isSelect())
+  {
+    m_numRowsAffected = query.numRowsAffected();
+    return true;
+  }
+
+  beginResetModel();
+  m_isSelect = true;
+  m_atEnd = false;
+  m_db = db;
+  m_sql = sql;
+  QSqlRecord rec = query.record();
+  for (int i=0; i<rec.count(); ++i)
+  {
+    m_fieldNames << rec.fieldName(i);
+  }
+  endResetModel();
+  readRows(query);
+  return true;
+}
+
+void SqlQueryResultModel::raiseRowCap()
+{
+  if (m_atEnd)
+  {
+    return;
+  }
+  m_rowCap += DefaultRowCap;
+
+  QElapsedTimer timer;
+  timer.start();
+  // The SQL is wrapped so that SQLite skips the rows already read instead of returning them.
+  QString sql = m_sql.trimmed();
+  while (sql.endsWith(';'))
+  {
+    sql.chop(1);
+    sql = sql.trimmed();
+  }
+  QSqlQuery query(m_db);
+  query.setForwardOnly(true);
+  if (!query.prepare(QString("SELECT * FROM (%1) LIMIT ? OFFSET ?").arg(sql)))
+  {
+    // For example, a PRAGMA cannot be used as a subquery.
+    qDebug() << "Failed to read more rows:" << query.lastError().text();
+    m_atEnd = true;
+    emit readingStopped();
+    return;
+  }
+  query.addBindValue(m_rowCap - m_rows.size() + 1);
+  query.addBindValue(m_rows.size());
+  if (!query.exec())
+  {
+    qDebug() << "Failed to read more rows:" << query.lastError().text();
+    m_atEnd = true;
+    emit readingStopped();
+    return;
+  }
+  m_fetchTime += timer.nsecsElapsed();
+  readRows(query);
+}
+
+void SqlQueryResultModel::readRows(QSqlQuery& query)
+{
+  // Read first, the view is only told about the rows that exist.
+  QElapsedTimer timer;
+  timer.start();
+  const int numRows = m_rowCap - m_rows.size();
+  const int numCols = m_fieldNames.size();
+  QList<QList<QVariant> > newRows;
+  newRows.reserve(numRows);
+  while (newRows.size() < numRows && query.next())
+  {
+    QList<QVariant> values(numCols);
+    for (int col=0; col<numCols; ++col)
+    {
+      values[col] = query.value(col);
+    }
+    newRows.append(values);
+  }
+  // One more row says if there is anything past the cap.
+  m_atEnd = (newRows.size() < numRows || !query.next());
+  // Do not keep the read lock while the user looks at the rows.
+  query.finish();
+  m_fetchTime += timer.nsecsElapsed();
+
+  if (!newRows.isEmpty())
+  {
+    beginInsertRows(QModelIndex(), m_rows.size(), m_rows.size() + newRows.size() - 1);
+    m_rows.append(newRows);
+    endInsertRows();
+  }
+  emit readingStopped();
+}
+
+int SqlQueryResultModel::estimateColumnWidth(const int column, const QFontMetrics& metrics, const int sampleRows) const
+{
+  // Room for the cell margins.
+  const int padding = metrics.horizontalAdvance(QLatin1Char('M'));
+  int width = metrics.horizontalAdvance(m_fieldNames.value(column));
+  for (int row=0; row<m_rows.size() && row<sampleRows; ++row)
+  {
+    width = qMax(width, metrics.horizontalAdvance(m_rows.at(row).value(column).toString()));
+  }
+  return width + padding;
+}
+
+QVariant SqlQueryResultModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() || index.row() >= m_rows.size() || index.column() >= m_fieldNames.size())
+  {
+    return QVariant();
+  }
+  if (role == Qt::DisplayRole || role == Qt::ToolTipRole)
+  {
+    return m_rows.at(index.row()).at(index.column()).toString();
+  }
+  if (role == Qt::EditRole)
+  {
+    return m_rows.at(index.row()).at(index.column());
+  }
+  return QVariant();
+}
+
+QVariant SqlQueryResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+  if (role != Qt::DisplayRole)
+  {
+    return QVariant();
+  }
+  if (orientation == Qt::Horizontal)
+  {
+    return m_fieldNames.value(section);
+  }
+  return section + 1;
+}
+
+int SqlQueryResultModel::rowCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : m_rows.size();
+}
+
+int SqlQueryResultModel::columnCount(const QModelIndex &parent) const
+{
+  return parent.isValid() ? 0 : m_fieldNames.size();
+}
@@ -0,0 +1,115 @@
+#ifndef SQLQUERYRESULTMODEL_H
+#define SQLQUERYRESULTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QList>
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QVariant>
+
+class QSqlQuery;
+class QFontMetrics;
+
+//**************************************************************************
+/*! \class SqlQueryResultModel
+ * \brief Read only table model for the rows returned by an ad-hoc SELECT, read from a forward-only cursor.
+ *
+ * Rows are read up to a row cap in one pass and the cursor is then released, because
+ * an open cursor holds a read lock that blocks writers on the same DB; no statement
+ * is left open while the user looks at the rows. raiseRowCap reads the next rows with
+ * "SELECT * FROM (sql) LIMIT OFFSET", so SQLite skips the rows already read and
+ * rows written in the meantime may shift what is shown after the cap.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class SqlQueryResultModel : public QAbstractTableModel
+{
+  Q_OBJECT
+public:
+  /*! \brief Number of rows read by setQuery and by each raiseRowCap. */
+  static const int DefaultRowCap = 10000;
+
+  /*! \brief Constructor
+   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
+   */
+  explicit SqlQueryResultModel(QObject *parent = nullptr);
+
+  //**************************************************************************
+  /*! \brief Run SQL and, if it is a SELECT, read up to DefaultRowCap rows and release the cursor.
+   *
+   *  \param [in] db Database on which to run the SQL.
+   *  \param [in] sql SQL to run.
+   *  \param [out] errorMessage Set if the SQL fails.
+   *  \return True on success.
+   ***************************************************************************/
+  bool setQuery(QSqlDatabase& db, const QString& sql, QString& errorMessage);
+
+  /*! \brief Remove every row and column. */
+  void clear();
+
+  /*! \return True if the last SQL was a SELECT. */
+  bool isSelect() const { return m_isSelect; }
+
+  /*! \return Rows affected by the last SQL that was not a SELECT, -1 if unknown. */
+  int getNumRowsAffected() const { return m_numRowsAffected; }
+
+  /*! \return True if every row has been read. */
+  bool atEnd() const { return m_atEnd; }
+
+  /*! \return True if reading stopped at the row cap and there may be more rows. */
+  bool isCapped() const { return !m_atEnd && m_rows.size() >= m_rowCap; }
+
+  /*! \brief Run the SQL again and read up to DefaultRowCap rows after those already read. */
+  void raiseRowCap();
+
+  /*! \return Nanoseconds to prepare the last SQL. */
+  qint64 getPrepareTime() const { return m_prepareTime; }
+
+  /*! \return Nanoseconds to execute the last SQL, which for SQLite includes finding the first row. */
+  qint64 getExecTime() const { return m_execTime; }
+
+  /*! \return Nanoseconds spent reading the rows read so far. */
+  qint64 getFetchTime() const { return m_fetchTime; }
+
+  //**************************************************************************
+  /*! \brief Estimate a column width from the header and the first rows rather than every row.
+   *
+   *  \param [in] column Column of interest.
+   *  \param [in] metrics Font metrics used by the view.
+   *  \param [in] sampleRows Number of rows to measure.
+   *  \return Width in pixels for the widest sampled text.
+   ***************************************************************************/
+  int estimateColumnWidth(const int column, const QFontMetrics& metrics, const int sampleRows) const;
+
+signals:
+  /*! \brief Reading stopped because every row was read or the row cap was reached; the rows are already in the model. */
+  void readingStopped();
+
+public:
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+  QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const;
+
+private:
+  /*! \brief Read rows up to the row cap, release the cursor, and emit readingStopped.
+   *  \param [in, out] query Executed SELECT positioned before its first unread row.
+   */
+  void readRows(QSqlQuery& query);
+
+  QSqlDatabase m_db;
+  QString m_sql;
+  QStringList m_fieldNames;
+  QList<QList<QVariant> > m_rows;
+  bool m_isSelect;
+  bool m_atEnd;
+  int m_rowCap;
+  int m_numRowsAffected;
+  qint64 m_prepareTime;
+  qint64 m_execTime;
+  qint64 m_fetchTime;
+};
+
+#endif // SQLQUERYRESULTMODEL_H
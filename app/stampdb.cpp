@@ -23,13 +23,32 @@
 #include <QList>
 #include <QtGlobal>
 #include <QInputDialog>
+#include <QThread>
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QMutexLocker>
+#include <QUuid>
+#include <QAtomicInt>
+#include <QProgressDialog>
+#include <QTimer>
+#include <limits>
+
+// The FTS5 table and its shadow tables all start with tablename_fts.
+const QString StampDB::NotDerivedTableCondition = "tbl_name NOT LIKE '%\\_fts' ESCAPE '\\' AND tbl_name NOT LIKE '%\\_fts\\_%' ESCAPE '\\' AND tbl_name<>'tablechanges'";
+
+// Used by the one file CSV export.
+const QString StampDB::FullInventorySql = "SELECT CONCAT(country.a3, '/', catalog.scott, '/', catalogtype.name) AS scott, inventory.quantity, inventory.grade,  inventory.condition, inventory.selvage, inventory.centering, inventory.back, inventory.comment, catalog.description, catalog.facevalue, inventory.paid, bookvalues.bookvalue, inventory.valuemultiplier, inventory.certificate, inventory.purchasedate, catalog.releasedate, dealer.name AS dealer_name, stamplocation.name AS location_name, stamplocation.description AS location_description, inventory.updated , country.name AS 'country', country.a3, catalog.scott AS scott_num, catalogtype.name as type, inventory.id FROM inventory, catalog, bookvalues, country, stamplocation, valuetype, dealer, catalogtype WHERE  inventory.catalogid=catalog.id AND catalog.countryid=country.id AND inventory.dealerid=dealer.id AND stamplocation.id=inventory.locationid AND valuetype.description=inventory.grade AND bookvalues.valuetypeid=valuetype.id AND catalog.id=bookvalues.catalogid  AND catalogtype.id=catalog.typeid ORDER BY country.a3, ABS(catalog.scott), catalogtype.name";
 
 StampDB::StampDB(QObject *parent) :
   QObject(parent),
   m_dbIsInitialized(false),
   m_tableMap(nullptr),
   m_outerDDLRegExp(nullptr),
-  m_desiredSchemaDDLList(nullptr)
+  m_desiredSchemaDDLList(nullptr),
+  m_snapshotWriter(false),
+  m_changeMonitorTimer(nullptr),
+  m_dataVersion(-1),
+  m_numChangeChecks(0)
 {
   m_desiredSchemaDDLList = new QStringList();
 
@@ -109,6 +128,14 @@ StampDB::StampDB(QObject *parent) :
                              " typeid INTEGER,"
                              " valuemultiplier FLOAT)";
 
+  // Book values are found by stamp and value type (mint or used), and then by source.
+  // This also covers a search on only the catalogid.
+  m_compositeIndexes << (QStringList() << "bookvalues" << "catalogid" << "valuetypeid" << "sourceid");
+
+  // Stamps are found by words in the description, comment, or certificate.
+  m_fullTextIndexes.insert("catalog", QStringList() << "description");
+  m_fullTextIndexes.insert("inventory", QStringList() << "comment" << "certificate");
+
   m_outerDDLRegExp = new QRegularExpression("^\\s*create\\s+table\\s+([a-z0-9_\\-\\.]+)\\s*\\((.*)\\)\\s*$");
   m_outerDDLRegExp->setPatternOptions(QRegularExpression::CaseInsensitiveOption);
 
@@ -119,6 +146,11 @@ StampDB::StampDB(QObject *parent) :
 StampDB::~StampDB()
 {
   closeDB();
+  if (m_dbIsInitialized && !m_connectionName.isEmpty()) {
+    // The connection can only be removed once nothing refers to it.
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase(m_connectionName);
+  }
   if (m_tableMap != nullptr) {
     delete m_tableMap;
     m_tableMap = nullptr;
@@ -142,10 +174,12 @@ void StampDB::pathToDB(const QString& fullpath)
 {
   if (m_pathToDB.compare(fullpath, Qt::CaseSensitive) != 0) {
     if (m_dbIsInitialized) {
+      m_queryCache.clear(m_db.connectionName());
       m_db.close();
       m_db.setDatabaseName(fullpath);
     }
     m_pathToDB = fullpath;
+    m_snapshotCache.setDatabasePath(fullpath);
   }
 }
 
@@ -168,18 +202,309 @@ bool StampDB::openDB()
     }
     if (!m_dbIsInitialized) {
       // Find QSLite driver
-      m_db = QSqlDatabase::addDatabase("QSQLITE");
+      m_db = m_connectionName.isEmpty() ? QSqlDatabase::addDatabase("QSQLITE") : QSqlDatabase::addDatabase("QSQLITE", m_connectionName);
       m_dbIsInitialized = true;
     }
     m_db.setDatabaseName(m_pathToDB);
-    return m_db.open();
+    if (!m_db.open()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool StampDB::upgradeSchema()
+{
+  if (!openDB()) {
+    return false;
+  }
+  QSqlQuery query(m_db);
+  if (!query.exec("PRAGMA user_version") || !query.next()) {
+    qDebug() << "Failed to read the schema version:" << query.lastError().text();
+    return false;
+  }
+  int version = query.value(0).toInt();
+  query.finish();
+  if (version >= SchemaVersion) {
+    return true;
+  }
+
+  // A new DB has no tables, so createSchema creates the indexes and sets the version.
+  if (m_db.tables(QSql::Tables).isEmpty()) {
+    return true;
+  }
+
+  qDebug() << "Upgrading schema from version" << version << "to" << SchemaVersion;
+  // Version 1 added the indexes and version 4 the index on "updated"; createIndexes adds whichever are missing.
+  if (version < 4 && !createIndexes()) {
+    return false;
+  }
+  if (version < 2) {
+    if (!isFullTextSearchAvailable()) {
+      qDebug() << "Full text search is not available, the DB will not have full text indexes";
+    } else if (!createFullTextIndexes()) {
+      return false;
+    }
+  }
+  if (version < 3 && !createChangeCounters()) {
+    return false;
+  }
+  return setSchemaVersion();
+}
+
+bool StampDB::isFullTextSearchAvailable()
+{
+  if (!openDB()) {
+    return false;
+  }
+  // The temp schema is not stored in the DB file.
+  QSqlQuery query(m_db);
+  if (!query.exec("CREATE VIRTUAL TABLE temp.fts_probe USING fts5(text, tokenize='trigram')")) {
+    return false;
+  }
+  query.exec("DROP TABLE temp.fts_probe");
+  return true;
+}
+
+bool StampDB::setSchemaVersion()
+{
+  QSqlQuery query(m_db);
+  if (!query.exec(QString("PRAGMA user_version = %1").arg(SchemaVersion))) {
+    qDebug() << "Failed to set the schema version:" << query.lastError().text();
+    return false;
+  }
+  return true;
+}
+
+bool StampDB::createIndexes()
+{
+  if (!openDB()) {
+    return false;
+  }
+
+  // The leading field of a composite index does not need an index of its own.
+  QList<QStringList> indexes = m_compositeIndexes;
+  QSet<QString> coveredFields;
+  for (int i=0; i<indexes.size(); ++i) {
+    coveredFields.insert(indexes.at(i).at(0).toLower() + "." + indexes.at(i).at(1).toLower());
+  }
+
+  const QStringList& tableNames = m_schema.getTableNames();
+  for (int i=0; i<tableNames.size(); ++i) {
+    const DescribeSqlTable* table = m_schema.getTableByName(tableNames.at(i));
+    if (table == nullptr) {
+      continue;
+    }
+    for (int j=0; j<table->getFieldCount(); ++j) {
+      const DescribeSqlField* field = table->getFieldByIndex(j);
+      if (field != nullptr && field->isLinkField() && !field->isKey() && !coveredFields.contains(table->getName().toLower() + "." + field->getName().toLower())) {
+        indexes << (QStringList() << table->getName() << field->getName());
+      }
+    }
+    // readTableChanges finds the rows changed since the last read with "updated >= mark".
+    if (table->containsField("updated")) {
+      indexes << (QStringList() << table->getName() << "updated");
+    }
+  }
+
+  QStringList tables = m_db.tables(QSql::Tables);
+  QSqlQuery query(m_db);
+  bool ret = true;
+  for (int i=0; i<indexes.size(); ++i) {
+    const QString tableName = indexes.at(i).at(0);
+    const QStringList fields = indexes.at(i).mid(1);
+    if (!tables.contains(tableName, Qt::CaseInsensitive)) {
+      continue;
+    }
+    QSqlRecord record = m_db.record(tableName);
+    bool hasFields = true;
+    for (int j=0; j<fields.size() && hasFields; ++j) {
+      hasFields = record.contains(fields.at(j));
+    }
+    if (!hasFields) {
+      qDebug() << "Index not created, table" << tableName << "does not contain every field in" << fields;
+      continue;
+    }
+
+    QString ddl = QString("CREATE INDEX IF NOT EXISTS idx_%1_%2 ON %1(%3)").arg(tableName, fields.join("_"), fields.join(", "));
+    if (!query.exec(ddl)) {
+      qDebug() << "Failed to create index:" << ddl << query.lastError().text();
+      ret = false;
+    }
+  }
+
+  // Statistics so that the query planner can choose between the indexes.
+  if (ret && !query.exec("ANALYZE")) {
+    qDebug() << "ANALYZE failed:" << query.lastError().text();
   }
+  return ret;
+}
+
+bool StampDB::createChangeCounters()
+{
+  if (!openDB()) {
+    return false;
+  }
+
+  // One row per table, so the change monitor reads a few rows instead of scanning every table.
+  QStringList ddl;
+  ddl << "CREATE TABLE IF NOT EXISTS tablechanges(name TEXT PRIMARY KEY COLLATE NOCASE, counter INTEGER NOT NULL DEFAULT 0)";
+  const QStringList tableNames = getTableNames(true);
+  for (int i=0; i<tableNames.size(); ++i) {
+    const QString& tableName = tableNames.at(i);
+    ddl << QString("INSERT OR IGNORE INTO tablechanges(name) VALUES ('%1')").arg(tableName);
+    ddl << QString("CREATE TRIGGER IF NOT EXISTS %1_changes_ai AFTER INSERT ON %1 BEGIN "
+                   "UPDATE tablechanges SET counter = counter + 1 WHERE name = '%1'; END").arg(tableName);
+    ddl << QString("CREATE TRIGGER IF NOT EXISTS %1_changes_au AFTER UPDATE ON %1 BEGIN "
+                   "UPDATE tablechanges SET counter = counter + 1 WHERE name = '%1'; END").arg(tableName);
+    ddl << QString("CREATE TRIGGER IF NOT EXISTS %1_changes_ad AFTER DELETE ON %1 BEGIN "
+                   "UPDATE tablechanges SET counter = counter + 1 WHERE name = '%1'; END").arg(tableName);
+  }
+
+  if (!m_db.transaction()) {
+    qDebug() << "Failed to begin a transaction:" << m_db.lastError().text();
+    return false;
+  }
+  QSqlQuery query(m_db);
+  bool ret = true;
+  for (int i=0; i<ddl.size() && ret; ++i) {
+    if (!query.exec(ddl.at(i))) {
+      qDebug() << "Failed to create the change counters:" << ddl.at(i) << query.lastError().text();
+      ret = false;
+    }
+  }
+  if (ret) {
+    ret = m_db.commit();
+  } else {
+    m_db.rollback();
+  }
+  return ret;
+}
+
+bool StampDB::createFullTextIndexes()
+{
+  if (!openDB()) {
+    return false;
+  }
+
+  QStringList tables = m_db.tables(QSql::Tables);
+  QSqlQuery query(m_db);
+  bool ret = true;
+  QMapIterator<QString, QStringList> it(m_fullTextIndexes);
+  while (it.hasNext() && ret) {
+    it.next();
+    const QString tableName = it.key();
+    const QStringList& fields = it.value();
+    const QString ftsName = tableName + "_fts";
+    if (!tables.contains(tableName, Qt::CaseInsensitive) || tables.contains(ftsName, Qt::CaseInsensitive)) {
+      continue;
+    }
+    QSqlRecord record = m_db.record(tableName);
+    bool hasFields = record.contains("id");
+    for (int i=0; i<fields.size() && hasFields; ++i) {
+      hasFields = record.contains(fields.at(i));
+    }
+    if (!hasFields) {
+      qDebug() << "Full text index not created, table" << tableName << "does not contain every field in" << fields;
+      continue;
+    }
+
+    QStringList newFields;
+    QStringList oldFields;
+    for (int i=0; i<fields.size(); ++i) {
+      newFields << "new." + fields.at(i);
+      oldFields << "old." + fields.at(i);
+    }
+    const QString fieldList = fields.join(", ");
+
+    // An external content table needs the old values to remove a row from the index.
+    QStringList ddl;
+    ddl << QString("CREATE VIRTUAL TABLE %1 USING fts5(%2, content='%3', content_rowid='id', tokenize='trigram')").arg(ftsName, fieldList, tableName);
+    ddl << QString("CREATE TRIGGER %1_ai AFTER INSERT ON %2 BEGIN "
+                   "INSERT INTO %1(rowid, %3) VALUES (new.id, %4); END").arg(ftsName, tableName, fieldList, newFields.join(", "));
+    ddl << QString("CREATE TRIGGER %1_ad AFTER DELETE ON %2 BEGIN "
+                   "INSERT INTO %1(%1, rowid, %3) VALUES ('delete', old.id, %4); END").arg(ftsName, tableName, fieldList, oldFields.join(", "));
+    ddl << QString("CREATE TRIGGER %1_au AFTER UPDATE OF id, %3 ON %2 BEGIN "
+                   "INSERT INTO %1(%1, rowid, %3) VALUES ('delete', old.id, %4); "
+                   "INSERT INTO %1(rowid, %3) VALUES (new.id, %5); END").arg(ftsName, tableName, fieldList, oldFields.join(", "), newFields.join(", "));
+    ddl << QString("INSERT INTO %1(%1) VALUES ('rebuild')").arg(ftsName);
+
+    if (!m_db.transaction()) {
+      qDebug() << "Failed to begin a transaction:" << m_db.lastError().text();
+      return false;
+    }
+    for (int i=0; i<ddl.size() && ret; ++i) {
+      if (!query.exec(ddl.at(i))) {
+        qDebug() << "Failed to create the full text index:" << ddl.at(i) << query.lastError().text();
+        ret = false;
+      }
+    }
+    if (ret) {
+      ret = m_db.commit();
+    } else {
+      m_db.rollback();
+    }
+  }
+  return ret;
+}
+
+bool StampDB::hasFullTextIndex(const QString& tableName, const QString& fieldName)
+{
+  const QStringList fields = m_fullTextIndexes.value(tableName.toLower());
+  if (fields.isEmpty() || (!fieldName.isEmpty() && !fields.contains(fieldName, Qt::CaseInsensitive))) {
+    return false;
+  }
+  return openDB() && m_db.tables(QSql::Tables).contains(tableName.toLower() + "_fts", Qt::CaseInsensitive);
+}
+
+bool StampDB::searchText(const QString& tableName, const QString& text, QList<int>& ids, QString& errorMessage, const QStringList& fieldNames, const int limit)
+{
+  ids.clear();
+  if (text.size() < MinFullTextSearchLength || !hasFullTextIndex(tableName)) {
+    return false;
+  }
+  const QStringList& fields = m_fullTextIndexes[tableName.toLower()];
+  QStringList searchFields;
+  for (int i=0; i<fieldNames.size(); ++i) {
+    if (!fields.contains(fieldNames.at(i), Qt::CaseInsensitive)) {
+      return false;
+    }
+    searchFields << fieldNames.at(i).toLower();
+  }
+
+  // Quote the text so that it is a phrase rather than an FTS5 query; "rank" is bm25.
+  QString match = "\"" + QString(text).replace("\"", "\"\"") + "\"";
+  if (!searchFields.isEmpty()) {
+    match = QString("{%1} : %2").arg(searchFields.join(" "), match);
+  }
+  const QString ftsName = tableName.toLower() + "_fts";
+  QString sql = QString("SELECT rowid FROM %1 WHERE %1 MATCH :match ORDER BY rank LIMIT :limit").arg(ftsName);
+  QSharedPointer<QSqlQuery> cachedQuery = m_queryCache.prepare(getDB(), sql, errorMessage);
+  if (cachedQuery == nullptr) {
+    return false;
+  }
+  QSqlQuery& query = *cachedQuery;
+  query.bindValue(":match", match);
+  query.bindValue(":limit", limit);
+  if (!query.exec()) {
+    errorMessage = query.lastError().text();
+    return false;
+  }
+  while (query.next()) {
+    ids.append(query.value(0).toInt());
+  }
+  query.finish();
   return true;
 }
 
 void StampDB::closeDB()
 {
+  // data_version values from one connection cannot be compared to another.
+  m_dataVersion = -1;
+  m_numChangeChecks = 0;
+  m_tableCounters.clear();
   if (m_db.isOpen()) {
+    m_queryCache.clear(m_db.connectionName());
     m_db.close();
   }
 }
@@ -191,6 +516,16 @@ bool StampDB::deleteDB()
   return QFile::remove(pathToDB());
 }
 
+void StampDB::reportMessage(const QString& title, const QString& text)
+{
+  if (QCoreApplication::instance() != nullptr && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+    ScrollMessageBox::information(nullptr, title, text);
+  } else {
+    qDebug() << title << text;
+    emit message(title, text);
+  }
+}
+
 QSqlError StampDB::lastError()
 {
   // If opening database has failed user can ask
@@ -206,6 +541,8 @@ bool StampDB::createSchema()
     QRegularExpression tableNameRegExp("create\\s+table\\s+(\\w+)");
     tableNameRegExp.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
 
+    // A cached statement on a table that is dropped would need to be prepared again anyway.
+    m_queryCache.clear(m_db.connectionName());
     QSqlQuery query(m_db);
     QStringList tables = m_db.tables(QSql::Tables);
     ret = true;
@@ -250,6 +587,18 @@ bool StampDB::createSchema()
         }
       }
     }
+    if (ret) {
+      ret = createIndexes();
+    }
+    if (ret && isFullTextSearchAvailable() && !createFullTextIndexes()) {
+      qDebug() << "Failed to create the full text indexes for" << m_pathToDB;
+    }
+    if (ret) {
+      ret = createChangeCounters();
+    }
+    if (ret) {
+      ret = setSchemaVersion();
+    }
   }
   return ret;
 }
@@ -344,7 +693,7 @@ QStringList StampDB::getTableNames(const bool ignoreSystemTables)
         return m_db.tables(QSql::Tables);
     }
 
-    QString sql = "SELECT tbl_name FROM sqlite_master WHERE type='table' and tbl_name<>'sqlite_sequence' order by tbl_name";
+    QString sql = "SELECT tbl_name FROM sqlite_master WHERE type='table' and tbl_name<>'sqlite_sequence' and " + NotDerivedTableCondition + " order by tbl_name";
     return getOneColumnAsString(sql);
 }
 
@@ -366,7 +715,7 @@ QStringList StampDB::getColumnNames(const QString& tableName)
 
 QStringList StampDB::getDDLForExport()
 {
-    QString sql = "SELECT sql FROM sqlite_master WHERE type='table' and tbl_name<>'sqlite_sequence' order by tbl_name";
+    QString sql = "SELECT sql FROM sqlite_master WHERE type='table' and tbl_name<>'sqlite_sequence' and " + NotDerivedTableCondition + " order by tbl_name";
     return getOneColumnAsString(sql);
 }
 
@@ -382,25 +731,86 @@ int StampDB::getMaxId(const QString& tableName, const QString& fieldName)
 }
 
 int StampDB::getIdFromSql(const QString& sql) {
-  QSqlDatabase& db = getDB();
-  QSqlQuery query(db);
+  QString errMsg;
+  QSharedPointer<QSqlQuery> query = m_queryCache.prepare(getDB(), sql, errMsg);
+  if (query == nullptr)
+  {
+      reportMessage("ERROR", errMsg);
+      return -1;
+  }
 
-  if (!query.exec(sql))
+  int rc = -1;
+  if (!query->exec())
   {
-      QString errMsg = QString("SQL: %1\n\nError:\n%2").arg(sql).arg(query.lastError().text());
-      ScrollMessageBox::information(nullptr, "ERROR", errMsg);
+      errMsg = QString("SQL: %1\n\nError:\n%2").arg(sql).arg(query->lastError().text());
+      reportMessage("ERROR", errMsg);
   }
-  else if (query.isSelect() && query.isActive() && query.next() && !query.record().isNull(0))
+  else if (query->isSelect() && query->isActive() && query->next() && !query->record().isNull(0))
   {
       bool ok = true;
-      int rc = query.record().value(0).toInt(&ok);
-      if (ok) {
-          return rc;
+      rc = query->record().value(0).toInt(&ok);
+      if (!ok) {
+          rc = -1;
+          errMsg = QString("SQL: %1\n\nError:\nCannot convert returned value to an integer").arg(sql);
+          reportMessage("ERROR", errMsg);
       }
-      QString errMsg = QString("SQL: %1\n\nError:\nCannot convert returned value to an integer").arg(sql);
-      ScrollMessageBox::information(nullptr, "ERROR", errMsg);
   }
-  return -1;
+  // Only the first row is read; release the statement so that it does not hold a read lock.
+  query->finish();
+  return rc;
+}
+
+int StampDB::countCatalogWithoutBookValues()
+{
+  if (!openDB()) {
+    return -1;
+  }
+  return getIdFromSql("SELECT COUNT(*) FROM catalog LEFT OUTER JOIN bookvalues ON catalog.id = bookvalues.catalogid WHERE bookvalues.catalogid IS NULL");
+}
+
+int StampDB::addMissingBookValues(const int sourceId, const QList<int>& valueTypeIds, QString& errorMessage)
+{
+  if (!openDB()) {
+    errorMessage = m_db.lastError().text();
+    return -1;
+  }
+  if (valueTypeIds.isEmpty()) {
+    return 0;
+  }
+
+  // One row for each catalog entry without values and each value type.
+  QStringList valueTypes;
+  for (int i=0; i<valueTypeIds.size(); ++i) {
+    valueTypes << QString("(%1)").arg(valueTypeIds.at(i));
+  }
+  QString sql = QString("WITH newtypes(id) AS (VALUES %1) "
+                        "INSERT INTO bookvalues (catalogid, sourceid, valuetypeid, bookvalue) "
+                        "SELECT catalog.id, %2, newtypes.id, 0 FROM catalog "
+                        "LEFT OUTER JOIN bookvalues ON catalog.id = bookvalues.catalogid "
+                        "CROSS JOIN newtypes "
+                        "WHERE bookvalues.catalogid IS NULL "
+                        "ORDER BY catalog.id, newtypes.id").arg(valueTypes.join(", ")).arg(sourceId);
+
+  if (!m_db.transaction()) {
+    errorMessage = QString(tr("Failed to begin a transaction: %1")).arg(m_db.lastError().text());
+    return -1;
+  }
+  QSqlQuery query(m_db);
+  if (!query.exec(sql)) {
+    errorMessage = QString("SQL: %1\n\nError:\n%2").arg(sql, query.lastError().text());
+    m_db.rollback();
+    return -1;
+  }
+  int numAdded = query.numRowsAffected();
+  if (!m_db.commit()) {
+    errorMessage = QString(tr("Failed to commit: %1")).arg(m_db.lastError().text());
+    m_db.rollback();
+    return -1;
+  }
+  if (numAdded > 0) {
+    notifyTablesChanged(QStringList() << "bookvalues");
+  }
+  return numAdded;
 }
 
 int StampDB::selectValueSourceId(QWidget *parent)
@@ -456,78 +866,243 @@ GenericDataCollection *StampDB::readTableName(const QString& tableName, const bo
   return readTableSql(QString("select * from %1 order by ID").arg(tableName));
 }
 
-GenericDataCollections* StampDB::readTableWithLinks(const QString& tableName, const int maxLinkDepth, const bool sortByKey)
+GenericDataCollections* StampDB::readTableWithLinks(const QString& tableName, const int maxLinkDepth, const bool sortByKey, const int firstPageSize)
 {
+    // Find every linked table first; the schema knows the links, so no data is needed.
+    QStringList tableNames;
+    QHash<QString, QStringList> projectedFields;
+    getLinkProjection(tableName, maxLinkDepth, tableNames, projectedFields);
+
+    // Linked tables are read in parallel, each on its own connection to the same database file.
+    // Only the fields needed to display and edit the links are read from a linked table.
+    QList<GenericDataCollection*> linkedTables(tableNames.size(), nullptr);
+    QStringList errors;
+    for (int i=0; i<tableNames.size(); ++i) {
+        errors << QString();
+    }
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(QThread::idealThreadCount(), tableNames.size() - 1)));
+    QThread* callerThread = QThread::currentThread();
+    GenericDataCollection** results = linkedTables.data();
+    QString* errorMessages = errors.data();
+    const QString dbPath = m_pathToDB;
+    for (int i=1; i<tableNames.size(); ++i)
+    {
+        const QString linkedName = tableNames.at(i);
+        const QStringList orderByList = sortByKey ? getKeyFieldNames(linkedName) : QStringList();
+        const QStringList fieldNames = projectedFields.value(linkedName.toLower());
+        pool.start([this, i, linkedName, orderByList, fieldNames, dbPath, callerThread, results, errorMessages]() {
+            const QString connectionName = QString("StampDBReader_%1").arg(QUuid::createUuid().toString());
+            {
+                QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+                db.setDatabaseName(dbPath);
+                if (db.open()) {
+                    results[i] = readTableBySchema(db, linkedName, orderByList, errorMessages[i], fieldNames);
+                    m_queryCache.clear(connectionName);
+                    db.close();
+                } else {
+                    errorMessages[i] = db.lastError().text();
+                }
+            }
+            QSqlDatabase::removeDatabase(connectionName);
+            if (results[i] != nullptr) {
+                // The collection is a QObject, it must belong to the thread that will own it.
+                results[i]->moveToThread(callerThread);
+            }
+        });
+    }
+
+    // Read the requested table on the main connection while the linked tables are read.
+    if (firstPageSize > 0) {
+        linkedTables[0] = readTableFirstPage(tableName, firstPageSize);
+    } else {
+        linkedTables[0] = readTableBySchema(tableName, sortByKey);
+    }
+    pool.waitForDone();
+    reportStaleSnapshots();
+
     // This is a collection of tables.
     GenericDataCollections* tables = new GenericDataCollections();
-    QHash<QString, int> tableDepth;
-    QSet<QString> tablesToRead;
-    tableDepth.insert(tableName.toLower(), 0);
-    tablesToRead << tableName;
+    for (int i=0; i<tableNames.size(); ++i)
+    {
+        if (!errors.at(i).isEmpty()) {
+            reportMessage("ERROR", errors.at(i));
+        }
+        GenericDataCollection* table = linkedTables.at(i);
+        if (table != nullptr) {
+            // so that when tables is deleted, table is also deleted.
+            table->setParent(tables);
+            tables->addCollection(tableNames.at(i), table);
+        }
+    }
+    return tables;
+}
+
+
+void StampDB::getLinkProjection(const QString& tableName, const int maxLinkDepth, QStringList& tableNames, QHash<QString, QStringList>& projectedFields) const
+{
+    tableNames.clear();
+    projectedFields.clear();
 
-    while (!tablesToRead.isEmpty())
+    // Lower case field names needed from each linked table; the edited table is not in here because it is read completely.
+    QHash<QString, QSet<QString> > neededFields;
+    QHash<QString, int> tableDepth;
+    QStringList tablesToVisit;
+    const QString primaryName = tableName.toLower();
+    tableDepth.insert(primaryName, 0);
+    tableNames << tableName;
+    tablesToVisit << tableName;
+    while (!tablesToVisit.isEmpty())
     {
-        QString tableNameToReadNow = *tablesToRead.begin();
-        if (!tables->contains(tableNameToReadNow) && (maxLinkDepth < 0 || tableDepth[tableNameToReadNow.toLower()] <= maxLinkDepth)) {
-            int currentLevel = tableDepth[tableNameToReadNow.toLower()];
-
-            // This is a single table. Read it and set the types based on the schema.
-            GenericDataCollection* table = readTableBySchema(tableNameToReadNow, sortByKey);
-            if (table != nullptr) {
-                // so that when tables is deleted, table is also deleted.
-                table->setParent(tables);
-                tables->addCollection(tableNameToReadNow, table);
-                if (((maxLinkDepth < 0) || (currentLevel + 1 <= maxLinkDepth)) && m_schema.containsTable(tableNameToReadNow)) {
-                    QSet<QString> newNames = m_schema.getLinkedTableNames(tableNameToReadNow);
-                    QSetIterator<QString> i(newNames);
-                    while (i.hasNext()) {
-                        QString newTable = i.next();
-                        if (!tables->contains(newTable)) {
-                            if (tableDepth.contains(newTable.toLower())) {
-                                if (tableDepth[newTable.toLower()] > currentLevel + 1) {
-                                    tableDepth[newTable.toLower()] = currentLevel + 1;
-                                }
-                            } else {
-                                tablesToRead << newTable;
-                                tableDepth[newTable.toLower()] = currentLevel + 1;
-                            }
-                        }
-                    }
+        QString tableNameToVisit = tablesToVisit.takeFirst();
+        QString lowerName = tableNameToVisit.toLower();
+        int currentLevel = tableDepth.value(lowerName);
+        const DescribeSqlTable* table = m_schema.getTableByName(tableNameToVisit);
+        if (table == nullptr || (maxLinkDepth >= 0 && currentLevel + 1 > maxLinkDepth)) {
+            continue;
+        }
+
+        QStringList fieldNames = table->getFieldNames();
+        for (int i=0; i<fieldNames.size(); ++i)
+        {
+            if (lowerName != primaryName && !neededFields.value(lowerName).contains(fieldNames.at(i).toLower())) {
+                continue;
+            }
+            const DescribeSqlField* field = table->getFieldByName(fieldNames.at(i));
+            if (field == nullptr || !field->isLinkField() || !m_schema.containsTable(field->getLinkTableName())) {
+                continue;
+            }
+            QString linkName = field->getLinkTableName().toLower();
+            if (!tableDepth.contains(linkName)) {
+                tableDepth.insert(linkName, currentLevel + 1);
+                tableNames << field->getLinkTableName();
+            }
+            if (linkName == primaryName) {
+                continue;
+            }
+
+            // The linked to field and the display fields; if these add a new field, look at the linked table again.
+            QSet<QString>& needed = neededFields[linkName];
+            int oldSize = needed.size();
+            needed.insert(field->getLinkFieldName().toLower());
+            QStringList displayFields = field->getLinkDisplayField();
+            for (int j=0; j<displayFields.size(); ++j) {
+                if (!displayFields.at(j).trimmed().isEmpty()) {
+                    needed.insert(displayFields.at(j).trimmed().toLower());
                 }
             }
+            if (needed.size() != oldSize && !tablesToVisit.contains(field->getLinkTableName(), Qt::CaseInsensitive)) {
+                tablesToVisit << field->getLinkTableName();
+            }
         }
-        tablesToRead.remove(tableNameToReadNow);
     }
-    return tables;
-}
 
+    // Keep the schema order so that the properties are in the same order as a complete read.
+    for (int i=1; i<tableNames.size(); ++i)
+    {
+        const DescribeSqlTable* table = m_schema.getTableByName(tableNames.at(i));
+        QString lowerName = tableNames.at(i).toLower();
+        if (table == nullptr || lowerName == primaryName) {
+            continue;
+        }
+        // The key is always needed to find a row.
+        QSet<QString>& needed = neededFields[lowerName];
+        QStringList keyFields = getKeyFieldNames(tableNames.at(i));
+        for (int j=0; j<keyFields.size(); ++j)
+        {
+            needed.insert(keyFields.at(j).toLower());
+        }
+        QStringList fieldNames = table->getFieldNames();
+        QStringList projection;
+        for (int j=0; j<fieldNames.size(); ++j)
+        {
+            if (needed.contains(fieldNames.at(j).toLower())) {
+                projection << fieldNames.at(j);
+            }
+        }
+        projectedFields.insert(lowerName, projection);
+    }
+}
 
 GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, const bool sortByKey)
 {
   Q_ASSERT_X(m_schema.containsTable(tableName), "readTableBySchema", qPrintable(QString("Table [%1] is not in the schema.").arg(tableName)));
-  QStringList orderByList;
+  if (m_schema.getTableByName(tableName) == nullptr) {
+      return nullptr;
+  }
+  return readTableBySchema(tableName, sortByKey ? getKeyFieldNames(tableName) : QStringList());
+}
 
-  if (sortByKey) {
-      const DescribeSqlTable* table = m_schema.getTableByName(tableName);
-      if (table == nullptr) {
-          return nullptr;
-      }
-      QStringList fieldNames = table->getFieldNames();
-      for (QStringListIterator fieldIterator(fieldNames); fieldIterator.hasNext(); )
-      {
-          QString fieldName = fieldIterator.next();
-          if (table->getFieldByName(fieldName)->isKey()) {
-              orderByList << fieldName;
-          }
-      }
-      if (orderByList.isEmpty() && table->containsField("id")) {
-          orderByList << "id";
+QStringList StampDB::getKeyFieldNames(const QString& tableName) const
+{
+  QStringList orderByList;
+  const DescribeSqlTable* table = m_schema.getTableByName(tableName);
+  if (table == nullptr) {
+      return orderByList;
+  }
+  QStringList fieldNames = table->getFieldNames();
+  for (QStringListIterator fieldIterator(fieldNames); fieldIterator.hasNext(); )
+  {
+      QString fieldName = fieldIterator.next();
+      if (table->getFieldByName(fieldName)->isKey()) {
+          orderByList << fieldName;
       }
   }
-  return readTableBySchema(tableName, orderByList);
+  if (orderByList.isEmpty() && table->containsField("id")) {
+      orderByList << "id";
+  }
+  return orderByList;
 }
 
 GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, const QStringList& orderByList)
+{
+  if (!openDB())
+  {
+    return nullptr;
+  }
+  QString errorMessage;
+  GenericDataCollection* collection = readTableBySchema(getDB(), tableName, orderByList, errorMessage);
+  if (!errorMessage.isEmpty())
+  {
+    reportMessage("ERROR", errorMessage);
+  }
+  reportStaleSnapshots();
+  return collection;
+}
+
+bool StampDB::rebuildSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList)
+{
+  if (!m_snapshotCache.isEnabled() || !m_schema.containsTable(tableName) || !openDB())
+  {
+    return false;
+  }
+  // A current snapshot is loaded rather than read, so asking twice for the same table costs little.
+  QString errorMessage;
+  GenericDataCollection* collection = readTableBySchema(getDB(), tableName, orderByList, errorMessage, fieldNames);
+  if (collection == nullptr)
+  {
+    qDebug() << "Failed to rebuild the snapshot for" << tableName << errorMessage;
+    return false;
+  }
+  delete collection;
+  return true;
+}
+
+void StampDB::reportStaleSnapshots()
+{
+  QList<StaleSnapshot> staleSnapshots;
+  {
+    QMutexLocker locker(&m_staleSnapshotsMutex);
+    staleSnapshots.swap(m_staleSnapshots);
+  }
+  for (int i=0; i<staleSnapshots.size(); ++i)
+  {
+    const StaleSnapshot& stale = staleSnapshots.at(i);
+    emit snapshotStale(stale.tableName, stale.fieldNames, stale.orderByList);
+  }
+}
+
+GenericDataCollection* StampDB::readTableBySchema(QSqlDatabase& db, const QString& tableName, const QStringList& orderByList, QString& errorMessage, const QStringList& projectedFields) const
 {
   Q_ASSERT_X(m_schema.containsTable(tableName), "readTableBySchema", qPrintable(QString("Table [%1] is not in the schema.").arg(tableName)));
 
@@ -535,7 +1110,27 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
   if (table == nullptr) {
       return nullptr;
   }
-  QStringList fieldNames = table->getFieldNames();
+
+  // Take the signature before reading so that a change made while reading makes the cache stale.
+  QString cacheName = TableSnapshotCache::getCacheName(tableName, projectedFields);
+  QString cacheSignature = m_snapshotCache.getSignature(*table, projectedFields, orderByList);
+  GenericDataCollection* cached = m_snapshotCache.load(cacheName, cacheSignature);
+  if (cached != nullptr) {
+      // The dictionaries are in the cache file, so there is nothing to encode.
+      qDebug() << "Read table" << tableName << "from the cache";
+      return cached;
+  }
+  if (m_snapshotCache.isEnabled() && !m_snapshotWriter) {
+      // Read from the DB here, the writer rebuilds the snapshot in the background.
+      QMutexLocker locker(&m_staleSnapshotsMutex);
+      StaleSnapshot stale;
+      stale.tableName = tableName;
+      stale.fieldNames = projectedFields;
+      stale.orderByList = orderByList;
+      m_staleSnapshots.append(stale);
+  }
+
+  QStringList fieldNames = projectedFields.isEmpty() ? table->getFieldNames() : projectedFields;
 
   QString orderBy = "";
 
@@ -576,15 +1171,18 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
 
   QString sql = QString("SELECT %1 FROM %2 %3").arg(sqlFields).arg(tableName).arg(orderBy);
 
-  if (openDB())
   {
     qDebug() << "(1) Reading table using [" << sql << "]";
-    QSqlDatabase& db = getDB();
-    QSqlQuery query(db);
+    QSharedPointer<QSqlQuery> cachedQuery = m_queryCache.prepare(db, sql, errorMessage);
+    if (cachedQuery == nullptr)
+    {
+        return nullptr;
+    }
+    QSqlQuery& query = *cachedQuery;
 
-    if (!query.exec(sql))
+    if (!query.exec())
     {
-        ScrollMessageBox::information(nullptr, "ERROR", query.lastError().text());
+        errorMessage = query.lastError().text();
     }
     else if (query.isSelect())
     {
@@ -603,7 +1201,8 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
 
       if (duplicateColumns.size() > 0)
       {
-        ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Problem converting the following SQL\n\n%1\n\nThe following columns are duplicated:\n%2")).arg(sql).arg(duplicateColumns.join("\n")));
+        errorMessage = QString(tr("Problem converting the following SQL\n\n%1\n\nThe following columns are duplicated:\n%2")).arg(sql).arg(duplicateColumns.join("\n"));
+        query.finish();
         delete collection;
         return nullptr;
       }
@@ -617,17 +1216,33 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
 
       // In case a different name is used for the property name in the field.
       // I doubt if this ever happens.
-      bool hasIdColumn = collection->containsProperty(firstKeyField);
-      QString idString = hasIdColumn ? collection->getPropertyName(firstKeyField) : "";
+      int idColumn = collection->getPropertyIndex(firstKeyField);
       int iCount = 0;
       TypeMapper mapper;
       bool ok;
+
+      // Look up the column types once rather than for every cell.
+      int numColumns = collection->getPropertyNameCount();
+      QList<QMetaType::Type> fieldTypes;
+      for (int i=0; i<numColumns; ++i)
+      {
+        fieldTypes.append(table->getFieldMetaType(collection->getPropertyName(i)));
+      }
+
+      // Fields such as grade and condition have only a few distinct values; encode them as they are read.
+      collection->beginLowCardinalityEncoding();
+
+      // Values go straight into the column storage; the buffer is reused for every row.
+      QList<QVariant> values(numColumns);
       while (query.isActive() && query.next())
       {
-        GenericDataObject* gdo = new GenericDataObject(collection);
-        for (int i=0; i<query.record().count(); ++i)
+        for (int i=0; i<numColumns; ++i)
         {
-          if (!query.record().isNull(i))
+          if (query.isNull(i))
+          {
+            values[i] = QVariant();
+          }
+          else
           {
             // A Variant is returned at this point. The concern is
             // that some data types are stored as a string in the DB and
@@ -635,14 +1250,32 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
             // This is particularly problematic with SQL Light that uses strings for many things.
             // If a BIT Varying type is used, and, if the string length is greater than 1, then string should be used
             // rather than a boolean value. I don't have this problem at the moment, so,ignore it for now.
-            // gdo->setValue(collection->getPropertyName(i), query.record().value(i));
-            gdo->setValueNative(collection->getPropertyName(i), mapper.forceToType(query.record().value(i), table->getFieldMetaType(collection->getPropertyName(i)), &ok));
+            values[i] = mapper.forceToType(query.value(i), fieldTypes.at(i), &ok);
           }
         }
 
-        collection->appendObject(hasIdColumn ? gdo->getInt(idString) : iCount, gdo);
-        ++iCount;
-      }
+        int id = iCount;
+        if (idColumn >= 0)
+        {
+          id = values.at(idColumn).toInt(&ok);
+          if (!ok)
+          {
+            id = -1;
+          }
+        }
+        collection->appendValues(id, values);
+        ++iCount;
+      }
+      query.finish();
+      int numEncoded = collection->endLowCardinalityEncoding();
+      if (numEncoded > 0)
+      {
+        qDebug() << "Dictionary encoded" << numEncoded << "fields in table" << tableName;
+      }
+      // Saved after encoding so that the cache file holds the dictionaries.
+      if (m_snapshotWriter) {
+          m_snapshotCache.saveInBackground(cacheName, cacheSignature, *collection);
+      }
       return collection;
     }
   }
@@ -651,6 +1284,396 @@ GenericDataCollection* StampDB::readTableBySchema(const QString& tableName, cons
   return nullptr;
 }
 
+GenericDataCollection* StampDB::readTableFirstPage(const QString& tableName, const int pageSize)
+{
+  const DescribeSqlTable* table = m_schema.getTableByName(tableName);
+  if (table == nullptr) {
+      return nullptr;
+  }
+
+  QList<int> keys;
+  QList<QList<QVariant> > rows;
+  if (!readTablePage(tableName, std::numeric_limits<int>::min(), pageSize, keys, rows))
+  {
+    return nullptr;
+  }
+
+  GenericDataCollection* collection = new GenericDataCollection();
+  QStringList fieldNames = table->getFieldNames();
+  for (int i=0; i<fieldNames.size(); ++i)
+  {
+    collection->appendPropertyName(fieldNames.at(i), table->getFieldMetaType(fieldNames.at(i)));
+  }
+  for (int i=0; i<rows.size(); ++i)
+  {
+    collection->appendValues(keys.at(i), rows.at(i));
+  }
+  return collection;
+}
+
+bool StampDB::readTablePage(const QString& tableName, const int afterKey, const int pageSize, QList<int>& keys, QList<QList<QVariant> >& rows)
+{
+  keys.clear();
+  rows.clear();
+  const DescribeSqlTable* table = m_schema.getTableByName(tableName);
+  if (table == nullptr || !openDB()) {
+      return false;
+  }
+
+  QString keyField = table->getFirstKeyFieldName();
+  if (keyField.isEmpty()) {
+    keyField = "id";
+  }
+
+  QStringList fieldNames = table->getFieldNames();
+  QStringList sqlFields;
+  QList<QMetaType::Type> fieldTypes;
+  int keyColumn = -1;
+  for (int i=0; i<fieldNames.size(); ++i)
+  {
+    sqlFields << QString("%1.%2").arg(tableName, fieldNames.at(i));
+    fieldTypes.append(table->getFieldMetaType(fieldNames.at(i)));
+    if (fieldNames.at(i).compare(keyField, Qt::CaseInsensitive) == 0)
+    {
+      keyColumn = i;
+    }
+  }
+  if (keyColumn < 0)
+  {
+    qDebug() << "Cannot page table" << tableName << "without the key field" << keyField;
+    return false;
+  }
+
+  // Keyset paging; the key index makes each page cost the same no matter how deep.
+  QString sql = QString("SELECT %1 FROM %2 WHERE %2.%3 > :afterKey ORDER BY %2.%3 LIMIT :pageSize").arg(sqlFields.join(", "), tableName, keyField);
+  QString errorMessage;
+  QSharedPointer<QSqlQuery> cachedQuery = m_queryCache.prepare(getDB(), sql, errorMessage);
+  if (cachedQuery == nullptr)
+  {
+    reportMessage("ERROR", errorMessage);
+    return false;
+  }
+  QSqlQuery& query = *cachedQuery;
+  query.bindValue(":afterKey", afterKey);
+  query.bindValue(":pageSize", pageSize);
+  if (!query.exec())
+  {
+    reportMessage("ERROR", query.lastError().text());
+    return false;
+  }
+
+  TypeMapper mapper;
+  bool ok;
+  const int numColumns = fieldTypes.size();
+  while (query.next())
+  {
+    QList<QVariant> values(numColumns);
+    for (int i=0; i<numColumns; ++i)
+    {
+      if (!query.isNull(i))
+      {
+        values[i] = mapper.forceToType(query.value(i), fieldTypes.at(i), &ok);
+      }
+    }
+    int key = values.at(keyColumn).toInt(&ok);
+    keys.append(ok ? key : -1);
+    rows.append(values);
+  }
+  query.finish();
+  return true;
+}
+
+bool StampDB::readTableChanges(const QString& tableName, const GenericDataCollection& collection, QList<int>& keys, QList<QList<QVariant> >& rows, QList<int>& deletedIds)
+{
+  keys.clear();
+  rows.clear();
+  deletedIds.clear();
+  const DescribeSqlTable* table = m_schema.getTableByName(tableName);
+  if (table == nullptr || !table->containsField("updated") || !collection.containsProperty("updated") || !openDB()) {
+      return false;
+  }
+
+  QString keyField = table->getFirstKeyFieldName();
+  if (keyField.isEmpty()) {
+    keyField = "id";
+  }
+  const int keyColumn = collection.getPropertyIndex(keyField);
+  if (keyColumn < 0)
+  {
+    qDebug() << "Cannot refresh table" << tableName << "without the key field" << keyField;
+    return false;
+  }
+
+  // High-water mark is the most recent update already in the collection.
+  QDateTime highWaterMark = collection.getLatestDateTime("updated");
+  if (!highWaterMark.isValid())
+  {
+    highWaterMark = QDateTime(QDate(1, 1, 1), QTime(0, 0));
+  }
+  const int largestId = collection.getLargestId();
+
+  QStringList sqlFields;
+  QList<QMetaType::Type> fieldTypes;
+  for (int i=0; i<collection.getPropertyNameCount(); ++i)
+  {
+    const QString& fieldName = collection.getPropertyName(i);
+    sqlFields << QString("%1.%2").arg(tableName, fieldName);
+    fieldTypes.append(collection.getPropertyTypeMeta(i));
+  }
+
+  // "updated" is stored as ISO text ("yyyy-MM-ddThh:mm:ss" with optional milliseconds) by Qt and by loadCSV,
+  // so a plain text comparison can use the index; wrapping the field in datetime() would scan the table.
+  // The mark drops the milliseconds, so rows in the same second as the mark are read again; that is harmless.
+  QString sql = QString("SELECT %1 FROM %2 WHERE %2.updated >= :mark OR %2.%3 > :largestId ORDER BY %2.%3").arg(sqlFields.join(", "), tableName, keyField);
+  QString errorMessage;
+  QSharedPointer<QSqlQuery> cachedQuery = m_queryCache.prepare(getDB(), sql, errorMessage);
+  if (cachedQuery == nullptr)
+  {
+    reportMessage("ERROR", errorMessage);
+    return false;
+  }
+  QSqlQuery& query = *cachedQuery;
+  query.bindValue(":mark", highWaterMark.toString("yyyy-MM-ddThh:mm:ss"));
+  query.bindValue(":largestId", largestId);
+  if (!query.exec())
+  {
+    reportMessage("ERROR", query.lastError().text());
+    return false;
+  }
+
+  TypeMapper mapper;
+  bool ok;
+  const int numColumns = fieldTypes.size();
+  int numNewRows = 0;
+  while (query.next())
+  {
+    QList<QVariant> values(numColumns);
+    for (int i=0; i<numColumns; ++i)
+    {
+      if (!query.isNull(i))
+      {
+        values[i] = mapper.forceToType(query.value(i), fieldTypes.at(i), &ok);
+      }
+    }
+    int key = values.at(keyColumn).toInt(&ok);
+    if (!ok)
+    {
+      continue;
+    }
+    if (!collection.containsObject(key))
+    {
+      ++numNewRows;
+    }
+    keys.append(key);
+    rows.append(values);
+  }
+
+  query.finish();
+
+  // Cheap check first; if nothing was deleted, the count matches.
+  int numDatabaseRows = getIdFromSql(QString("SELECT COUNT(*) FROM %1").arg(tableName));
+  if (numDatabaseRows < 0)
+  {
+    return false;
+  }
+  if (numDatabaseRows == collection.getObjectCount() + numNewRows)
+  {
+    return true;
+  }
+
+  sql = QString("SELECT %1.%2 FROM %1").arg(tableName, keyField);
+  QSharedPointer<QSqlQuery> idQuery = m_queryCache.prepare(getDB(), sql, errorMessage);
+  if (idQuery == nullptr || !idQuery->exec())
+  {
+    reportMessage("ERROR", (idQuery == nullptr) ? errorMessage : idQuery->lastError().text());
+    return false;
+  }
+  QSet<int> databaseIds;
+  while (idQuery->next())
+  {
+    databaseIds.insert(idQuery->value(0).toInt());
+  }
+  idQuery->finish();
+  // The object ID is the key, so the IDs are compared without reading the key field of each row.
+  const QList<int>& collectionIds = collection.getIds();
+  for (int i=0; i<collectionIds.size(); ++i)
+  {
+    if (!databaseIds.contains(collectionIds.at(i)))
+    {
+      deletedIds.append(collectionIds.at(i));
+    }
+  }
+  return true;
+}
+
+bool StampDB::refreshTable(const QString& tableName, GenericDataCollection& collection)
+{
+  QList<int> keys;
+  QList<QList<QVariant> > rows;
+  QList<int> deletedIds;
+  if (!readTableChanges(tableName, collection, keys, rows, deletedIds))
+  {
+    return false;
+  }
+  collection.removeObjects(deletedIds);
+  for (int i=0; i<keys.size(); ++i)
+  {
+    if (!collection.updateValues(keys.at(i), rows.at(i)))
+    {
+      collection.appendValues(keys.at(i), rows.at(i));
+    }
+  }
+  return true;
+}
+
+bool StampDB::reloadTable(const QString& tableName, GenericDataCollection& collection)
+{
+  if (refreshTable(tableName, collection)) {
+    return true;
+  }
+  const DescribeSqlTable* table = m_schema.getTableByName(tableName);
+  if (table == nullptr || !openDB()) {
+    return false;
+  }
+
+  // Read every field as an empty list so that the snapshot cache file for the whole table is used.
+  QStringList projectedFields;
+  if (collection.getPropertyNameCount() != table->getFieldCount()) {
+    projectedFields = collection.getPropertNames();
+  }
+  QString errorMessage;
+  GenericDataCollection* collectionFromDB = readTableBySchema(m_db, tableName, getKeyFieldNames(tableName), errorMessage, projectedFields);
+  reportStaleSnapshots();
+  if (collectionFromDB == nullptr) {
+    qDebug() << "Failed to read table" << tableName << errorMessage;
+    return false;
+  }
+  collection = *collectionFromDB;
+  delete collectionFromDB;
+  return true;
+}
+
+void StampDB::startChangeMonitor(const int intervalMs)
+{
+  if (m_changeMonitorTimer == nullptr) {
+    m_changeMonitorTimer = new QTimer(this);
+    connect(m_changeMonitorTimer, SIGNAL(timeout()), this, SLOT(checkDataVersion()));
+  }
+  // Read the current version so that only later changes are reported.
+  checkDataVersion();
+  m_changeMonitorTimer->start(intervalMs);
+}
+
+void StampDB::stopChangeMonitor()
+{
+  if (m_changeMonitorTimer != nullptr) {
+    m_changeMonitorTimer->stop();
+  }
+}
+
+void StampDB::checkDataVersion()
+{
+  // Do not open the DB just to see if it changed.
+  if (!m_db.isOpen()) {
+    return;
+  }
+  // One small PRAGMA, so it is cheap to run every second.
+  QString errorMessage;
+  QSharedPointer<QSqlQuery> cachedQuery = m_queryCache.prepare(m_db, "PRAGMA data_version", errorMessage);
+  if (cachedQuery == nullptr) {
+    qDebug() << "Failed to read data_version:" << errorMessage;
+    return;
+  }
+  QSqlQuery& query = *cachedQuery;
+  if (!query.exec() || !query.next()) {
+    qDebug() << "Failed to read data_version:" << query.lastError().text();
+    return;
+  }
+  qint64 dataVersion = query.value(0).toLongLong();
+  query.finish();
+
+  if (m_dataVersion < 0) {
+    // First check on this connection; only later changes are reported.
+    m_dataVersion = dataVersion;
+    findChangedTables();
+    return;
+  }
+  bool changed = (dataVersion != m_dataVersion);
+  m_dataVersion = dataVersion;
+  if (changed) {
+    // Wait for a quiet check so that a burst of commits, such as an import, is reported once.
+    ++m_numChangeChecks;
+    if (m_numChangeChecks < MaxChangeMonitorDelay) {
+      return;
+    }
+  } else if (m_numChangeChecks == 0) {
+    return;
+  }
+  m_numChangeChecks = 0;
+
+  QStringList changedTables = findChangedTables();
+  if (!changedTables.isEmpty()) {
+    qDebug() << "Another connection changed" << changedTables << "in" << m_pathToDB;
+    emit tablesChanged(changedTables, m_changeMonitorTimer);
+  }
+}
+
+QStringList StampDB::findChangedTables()
+{
+  QStringList changedTables;
+  QHash<QString, qint64> counters;
+  // The triggers from createChangeCounters count every insert, update, and delete, so no table is scanned.
+  QString errorMessage;
+  QSharedPointer<QSqlQuery> query = m_queryCache.prepare(m_db, "SELECT name, counter FROM tablechanges", errorMessage);
+  if (query == nullptr || !query->exec()) {
+    // The table is added by upgradeSchema, which may not have run yet.
+    qDebug() << "Failed to read the change counters:" << ((query == nullptr) ? errorMessage : query->lastError().text());
+    return changedTables;
+  }
+  while (query->next()) {
+    const QString tableName = query->value(0).toString();
+    const qint64 counter = query->value(1).toLongLong();
+    const QString key = tableName.toLower();
+    QHash<QString, qint64>::const_iterator it = m_tableCounters.constFind(key);
+    if (it != m_tableCounters.constEnd() && it.value() != counter) {
+      changedTables << tableName;
+    }
+    counters.insert(key, counter);
+  }
+  query->finish();
+  m_tableCounters = counters;
+  return changedTables;
+}
+
+void StampDB::notifyTablesChanged(const QStringList& tableNames, QObject* source)
+{
+  if (!tableNames.isEmpty()) {
+    // Already reported, so the change monitor only records their new values.
+    for (int i=0; i<tableNames.size(); ++i) {
+      m_tableCounters.remove(tableNames.at(i).toLower());
+    }
+    emit tablesChanged(tableNames, source);
+  }
+}
+
+QStringList StampDB::getTablesChangedBy(const QString& sql)
+{
+  QRegularExpression changeRegExp("\\b(?:INSERT\\s+(?:OR\\s+\\w+\\s+)?INTO|REPLACE\\s+INTO|UPDATE(?:\\s+OR\\s+\\w+)?|DELETE\\s+FROM|ALTER\\s+TABLE|DROP\\s+TABLE(?:\\s+IF\\s+EXISTS)?)\\s+[\"'`\\[]?(\\w+)", QRegularExpression::CaseInsensitiveOption);
+  QStringList allTableNames = getTableNames(true);
+  QStringList tableNames;
+  QRegularExpressionMatchIterator it = changeRegExp.globalMatch(sql);
+  while (it.hasNext()) {
+    const QString name = it.next().captured(1);
+    for (int i=0; i<allTableNames.size(); ++i) {
+      if (allTableNames.at(i).compare(name, Qt::CaseInsensitive) == 0 && !tableNames.contains(allTableNames.at(i))) {
+        tableNames << allTableNames.at(i);
+      }
+    }
+  }
+  // A trigger, or something not matched such as CREATE INDEX, may change anything.
+  return tableNames.isEmpty() ? allTableNames : tableNames;
+}
+
 GenericDataCollection* StampDB::readTableSql(const QString& sql)
 {
   if (openDB())
@@ -661,7 +1684,7 @@ GenericDataCollection* StampDB::readTableSql(const QString& sql)
 
     if (!query.exec(sql))
     {
-        ScrollMessageBox::information(nullptr, "ERROR", query.lastError().text());
+        reportMessage("ERROR", query.lastError().text());
     }
     else if (query.isSelect())
     {
@@ -680,25 +1703,32 @@ GenericDataCollection* StampDB::readTableSql(const QString& sql)
       }
       if (duplicateColumns.size() > 0)
       {
-        ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Problem converting the following SQL\n\n%1\n\nThe following columns are duplicated:\n%2")).arg(sql).arg(duplicateColumns.join("\n")));
+        reportMessage("ERROR", QString(tr("Problem converting the following SQL\n\n%1\n\nThe following columns are duplicated:\n%2")).arg(sql).arg(duplicateColumns.join("\n")));
         delete collection;
         return nullptr;
       }
 
-      bool hasIdColumn = collection->containsProperty("id");
-      QString idString = hasIdColumn ? collection->getPropertyName("id") : "";
+      int idColumn = collection->getPropertyIndex("id");
       int iCount = 0;
+      bool ok;
+      int numColumns = collection->getPropertyNameCount();
+      QList<QVariant> values(numColumns);
       while (query.isActive() && query.next())
       {
-        GenericDataObject* gdo = new GenericDataObject(collection);
-        for (int i=0; i<query.record().count(); ++i)
+        for (int i=0; i<numColumns; ++i)
+        {
+          values[i] = query.isNull(i) ? QVariant() : query.value(i);
+        }
+        int id = iCount;
+        if (idColumn >= 0)
         {
-          if (!query.record().isNull(i))
+          id = values.at(idColumn).toInt(&ok);
+          if (!ok)
           {
-            gdo->setValueNative(collection->getPropertyName(i), query.record().value(i));
+            id = -1;
           }
         }
-        collection->appendObject(hasIdColumn ? gdo->getInt(idString) : iCount, gdo);
+        collection->appendValues(id, values);
         ++iCount;
       }
       return collection;
@@ -714,7 +1744,7 @@ QString StampDB::getClosestTableName(const QString& aName)
   {
 
     QStringList tables = m_db.tables(QSql::Tables);
-    //ScrollMessageBox::information(nullptr, "Tables", tables.join("\n"));
+    //reportMessage("Tables", tables.join("\n"));
     int i = tables.indexOf(aName);
     if (i >= 0)
     {
@@ -736,19 +1766,23 @@ QStringList StampDB::getOneColumnAsString(const QString& sqlSelect)
     QStringList colStrings;
     if (openDB())
     {
-        QSqlDatabase& db = getDB();
-        QSqlQuery query(db);
-
-        if (!query.exec(sqlSelect))
+        QString errorMessage;
+        QSharedPointer<QSqlQuery> query = m_queryCache.prepare(getDB(), sqlSelect, errorMessage);
+        if (query == nullptr)
+        {
+            reportMessage("ERROR", errorMessage);
+        }
+        else if (!query->exec())
         {
-            ScrollMessageBox::information(nullptr, "ERROR", query.lastError().text());
+            reportMessage("ERROR", query->lastError().text());
         }
-        else if (query.isSelect())
+        else if (query->isSelect())
         {
-            while (query.isActive() && query.next())
+            while (query->isActive() && query->next())
             {
-                colStrings.append(query.record().value(0).toString());
+                colStrings.append(query->value(0).toString());
             }
+            query->finish();
         }
     }
 
@@ -762,47 +1796,16 @@ bool StampDB::executeQuery(const QString& sqlSelect, QList<QSqlRecord>& records,
       return false;
     }
 
-    QSqlDatabase& db = getDB();
-    QSqlQuery query(db);
-    query.prepare(sqlSelect);
-    return executeQuery(query, records, keyField, keys);
-    /**
-    if (!query.exec(sqlSelect))
+    QString errorMessage;
+    QSharedPointer<QSqlQuery> query = m_queryCache.prepare(getDB(), sqlSelect, errorMessage);
+    if (query == nullptr)
     {
-        ScrollMessageBox::information(nullptr, "ERROR", query.lastError().text());
+        reportMessage("ERROR", errorMessage);
         return false;
     }
-    else if (query.isSelect())
-    {
-
-        int keyIndex = query.record().indexOf(keyField);
-        int recordKey = -1;
-
-        while (query.isActive() && query.next())
-        {
-            QSqlRecord rec = query.record();
-            if (keyIndex >= 0)
-            {
-                bool ok = false;
-                recordKey = rec.value(keyIndex).toInt(&ok);
-                if (keys.contains(recordKey)) {
-
-                    // I really do not expect this, but, do it anyway.
-                    // Replace the previous record.
-                    records[keys[recordKey]] = rec;
-                } else {
-                    keys.insert(recordKey, records.size());
-                    records.append(rec);
-                }
-            } else {
-                records.append(rec);
-            }
-        }
-    } else {
-        // query.numRowsAffected();
-    }
-    return true;
-**/
+    bool rc = executeQuery(*query, records, keyField, keys);
+    query->finish();
+    return rc;
 }
 
 bool StampDB::executeQuery(QSqlQuery& query,  QList<QSqlRecord>& records, const QString& keyField, QHash<int, int>& keys)
@@ -810,7 +1813,7 @@ bool StampDB::executeQuery(QSqlQuery& query,  QList<QSqlRecord>& records, const
 
     if (!query.exec())
     {
-        ScrollMessageBox::information(nullptr, "ERROR", query.lastError().text());
+        reportMessage("ERROR", query.lastError().text());
         return false;
     }
     else if (query.isSelect())
@@ -846,12 +1849,16 @@ bool StampDB::executeQuery(QSqlQuery& query,  QList<QSqlRecord>& records, const
 }
 
 
-bool StampDB::exportToCSV(const QDir& outputDir, const bool overwrite)
+bool StampDB::exportToCSV(const QDir& outputDir, const bool overwrite, QProgressDialog* progress)
 {
+    if (!openDB())
+    {
+        return false;
+    }
     QFile ddlFile(outputDir.filePath("stamps.ddl"));
     if (ddlFile.exists() && overwrite) {
         if (!ddlFile.remove()) {
-            ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to remove file %1")).arg(ddlFile.fileName()));
+            reportMessage("ERROR", QString(tr("Failed to remove file %1")).arg(ddlFile.fileName()));
         }
     }
     if (!ddlFile.exists())
@@ -859,50 +1866,182 @@ bool StampDB::exportToCSV(const QDir& outputDir, const bool overwrite)
         QStringList ddl = getDDLForExport();
         if (!ddlFile.open(QIODevice::WriteOnly | QIODevice::Text))
         {
-            ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to open file %1 for writing.")).arg(ddlFile.fileName()));
+            reportMessage("ERROR", QString(tr("Failed to open file %1 for writing.")).arg(ddlFile.fileName()));
         }
         QTextStream out(&ddlFile);
         out << ddl.join("\n");
         ddlFile.close();
     }
 
-    QStringList tableNames = getTableNames(true);
-    for (int iTable=0; iTable < tableNames.size(); ++iTable)
+    // Decide which tables to write on this thread; the files are written by the workers.
+    QStringList allTableNames = getTableNames(true);
+    QStringList tableNames;
+    QStringList fileNames;
+    QStringList orderByList;
+    for (int iTable=0; iTable < allTableNames.size(); ++iTable)
     {
-      QFile file(outputDir.filePath(tableNames.at(iTable) + ".csv"));
+        QFile file(outputDir.filePath(allTableNames.at(iTable) + ".csv"));
         if (file.exists() && overwrite) {
             if (!file.remove()) {
-                ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to remove file %1")).arg(file.fileName()));
+                reportMessage("ERROR", QString(tr("Failed to remove file %1")).arg(file.fileName()));
             }
         }
         if (!file.exists())
         {
-            CSVWriter writer;
-            if (!writer.setStreamFromPath(file.fileName()))
+            QStringList keyFields = getKeyFieldNames(allTableNames.at(iTable));
+            if (keyFields.isEmpty() && m_db.record(allTableNames.at(iTable)).contains("id")) {
+                keyFields << "id";
+            }
+            tableNames << allTableNames.at(iTable);
+            fileNames << file.fileName();
+            orderByList << keyFields.join(", ");
+        }
+    }
+
+    // Each table is written by its own worker with its own connection to the same database file.
+    QStringList errors;
+    for (int i=0; i<tableNames.size(); ++i) {
+        errors << QString();
+    }
+    QString* errorMessages = errors.data();
+    QAtomicInt rowsWritten(0);
+    QAtomicInt tablesDone(0);
+    QAtomicInt canceled(0);
+    QAtomicInt* rowsWrittenPtr = &rowsWritten;
+    QAtomicInt* tablesDonePtr = &tablesDone;
+    QAtomicInt* canceledPtr = &canceled;
+    const QString dbPath = m_pathToDB;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, qMin(QThread::idealThreadCount(), tableNames.size())));
+    for (int i=0; i<tableNames.size(); ++i)
+    {
+        const QString tableName = tableNames.at(i);
+        const QString fileName = fileNames.at(i);
+        const QString orderBy = orderByList.at(i);
+        pool.start([i, tableName, fileName, orderBy, dbPath, errorMessages, rowsWrittenPtr, tablesDonePtr, canceledPtr]() {
+            const QString connectionName = QString("StampDBExport_%1").arg(QUuid::createUuid().toString());
+            {
+                QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+                db.setDatabaseName(dbPath);
+                if (db.open()) {
+                    exportTableToCSV(db, tableName, orderBy, fileName, errorMessages[i], *rowsWrittenPtr, *canceledPtr);
+                    db.close();
+                } else {
+                    errorMessages[i] = db.lastError().text();
+                }
+            }
+            QSqlDatabase::removeDatabase(connectionName);
+            tablesDonePtr->fetchAndAddRelaxed(1);
+        });
+    }
+
+    if (progress != nullptr)
+    {
+        progress->setRange(0, tableNames.size());
+    }
+    while (!pool.waitForDone(100))
+    {
+        QString text = QString(tr("Exported %1 of %2 tables, %3 rows")).arg(tablesDone.loadRelaxed()).arg(tableNames.size()).arg(rowsWritten.loadRelaxed());
+        emit this->progress(tablesDone.loadRelaxed(), tableNames.size(), text);
+        if (progress != nullptr)
+        {
+            // setValue processes events for a modal dialog so that the label and cancel button work.
+            progress->setLabelText(text);
+            progress->setValue(tablesDone.loadRelaxed());
+            if (progress->wasCanceled()) {
+                requestCancel();
+            }
+        }
+        if (isCancelRequested()) {
+            canceled.storeRelaxed(1);
+        }
+    }
+    if (progress != nullptr)
+    {
+        progress->setValue(tableNames.size());
+    }
+
+    QStringList errorList;
+    for (int i=0; i<errors.size(); ++i)
+    {
+        if (!errors.at(i).isEmpty()) {
+            errorList << errors.at(i);
+        }
+    }
+    if (!errorList.isEmpty()) {
+        reportMessage("ERROR", errorList.join("\n"));
+    }
+    qDebug() << "Exported" << rowsWritten.loadRelaxed() << "rows from" << tableNames.size() << "tables";
+    return errorList.isEmpty() && canceled.loadRelaxed() == 0;
+}
+
+bool StampDB::exportTableToCSV(QSqlDatabase& db, const QString& tableName, const QString& orderBy, const QString& fileName, QString& errorMessage, QAtomicInt& rowsWritten, const QAtomicInt& canceled)
+{
+    QSqlQuery query(db);
+    // Rows are written as they are read, so nothing needs to be kept behind the cursor.
+    query.setForwardOnly(true);
+    QString sql = QString("SELECT * FROM %1").arg(tableName);
+    if (!orderBy.isEmpty()) {
+        sql += QString(" ORDER BY %1").arg(orderBy);
+    }
+    if (!query.exec(sql))
+    {
+        errorMessage = QString(tr("Failed to load table %1 for export: %2")).arg(tableName, query.lastError().text());
+        return false;
+    }
+
+    CSVWriter writer;
+    if (!writer.setStreamFromPath(fileName))
+    {
+        errorMessage = QString(tr("Write: Failed to open CSV file %1")).arg(fileName);
+        return false;
+    }
+
+    QSqlRecord record = query.record();
+    const int numColumns = record.count();
+    QList<QMetaType::Type> columnTypes;
+    for (int i=0; i<numColumns; ++i)
+    {
+        QMetaType::Type columnType = (QMetaType::Type) record.field(i).metaType().id();
+        columnTypes << columnType;
+        writer.addHeader(record.fieldName(i), columnType);
+    }
+    writer.writeHeader();
+
+    // Columns are written directly rather than building a CSVLine for each row.
+    int numRows = 0;
+    while (query.next())
+    {
+        for (int i=0; i<numColumns; ++i)
+        {
+            if (i > 0)
             {
-              ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Write: Failed to open CSV file %1")).arg(file.fileName()));
+                writer.writeColumnSeparator();
             }
-            else
+            if (!query.isNull(i))
             {
-              //ScrollMessageBox::information(nullptr, "INFO", QString(tr("ready to read from table %1")).arg(tableNames.at(iTable)));
-              GenericDataCollection* gdo = readTableName(tableNames.at(iTable));
-              //ScrollMessageBox::information(nullptr, "INFO", QString(tr("read %1 records from table ")).arg(gdo->getObjectCount()));
-              if (gdo == nullptr)
-              {
-                ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to load table %1 for export")).arg(tableNames.at(iTable)));
-              }
-              else
-              {
-                gdo->exportToCSV(writer);
-                delete gdo;
-              }
+                writer.write(CSVColumn(query.value(i).toString(), columnTypes.at(i) == QMetaType::QString, columnTypes.at(i)));
+            }
+        }
+        writer.writeRecordSeparator();
+        if (++numRows % ExportProgressRows == 0)
+        {
+            rowsWritten.fetchAndAddRelaxed(ExportProgressRows);
+            if (canceled.loadRelaxed() != 0)
+            {
+                writer.cleanup();
+                QFile::remove(fileName);
+                return false;
             }
         }
     }
+    rowsWritten.fetchAndAddRelaxed(numRows % ExportProgressRows);
+    writer.cleanup();
     return true;
 }
 
-bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
+bool StampDB::loadCSV(CSVReader& reader, const QString& tableName, const bool upsert, const int batchSize, const int rowsPerCommit)
 {
   if (!openDB())
   {
@@ -911,7 +2050,7 @@ bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
   QString useTableName = getClosestTableName(tableName);
   if (tableName.isEmpty())
   {
-    ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to find a table with a name close to the CSV filename %1")).arg(tableName));
+    reportMessage("ERROR", QString(tr("Failed to find a table with a name close to the CSV filename %1")).arg(tableName));
     return false;
   }
 
@@ -925,7 +2064,7 @@ bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
 
   if (fieldNames.size() == 0)
   {
-    ScrollMessageBox::information(nullptr, "WARN", QString(tr("Table %1 has no fields.")).arg(useTableName));
+    reportMessage("WARN", QString(tr("Table %1 has no fields.")).arg(useTableName));
     return false;
   }
 
@@ -950,72 +2089,88 @@ bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
 
   if (!sError.isEmpty())
   {
-      ScrollMessageBox::information(nullptr, "WARN", sError);
+      reportMessage("WARN", sError);
       sError.clear();
   }
 
   if (numberOfColumnMatches == 0)
   {
-    ScrollMessageBox::information(nullptr, "WARN", QString(tr("No column names in the CSV file match column names in Table %1.")).arg(useTableName));
+    reportMessage("WARN", QString(tr("No column names in the CSV file match column names in Table %1.")).arg(useTableName));
     return false;
   }
 
-  QString sGetAll = QString("SELECT * FROM %1").arg(useTableName);
-  QList<QSqlRecord> records;
-  const QString keyField = "id";
-  QHash<int, int> keys;
-  int csvKeyColumn = -1;
-  if (!executeQuery(sGetAll, records, keyField, keys)) {
-      // TODO: how to deal with an error?
-  }
-
   // TODO: Verify that a column is not repeated, ie, two CSV columns match to the same DB column.
 
-  // TODO: build the prepared statement
-  // Use positional rather than named
-  QString q1 = QString("INSERT INTO %1 (").arg(useTableName);
-  QString q2 = ") VALUES (";
-  bool firstLine = true;
+  // Positional placeholders; one for each database column that has a CSV column.
+  const QString keyField = "id";
+  QList<int> boundCsvColumns;
+  int csvKeyColumn = -1;
+  QStringList insertFields;
+  QStringList placeholders;
+  QStringList updateAssignments;
   for (int iCol=0; iCol<csvColumnIndex.size(); ++iCol)
   {
-    // Verify that a column in the DB has a corresponding entry
-    // in the CSV file
     if (0 <= csvColumnIndex[iCol])
     {
-      if (firstLine)
-      {
-        firstLine = false;
-        q2 += "?";
-      }
-      else
-      {
-        q1 += ", ";
-        q2 += ", ?";
-      }
-      q1 += fieldNames[iCol];
+      boundCsvColumns << csvColumnIndex[iCol];
+      insertFields << fieldNames[iCol];
+      placeholders << "?";
       if (csvKeyColumn < 0 && fieldNames[iCol].compare(keyField, Qt::CaseInsensitive) == 0) {
-          csvKeyColumn = iCol;
+        csvKeyColumn = csvColumnIndex[iCol];
+      } else {
+        updateAssignments << QString("%1=excluded.%1").arg(fieldNames[iCol]);
       }
     }
   }
-  q2 += ")";
 
-  QSqlQuery q;
-  if (!q.prepare(q1 + q2))
+  QString sql = QString("INSERT INTO %1 (%2) VALUES (%3)").arg(useTableName, insertFields.join(", "), placeholders.join(", "));
+  const bool doUpsert = upsert && csvKeyColumn >= 0;
+  // An updated row must move "updated" forward, or refreshTable does not see the change.
+  // Local time in ISO format, which is how the table model writes it.
+  if (doUpsert && !updateAssignments.isEmpty() && fieldNames.contains("updated", Qt::CaseInsensitive) && !insertFields.contains("updated", Qt::CaseInsensitive)) {
+    updateAssignments << "updated=strftime('%Y-%m-%dT%H:%M:%S', 'now', 'localtime')";
+  }
+  if (doUpsert) {
+    if (updateAssignments.isEmpty()) {
+      sql += QString(" ON CONFLICT(%1) DO NOTHING").arg(keyField);
+    } else {
+      sql += QString(" ON CONFLICT(%1) DO UPDATE SET %2").arg(keyField, updateAssignments.join(", "));
+    }
+  }
+
+  // Without an upsert, a row whose key exists is skipped; only the key column is read to find them.
+  QSet<int> existingKeys;
+  if (!doUpsert && csvKeyColumn >= 0) {
+    QSqlQuery keyQuery(m_db);
+    if (!keyQuery.exec(QString("SELECT %1 FROM %2").arg(keyField, useTableName))) {
+      reportMessage("ERROR", keyQuery.lastError().text());
+      return false;
+    }
+    while (keyQuery.next()) {
+      existingKeys.insert(keyQuery.value(0).toInt());
+    }
+  }
+
+  QSqlQuery q(m_db);
+  if (!q.prepare(sql))
   {
-    ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Prepare statement failed for (%1) error: %2")).arg(q1+q2).arg(q.lastError().text()));
+    reportMessage("ERROR", QString(tr("Prepare statement failed for (%1) error: %2")).arg(sql).arg(q.lastError().text()));
     return false;
   }
-  ScrollMessageBox::information(nullptr, "INFO", QString(tr("Prepared statement (%1)")).arg(q1+q2));
+  reportMessage("INFO", QString(tr("Prepared statement (%1)")).arg(sql));
 
   bool useTransactions = m_db.driver()->hasFeature(QSqlDriver::Transactions);
   if (useTransactions && !m_db.transaction())
   {
-    ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to begin a transaction: %1")).arg(q.lastError().text()));
+    reportMessage("ERROR", QString(tr("Failed to begin a transaction: %1")).arg(m_db.lastError().text()));
     return false;
   }
 
-  int numRowsAdded = 0;
+  // Values are collected a column at a time for execBatch.
+  QList<QVariantList> batch(boundCsvColumns.size());
+  QList<int> batchRows;
+  int numRowsWritten = 0;
+  int numRowsSinceCommit = 0;
   int numRowsSkipped = 0;
   int numErrors = 0;
   QString errorMessage;
@@ -1036,55 +2191,70 @@ bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
         }
     }
 
-    for (int iCol=0; iCol<csvColumnIndex.size(); ++iCol)
+    if (!doUpsert && csvKeyValue >= 0)
     {
-      // Verify that a column in the DB has a corresponding entry
-      // in the CSV file
-      if (0 <= csvColumnIndex[iCol])
+      if (existingKeys.contains(csvKeyValue))
       {
-        // verify that the CSV file has at least
-        // that many columns in the current line.
-        if (csvColumnIndex[iCol] < readLine.size())
-        {
-          const CSVColumn& c = readLine[csvColumnIndex[iCol]];
-          QVariant v = c.toVariant();
-          // Insert this into the prepared statement
-          q.bindValue(iCol, v);
-        }
-        else
-        {
-          // Get a null value based on the expected type for the column.
-          q.bindValue(iCol, reader.getNullVariant(csvColumnIndex[iCol]));
-        }
+        ++numRowsSkipped;
+        continue;
+      }
+      existingKeys.insert(csvKeyValue);
+    }
+
+    for (int iBound=0; iBound<boundCsvColumns.size(); ++iBound)
+    {
+      // verify that the CSV file has at least
+      // that many columns in the current line.
+      const int csvColumn = boundCsvColumns.at(iBound);
+      if (csvColumn < readLine.size())
+      {
+        batch[iBound].append(readLine[csvColumn].toVariant());
       }
       else
       {
-        qDebug() << "E: " << iRow << " " << iCol;
+        // Get a null value based on the expected type for the column.
+        batch[iBound].append(reader.getNullVariant(csvColumn));
       }
     }
-    if (csvKeyValue < 0 || !keys.contains(csvKeyValue))
+    batchRows.append(iRow);
+
+    if (batchRows.size() >= batchSize)
     {
-        if (q.exec())
+      int n = batchRows.size();
+      numRowsWritten += execCSVBatch(q, batch, batchRows, errorMessage, numErrors);
+      numRowsSinceCommit += n;
+      emit progress(iRow + 1, -1, QString(tr("Read %1 rows into %2")).arg(iRow + 1).arg(useTableName));
+      if (isCancelRequested())
+      {
+        // Rows committed before this chunk are kept.
+        if (useTransactions)
         {
-          ++numRowsAdded;
+          m_db.rollback();
         }
-        else
+        reportMessage("WARN", QString(tr("Import canceled after reading %1 rows; rows before the last commit were kept.")).arg(iRow + 1));
+        notifyTablesChanged(QStringList() << useTableName);
+        return false;
+      }
+      if (useTransactions && numRowsSinceCommit >= rowsPerCommit)
+      {
+        // Commit in chunks so that the journal does not hold the entire file.
+        if (!m_db.commit() || !m_db.transaction())
         {
-          if (numErrors > 0)
-          {
-            errorMessage += "\n";
-          }
-          errorMessage += QString("Row %1 : %2").arg(iRow).arg(q.lastError().text());
-          ++numErrors;
+          reportMessage("ERROR", QString(tr("Failed to commit after reading %1 rows: %2")).arg(iRow + 1).arg(m_db.lastError().text()));
+          return false;
         }
-    } else {
-        // TODO: use an update instead!
-        ++numRowsSkipped;
+        numRowsSinceCommit = 0;
+      }
     }
   }
+  numRowsWritten += execCSVBatch(q, batch, batchRows, errorMessage, numErrors);
 
   QString status = "INFO";
-  sError = QString(tr("Added %1 / %2 rows into table %3")).arg(numRowsAdded).arg(iRow).arg(useTableName);
+  if (doUpsert) {
+    sError = QString(tr("Inserted or updated %1 / %2 rows in table %3")).arg(numRowsWritten).arg(iRow).arg(useTableName);
+  } else {
+    sError = QString(tr("Added %1 / %2 rows into table %3")).arg(numRowsWritten).arg(iRow).arg(useTableName);
+  }
 
   if (numRowsSkipped > 0) {
       sError += "\n";
@@ -1096,21 +2266,94 @@ bool StampDB::loadCSV(CSVReader& reader, const QString& tableName)
   {
       sError += "\n";
       sError += QString(tr("Had %1 errors.")).arg(numErrors);
+      sError += "\n";
+      sError += errorMessage;
       status = "ERROR";
   }
 
 
   if (useTransactions && !m_db.commit())
   {
-    ScrollMessageBox::information(nullptr, "ERROR", QString(tr("Failed to begin end the transaction after reading %1 rows: %2")).arg(iRow).arg(q.lastError().text()));
+    reportMessage("ERROR", QString(tr("Failed to begin end the transaction after reading %1 rows: %2")).arg(iRow).arg(m_db.lastError().text()));
     return false;
   }
   else
   {
-    ScrollMessageBox::information(nullptr, status, sError);
+    reportMessage(status, sError);
   }
 
+  if (numRowsWritten > 0) {
+    notifyTablesChanged(QStringList() << useTableName);
+  }
   return true;
 }
 
+int StampDB::execCSVBatch(QSqlQuery& query, QList<QVariantList>& batch, QList<int>& batchRows, QString& errorMessage, int& numErrors)
+{
+  if (batchRows.isEmpty())
+  {
+    return 0;
+  }
+
+  // A failed batch may have written some rows, so undo it with a savepoint and write the rows one at a time.
+  QSqlQuery savepoint(m_db);
+  const bool useSavepoint = savepoint.exec("SAVEPOINT csv_batch");
+  for (int iBound=0; iBound<batch.size(); ++iBound)
+  {
+    query.bindValue(iBound, batch.at(iBound));
+  }
+
+  int numWritten = 0;
+  if (query.execBatch())
+  {
+    numWritten = batchRows.size();
+  }
+  else if (useSavepoint)
+  {
+    QString batchError = query.lastError().text();
+    savepoint.exec("ROLLBACK TO csv_batch");
+    for (int i=0; i<batchRows.size(); ++i)
+    {
+      for (int iBound=0; iBound<batch.size(); ++iBound)
+      {
+        query.bindValue(iBound, batch.at(iBound).at(i));
+      }
+      if (query.exec())
+      {
+        ++numWritten;
+      }
+      else
+      {
+        if (numErrors > 0)
+        {
+          errorMessage += "\n";
+        }
+        errorMessage += QString("Row %1 : %2").arg(batchRows.at(i)).arg(query.lastError().text());
+        ++numErrors;
+      }
+    }
+    qDebug() << "CSV batch failed, wrote rows one at a time:" << batchError;
+  }
+  else
+  {
+    if (numErrors > 0)
+    {
+      errorMessage += "\n";
+    }
+    errorMessage += QString("Rows %1 to %2 : %3").arg(batchRows.first()).arg(batchRows.last()).arg(query.lastError().text());
+    ++numErrors;
+  }
+  if (useSavepoint)
+  {
+    savepoint.exec("RELEASE csv_batch");
+  }
+
+  for (int iBound=0; iBound<batch.size(); ++iBound)
+  {
+    batch[iBound].clear();
+  }
+  batchRows.clear();
+  return numWritten;
+}
+
 
@@ -3,20 +3,27 @@
 
 #include "describesqltables.h"
 #include "genericdatacollections.h"
+#include "tablesnapshotcache.h"
+#include "preparedquerycache.h"
 
 #include <QObject>
 #include <QString>
 #include <QtSql/QSqlDatabase>
 #include <QtSql/QSqlError>
 #include <QMap>
+#include <QHash>
+#include <QAtomicInt>
 #include <QList>
+#include <QMutex>
 
 class QSqlRecord;
 class QSqlField;
 class CSVReader;
 class QDir;
+class QProgressDialog;
 class DataObjectBase;
 class GenericDataCollection;
+class QTimer;
 
 //**************************************************************************
 /*! \class StampDB
@@ -50,6 +57,23 @@ public:
   /*! \brief Close the DB if it is open */
   void closeDB();
 
+  /*! \brief Use a named connection rather than the default connection; set this before the DB is opened.
+   *
+   *  A StampDB used on another thread must have its own connection.
+   *
+   *  \param [in] connectionName Name passed to QSqlDatabase::addDatabase.
+   */
+  void setConnectionName(const QString& connectionName) { m_connectionName = connectionName; }
+
+  /*! \brief Ask a long operation such as loadCSV or exportToCSV to stop; safe to call from any thread. */
+  void requestCancel() { m_cancelRequested.storeRelaxed(1); }
+
+  /*! \brief Clear a cancel request before starting a new operation. */
+  void clearCancel() { m_cancelRequested.storeRelaxed(0); }
+
+  /*! \return True if requestCancel was called since the last clearCancel. */
+  bool isCancelRequested() const { return m_cancelRequested.loadRelaxed() != 0; }
+
   /*! \brief Close the DB if it is open, then delete the file.
    *
    *  \return The True on success.
@@ -62,6 +86,76 @@ public:
    */
   bool createSchema();
 
+  /*! \brief Create an index for each link field in the schema, for each composite index, and on each "updated" field.
+   *
+   *  Indexes that already exist are left unchanged, as are tables or fields that are not in the DB.
+   *  The link field of a table that links to itself (catalog.id) is already the primary key.
+   *
+   *  \return The True on success.
+   */
+  bool createIndexes();
+
+  /*! \brief Bring an existing DB up to SchemaVersion, which is stored as "PRAGMA user_version".
+   *
+   *  This is not done by openDB because an upgrade can fill an index over every row of a large table.
+   *  Call it once after the DB is opened, from the worker thread (StampDBAsync::upgradeSchema).
+   *
+   *  Version 1 adds the indexes from createIndexes.
+   *  Version 2 adds the full text indexes from createFullTextIndexes if isFullTextSearchAvailable;
+   *  without FTS5 the DB is still marked version 2 so that no trigger needs a module that other builds may not have.
+   *  Version 3 adds the change counters from createChangeCounters.
+   *  Version 4 adds the index on "updated" from createIndexes.
+   *
+   *  \return The True on success.
+   */
+  bool upgradeSchema();
+
+  /*! \brief Create the tablechanges table and, for each table, triggers that count its inserts, updates, and deletes.
+   *
+   *  The change monitor reads these counters, so an edit that does not set "updated" is still seen.
+   *  Tables and triggers that already exist are left unchanged.
+   *
+   *  \return The True on success.
+   */
+  bool createChangeCounters();
+
+  /*! \brief True if this SQLite has FTS5 and the trigram tokenizer (3.34 or later), checked with a temporary table. */
+  bool isFullTextSearchAvailable();
+
+  /*! \brief Create a full text index for each table in m_fullTextIndexes, kept up to date by triggers.
+   *
+   *  Each index is an FTS5 external content table named tablename_fts, so the text is not stored twice.
+   *  The trigram tokenizer lets a search find any text of MinFullTextSearchLength or more characters,
+   *  ignoring case, which is what LIKE '%text%' finds. A new index is filled from its table; a table that already has an index is skipped.
+   *  Fails if SQLite does not have FTS5 and the trigram tokenizer (3.34 or later).
+   *
+   *  \return The True on success.
+   */
+  bool createFullTextIndexes();
+
+  /*! \brief True if a field has a full text index.
+   *
+   *  \param [in] tableName Table of interest.
+   *  \param [in] fieldName Field of interest; if empty, any field in the table.
+   *  \return True if the index exists in the DB.
+   */
+  bool hasFullTextIndex(const QString& tableName, const QString& fieldName = QString());
+
+  /*! \brief Find the rows that contain text using the full text index, best match first.
+   *
+   *  \param [in] tableName Table to search.
+   *  \param [in] text Text to find anywhere in the field, ignoring case.
+   *  \param [out] ids Key of each matching row.
+   *  \param [out] errorMessage Set if the query fails; errors are not displayed.
+   *  \param [in] fieldNames Fields to search, every indexed field if empty.
+   *  \param [in] limit Maximum number of ids, -1 for no limit.
+   *  \return True if the index was searched; false if there is no index, the text is too short, or the query fails.
+   */
+  bool searchText(const QString& tableName, const QString& text, QList<int>& ids, QString& errorMessage, const QStringList& fieldNames = QStringList(), const int limit = -1);
+
+  /*! Shortest text that the trigram tokenizer can find. */
+  static const int MinFullTextSearchLength = 3;
+
 
   /*! \brief Returns DDL for all tables in the DB.
    *
@@ -184,13 +278,134 @@ public:
    * Fields know if they link to another table. For example, bookvalues.catalogid references catalog.id.
    * When I ask for the bookvalues table, therefore, it will also return the catalog table.
    *
+   * The linked tables are read in parallel, each on its own connection to the database file,
+   * while the requested table is read on the main connection. Only the key and display fields
+   * of a linked table are read.
+   *
    *  \param [in] tableName
    *  \param [in] maxLinkDepth - Just in case. Set to -1 to just keep going.
    *  \param [in] sortByKey If true, reads the data ordered by "id" (database key), otherwise, do not purposely sort the data.
+   *  \param [in] firstPageSize If positive, only this many rows of the requested table are read; use a TablePageReader for the rest.
    *
    *  \return a new generic data collection that you now own and must delete (or, nullptr if it fails).
    */
-  GenericDataCollections* readTableWithLinks(const QString& tableName, const int maxLinkDepth=-1, const bool sortByKey=true);
+  GenericDataCollections* readTableWithLinks(const QString& tableName, const int maxLinkDepth=-1, const bool sortByKey=true, const int firstPageSize=-1);
+
+  /*! \brief Read the first page of a table ordered by its key, the rest is read with readTablePage.
+   *
+   *  \param [in] tableName
+   *  \param [in] pageSize Maximum number of rows to read.
+   *
+   *  \return a new generic data collection that you now own and must delete (or, nullptr if it fails).
+   */
+  GenericDataCollection* readTableFirstPage(const QString& tableName, const int pageSize);
+
+  /*! \brief Read the next page of rows using the key; "WHERE key > afterKey ORDER BY key LIMIT pageSize".
+   *
+   *  Values are in the same order as the fields in the schema, which is the property order
+   *  of a collection returned by readTableFirstPage.
+   *
+   *  \param [in] tableName
+   *  \param [in] afterKey Only rows with a key larger than this are read.
+   *  \param [in] pageSize Maximum number of rows to read.
+   *  \param [out] keys Key for each row read.
+   *  \param [out] rows Values for each row read; an invalid value is NULL.
+   *
+   *  \return True on success, false on failure.
+   */
+  bool readTablePage(const QString& tableName, const int afterKey, const int pageSize, QList<int>& keys, QList<QList<QVariant> >& rows);
+
+  /*! \brief Find what changed in the database since a table was read, without reading the whole table.
+   *
+   *  Rows whose "updated" value is at or after the largest "updated" value in the collection,
+   *  and rows with a key larger than the largest key in the collection, are read.
+   *  Deleted rows are found by comparing the keys; the key list is only read if the
+   *  number of rows in the database does not match.
+   *
+   *  Values are in the property order of the collection, so a projected collection reads
+   *  only its own fields. Rows modified without moving "updated" forward are not found:
+   *  the table model and an upsert with loadCSV set it, but other SQL, such as an UPDATE
+   *  typed into the SQL dialog or a CSV file whose "updated" column holds older values, may not.
+   *  Use reloadTable after such a change.
+   *
+   *  \param [in] tableName
+   *  \param [in] collection Collection previously read from the table; it must contain "updated" and the key field.
+   *  \param [out] keys Key for each changed or new row.
+   *  \param [out] rows Values for each changed or new row; an invalid value is NULL.
+   *  \param [out] deletedIds Keys in the collection that are no longer in the database.
+   *
+   *  \return True on success, false if the table cannot be refreshed this way or the query fails.
+   */
+  bool readTableChanges(const QString& tableName, const GenericDataCollection& collection, QList<int>& keys, QList<QList<QVariant> >& rows, QList<int>& deletedIds);
+
+  /*! \brief Merge the changes found by readTableChanges into a collection; existing rows keep their position and new rows are appended.
+   *
+   *  Do not use this if the collection has changes that are not yet saved; those changes are lost.
+   *  A table model should use GenericDataCollectionsTableModel::mergeRows so that views are notified.
+   *
+   *  \param [in] tableName
+   *  \param [in, out] collection Collection previously read from the table.
+   *
+   *  \return True on success, false if the table must be read again.
+   */
+  bool refreshTable(const QString& tableName, GenericDataCollection& collection);
+
+  /*! \brief Bring a linked table up to date; uses refreshTable if possible, otherwise the table is read again.
+   *
+   *  A table read again replaces the collection without notifying anything, so only use this
+   *  for a collection that is not the source of a table model.
+   *
+   *  \param [in] tableName
+   *  \param [in, out] collection Collection previously read from the table; the same fields are read.
+   *
+   *  \return True on success.
+   */
+  bool reloadTable(const QString& tableName, GenericDataCollection& collection);
+
+  /*! \brief Check for changes made by other connections every intervalMs milliseconds; changes emit tablesChanged.
+   *
+   *  The check reads "PRAGMA data_version", which only changes when another connection (another
+   *  thread, such as StampDBAsync, or another program) commits a change. That does not say which
+   *  tables changed, so once a check finds no further change, or after MaxChangeMonitorDelay checks,
+   *  the row count, largest rowid, and latest "updated" value of each table are compared with
+   *  the last check; only tables that differ are reported. An edit to a table without "updated"
+   *  is not seen; StampDBAsync reports the tables that it changes, so use notifyTablesChanged
+   *  for those. Changes made on this connection are reported with notifyTablesChanged.
+   *
+   *  The source sent with tablesChanged is getChangeMonitor, so that a receiver can limit itself
+   *  to cheap updates, such as refreshTable, rather than reading a whole table after every check.
+   *
+   *  \param [in] intervalMs Time between checks.
+   */
+  void startChangeMonitor(const int intervalMs = DefaultChangeMonitorInterval);
+
+  /*! \brief Stop checking for changes made by other connections. */
+  void stopChangeMonitor();
+
+  /*! Milliseconds between checks of "PRAGMA data_version". */
+  static const int DefaultChangeMonitorInterval = 1000;
+
+  /*! Most checks that a change is held back while other connections keep changing the DB. */
+  static const int MaxChangeMonitorDelay = 5;
+
+  /*! \return Source sent with tablesChanged for changes found by the change monitor, nullptr if it was never started. */
+  QObject* getChangeMonitor() const { return m_changeMonitorTimer; }
+
+  /*! \brief Emit tablesChanged after a change made on this connection, or by a StampDBAsync worker.
+   *
+   *  The change monitor does not report these tables again.
+   *
+   *  \param [in] tableNames Tables that were changed.
+   *  \param [in] source Object that made the change so that it can ignore its own change, may be nullptr.
+   */
+  void notifyTablesChanged(const QStringList& tableNames, QObject* source = nullptr);
+
+  /*! \brief Tables changed by SQL that is not a SELECT, based on INSERT, UPDATE, DELETE, REPLACE, ALTER, and DROP.
+   *
+   *  \param [in] sql SQL that was run.
+   *  \return Tables changed by the SQL; every table if they cannot be found.
+   */
+  QStringList getTablesChangedBy(const QString& sql);
 
   /*! \brief Return the maximum value from the field "id" in the specified tablename.
    *
@@ -230,6 +445,20 @@ public:
 
   int selectValueSourceId(QWidget* parent);
 
+  /*! \brief Number of catalog entries that have no book values. */
+  int countCatalogWithoutBookValues();
+
+  /*! \brief Add a book value of zero for each value type to every catalog entry that has no book values.
+   *
+   *  A single "INSERT ... SELECT" in a transaction, so the time does not depend on the number of rows.
+   *
+   *  \param [in] sourceId Value source for the new rows.
+   *  \param [in] valueTypeIds Value types to add for each catalog entry, such as mint and used.
+   *  \param [out] errorMessage Set if there is an error.
+   *  \return Number of rows added, or -1 on failure.
+   */
+  int addMissingBookValues(const int sourceId, const QList<int>& valueTypeIds, QString& errorMessage);
+
   //GenericDataCollection* readTableName(const QString& tableName, const bool useSchema, const bool includeLinks);
 
   /*! \brief Execute SQL and create a table.
@@ -240,20 +469,73 @@ public:
    */
   GenericDataCollection* readTableSql(const QString& sql);
 
+  /*! \brief Number of CSV rows bound and written with a single execBatch. */
+  static const int DefaultCSVBatchSize = 500;
+
+  /*! \brief Number of CSV rows written between commits. */
+  static const int DefaultCSVRowsPerCommit = 50000;
+
   /*! \brief Read an already opened CSV file into an existing table.
+   *
+   *  Without an upsert, a row whose id already exists is skipped. With an upsert,
+   *  "INSERT ... ON CONFLICT(id) DO UPDATE" replaces the values of an existing row,
+   *  and sets "updated" to the current time if the CSV file does not have that column.
    *
    *  \param [in,out] reader
    *
    *  \param [in] tableName Name of the table that will receive the CSV data.
+   *  \param [in] upsert If true, update rows whose id already exists.
+   *  \param [in] batchSize Number of rows written with each execBatch.
+   *  \param [in] rowsPerCommit Number of rows written between commits.
    *
    *  \return True on success, false on failure.
    */
-  bool loadCSV(CSVReader& reader, const QString& tableName);
+  bool loadCSV(CSVReader& reader, const QString& tableName, const bool upsert=false, const int batchSize=DefaultCSVBatchSize, const int rowsPerCommit=DefaultCSVRowsPerCommit);
+
+  /*! \brief Write the DDL and one CSV file for each table into a directory.
+   *
+   *  Rows are written directly from the SQL cursor. Tables are written at the same time on
+   *  worker threads, each with its own connection, while this thread updates the progress dialog.
+   *
+   *  \param [in] outputDir Directory that receives stamps.ddl and a CSV file named for each table.
+   *  \param [in] overwrite If true, replace existing files; otherwise a table whose file exists is skipped.
+   *  \param [in, out] progress Shows the number of tables and rows written and allows the export to be canceled, may be nullptr.
+   *  \return True if every table was written.
+   */
+  bool exportToCSV(const QDir& outputDir, const bool overwrite=false, QProgressDialog* progress=nullptr);
 
-  bool exportToCSV(const QDir& outputDir, const bool overwrite=false);
+  /*! \brief SELECT that joins inventory to catalog, country, dealer, location, value type, catalog type, and book values, one row per inventory item and book value. */
+  static const QString FullInventorySql;
 
   QSqlDatabase& getDB() { return m_db; }
 
+  /*! \brief Prepared queries for each connection; use these when running the same SQL many times such as when saving changes. */
+  PreparedQueryCache& getQueryCache() { return m_queryCache; }
+
+  /*! \return True if whole table reads may be served from, and saved to, the snapshot cache. */
+  bool isSnapshotCacheEnabled() const { return m_snapshotCache.isEnabled(); }
+
+  /*! \brief Turn the snapshot cache on or off; when off, every read is from the DB. The cache is off by default. */
+  void setSnapshotCacheEnabled(const bool enabled) { m_snapshotCache.setEnabled(enabled); }
+
+  /*! \return True if a table read from the DB is written to the snapshot cache. */
+  bool isSnapshotWriter() const { return m_snapshotWriter; }
+
+  /*! \brief Set to true on the worker thread's StampDB so that only it writes snapshots.
+   *
+   *  When false, a table whose snapshot is stale is read from the DB and snapshotStale is emitted
+   *  so that the writer can rebuild the snapshot with rebuildSnapshot.
+   */
+  void setSnapshotWriter(const bool writer) { m_snapshotWriter = writer; }
+
+  /*! \brief Read a table from the DB and write its snapshot, unless the snapshot is already current.
+   *  \param [in] tableName Table to read.
+   *  \param [in] fieldNames Fields to read, empty for all fields.
+   *  \param [in] orderByList Fields used to order the rows.
+   *  \return True if the snapshot is current or the table was read.
+   */
+  bool rebuildSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList);
+
   //**************************************************************************
   /*! \brief Execute an SQL Query
    *
@@ -287,10 +569,111 @@ public:
   DescribeSqlTables m_schema;
 
 signals:
+  /*! \brief Progress of a long operation.
+   *  \param [in] done Amount of work done such as tables or rows.
+   *  \param [in] total Total amount of work, or -1 if it is not known.
+   *  \param [in] text Describes the progress.
+   */
+  void progress(int done, int total, const QString& text);
+
+  /*! \brief An error or information message when the object is not on the GUI thread, so it cannot show the message itself. */
+  void message(const QString& title, const QString& text);
+
+  /*! \brief Tables were changed in the database, so cached copies may be out of date.
+   *  \param [in] tableNames Tables that changed.
+   *  \param [in] source Object that made the change, or nullptr if it is not known.
+   */
+  void tablesChanged(const QStringList& tableNames, QObject* source);
+
+  /*! \brief A table was read from the DB because its snapshot is stale; pass the arguments to rebuildSnapshot on the snapshot writer.
+   *  \param [in] tableName Table that was read.
+   *  \param [in] fieldNames Fields that were read, empty for all fields.
+   *  \param [in] orderByList Fields used to order the rows.
+   */
+  void snapshotStale(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList);
 
 public slots:
 
+private slots:
+  /*! \brief Read "PRAGMA data_version" and, once other connections stop committing, emit tablesChanged for the tables they changed. */
+  void checkDataVersion();
+
 private:
+  /*! \brief Show a message; from a thread other than the GUI thread, the message signal is emitted instead. */
+  void reportMessage(const QString& title, const QString& text);
+
+  /*! \brief Key field names for a table, or "id" if there are no key fields. Used to order the rows. */
+  QStringList getKeyFieldNames(const QString& tableName) const;
+
+  /*! \brief Read the change counter of each table from the tablechanges table, and remember them for the next call.
+   *  \return Tables whose counter differs from the last call; a table not seen by the last call is not included.
+   */
+  QStringList findChangedTables();
+
+  /*! \brief Read all data from a table using a specific connection; safe to call from a worker thread.
+   *
+   *  \param [in] db Open connection to use, which must belong to the calling thread.
+   *  \param [in] tableName
+   *  \param [in] orderByList Field name list by which the data is ordered.
+   *  \param [out] errorMessage Set if there is an error; errors are not displayed.
+   *  \param [in] projectedFields Fields to read in schema order, or empty to read every field.
+   *
+   *  \return a new generic data collection that you now own and must delete (or, nullptr if it fails).
+   */
+  GenericDataCollection* readTableBySchema(QSqlDatabase& db, const QString& tableName, const QStringList& orderByList, QString& errorMessage, const QStringList& projectedFields = QStringList()) const;
+
+  /*! \brief Emit snapshotStale for each stale snapshot found by readTableBySchema since the last call. */
+  void reportStaleSnapshots();
+
+  /*! \brief Find the tables needed to edit a table and the fields needed from each linked table.
+   *
+   *  A linked table only needs the field that is linked to and the display fields; a display field
+   *  that is itself a link pulls in the next table the same way.
+   *
+   *  \param [in] tableName Table that is edited; every field is read.
+   *  \param [in] maxLinkDepth Maximum number of links to follow, -1 for no limit.
+   *  \param [out] tableNames Tables to read, starting with tableName.
+   *  \param [out] projectedFields Fields to read for each table (by lower case name) in schema order; empty means every field.
+   */
+  void getLinkProjection(const QString& tableName, const int maxLinkDepth, QStringList& tableNames, QHash<QString, QStringList>& projectedFields) const;
+
+  /*! \brief Write a table to a CSV file a row at a time from the SQL cursor; safe to call from a worker thread.
+   *
+   *  \param [in] db Open connection to use, which must belong to the calling thread.
+   *  \param [in] tableName Table to export.
+   *  \param [in] orderBy Comma separated fields used to order the rows, may be empty.
+   *  \param [in] fileName File to write; it is removed if the export is canceled.
+   *  \param [out] errorMessage Set if there is an error; errors are not displayed.
+   *  \param [in, out] rowsWritten Incremented as rows are written.
+   *  \param [in] canceled Non-zero to stop writing.
+   *  \return True if every row was written.
+   */
+  static bool exportTableToCSV(QSqlDatabase& db, const QString& tableName, const QString& orderBy, const QString& fileName, QString& errorMessage, QAtomicInt& rowsWritten, const QAtomicInt& canceled);
+
+  /*! Number of rows written between updates to the shared row count and checks for cancel. */
+  static const int ExportProgressRows = 1000;
+
+  /*! \brief Write a batch of CSV rows with execBatch and then clear the batch.
+   *
+   *  If the batch fails, it is rolled back to a savepoint and the rows are written one at a time so that each failure is reported.
+   *
+   *  \param [in, out] query Prepared INSERT with one positional placeholder per bound column.
+   *  \param [in, out] batch Values for each placeholder, one list per placeholder.
+   *  \param [in, out] batchRows CSV row number of each row in the batch, used for error messages.
+   *  \param [in, out] errorMessage Errors are appended.
+   *  \param [in, out] numErrors Incremented for each error.
+   *  \return Number of rows written.
+   */
+  int execCSVBatch(QSqlQuery& query, QList<QVariantList>& batch, QList<int>& batchRows, QString& errorMessage, int& numErrors);
+
+  /*! \brief Set "PRAGMA user_version" to SchemaVersion. */
+  bool setSchemaVersion();
+
+  /*! Version stored in "PRAGMA user_version" once the DB has every index and upgrade. */
+  static const int SchemaVersion = 4;
+
+  /*! SQL condition that skips tables derived from the other tables: the full text indexes and tablechanges. */
+  static const QString NotDerivedTableCondition;
 
   /*! True if DB driver has been obtained.  */
   bool m_dbIsInitialized;
@@ -304,11 +687,56 @@ private:
   /*! Each string is the DDL to create a single table. */
   QStringList *m_desiredSchemaDDLList;
 
+  /*! Each list is a table name followed by the fields of an index that spans more than one field. */
+  QList<QStringList> m_compositeIndexes;
+
+  /*! Text fields in each table (by lower case name) that have a full text index. */
+  QMap<QString, QStringList> m_fullTextIndexes;
+
   /*!   */
   QString m_pathToDB;
 
   /*!   */
   QSqlDatabase m_db;
+
+  /*! Name of the connection, empty for the default connection. */
+  QString m_connectionName;
+
+  /*! Non-zero if the current long operation should stop. */
+  QAtomicInt m_cancelRequested;
+
+  /*! Binary copies of tables read by schema so that they can be opened without SQL. */
+  TableSnapshotCache m_snapshotCache;
+
+  /*! True if tables read from the DB are written to m_snapshotCache. */
+  bool m_snapshotWriter;
+
+  /*! A table, fields, and order whose snapshot was stale when read by a reader that does not write snapshots. */
+  struct StaleSnapshot
+  {
+    QString tableName;
+    QStringList fieldNames;
+    QStringList orderByList;
+  };
+
+  /*! Stale snapshots found by readTableBySchema, which may run on pool threads, so use m_staleSnapshotsMutex. */
+  mutable QList<StaleSnapshot> m_staleSnapshots;
+  mutable QMutex m_staleSnapshotsMutex;
+
+  /*! Prepared queries for each connection so that the same SQL is not parsed and planned again. */
+  mutable PreparedQueryCache m_queryCache;
+
+  /*! Runs checkDataVersion while the change monitor is started. */
+  QTimer* m_changeMonitorTimer;
+
+  /*! Last value read from "PRAGMA data_version", -1 if it has not been read on this connection. */
+  qint64 m_dataVersion;
+
+  /*! Number of checks since a change was seen that is not yet reported, 0 if none. */
+  int m_numChangeChecks;
+
+  /*! Counters read by findChangedTables, keyed by lower case table name. */
+  QHash<QString, qint64> m_tableCounters;
 };
 
 #endif // STAMPDB_H
@@ -0,0 +1,113 @@
+#include "stampdbasync.h"
+#include "stampdbworker.h"
+#include "csvreader.h"
+#include "genericdatacollections.h"
+
+#include <QMetaObject>
+#include <QThread>
+
+StampDBAsync::StampDBAsync(const QString& pathToDB, QObject *parent) :
+  QObject(parent), m_pathToDB(pathToDB), m_thread(nullptr), m_worker(nullptr), m_lastRequestId(0)
+{
+  // Required to send these between threads.
+  qRegisterMetaType<GenericDataCollections*>("GenericDataCollections*");
+  qRegisterMetaType<QList<QSqlRecord> >("QList<QSqlRecord>");
+
+  m_thread = new QThread(this);
+  m_thread->setObjectName("StampDBAsync");
+  m_worker = new StampDBWorker(pathToDB, thread());
+  m_worker->moveToThread(m_thread);
+
+  connect(m_worker, SIGNAL(finished(int,bool)), this, SIGNAL(finished(int,bool)));
+  connect(m_worker, SIGNAL(tablesRead(int,GenericDataCollections*)), this, SIGNAL(tablesRead(int,GenericDataCollections*)));
+  connect(m_worker, SIGNAL(queryRecords(int,QList<QSqlRecord>)), this, SIGNAL(queryRecords(int,QList<QSqlRecord>)));
+  connect(m_worker, SIGNAL(progress(int,int,int,QString)), this, SIGNAL(progress(int,int,int,QString)));
+  connect(m_worker, SIGNAL(message(QString,QString)), this, SIGNAL(message(QString,QString)));
+  connect(m_worker, SIGNAL(tablesChanged(QStringList)), this, SIGNAL(tablesChanged(QStringList)));
+  m_thread->start();
+}
+
+StampDBAsync::~StampDBAsync()
+{
+  m_worker->requestStop();
+  StampDBWorker* worker = m_worker;
+  // Queued after every request, which now return right away.
+  QMetaObject::invokeMethod(m_worker, [worker]() { worker->shutdown(); }, Qt::BlockingQueuedConnection);
+  m_thread->quit();
+  m_thread->wait();
+  delete m_worker;
+  m_worker = nullptr;
+}
+
+int StampDBAsync::openDB()
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId]() { worker->openDB(requestId); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+int StampDBAsync::upgradeSchema()
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId]() { worker->upgradeSchema(requestId); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+int StampDBAsync::readTableWithLinks(const QString& tableName, const int maxLinkDepth, const bool sortByKey)
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId, tableName, maxLinkDepth, sortByKey]() { worker->readTableWithLinks(requestId, tableName, maxLinkDepth, sortByKey); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+void StampDBAsync::setSnapshotCacheEnabled(const bool enabled)
+{
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, enabled]() { worker->setSnapshotCacheEnabled(enabled); }, Qt::QueuedConnection);
+}
+
+int StampDBAsync::rebuildSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList)
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId, tableName, fieldNames, orderByList]() { worker->rebuildSnapshot(requestId, tableName, fieldNames, orderByList); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+int StampDBAsync::loadCSV(CSVReader* reader, const QString& tableName, const bool upsert)
+{
+  int requestId = ++m_lastRequestId;
+  if (reader != nullptr)
+  {
+    // The reader is only used on the worker thread from now on.
+    reader->setParent(nullptr);
+    reader->moveToThread(m_thread);
+  }
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId, reader, tableName, upsert]() { worker->loadCSV(requestId, reader, tableName, upsert); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+int StampDBAsync::exportToCSV(const QString& outputDir, const bool overwrite)
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId, outputDir, overwrite]() { worker->exportToCSV(requestId, outputDir, overwrite); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+int StampDBAsync::executeQuery(const QString& sql)
+{
+  int requestId = ++m_lastRequestId;
+  StampDBWorker* worker = m_worker;
+  QMetaObject::invokeMethod(m_worker, [worker, requestId, sql]() { worker->executeQuery(requestId, sql); }, Qt::QueuedConnection);
+  return requestId;
+}
+
+void StampDBAsync::cancel(const int requestId)
+{
+  m_worker->requestCancel(requestId);
+}
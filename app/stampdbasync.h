@@ -0,0 +1,124 @@
+#ifndef STAMPDBASYNC_H
+#define STAMPDBASYNC_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QSqlRecord>
+
+class StampDBWorker;
+class CSVReader;
+class GenericDataCollections;
+class QThread;
+
+//**************************************************************************
+/*! \class StampDBAsync
+ * \brief Runs the long StampDB operations on a dedicated worker thread so that the GUI does not freeze.
+ *
+ * The worker thread has its own StampDB and its own connection to the database file.
+ * Each method queues a request and returns its id right away; requests run one at a
+ * time in the order they are made. Every request sends finished() exactly once,
+ * and may send progress() and message() while it runs.
+ *
+ * \code
+ * StampDBAsync* asyncDb = new StampDBAsync(path, this);
+ * connect(asyncDb, SIGNAL(finished(int,bool)), this, SLOT(asyncFinished(int,bool)));
+ * int requestId = asyncDb->exportToCSV(directory);
+ * \endcode
+ *
+ * StampDB is still available for synchronous use, such as scripts.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class StampDBAsync : public QObject
+{
+  Q_OBJECT
+public:
+  /*! \brief Constructor starts the worker thread.
+   *
+   *  \param [in] pathToDB Full path to the database file.
+   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
+   */
+  explicit StampDBAsync(const QString& pathToDB, QObject *parent = nullptr);
+
+  /*! \brief Destructor cancels the running request, drops requests that have not started, and waits for the thread to end. */
+  ~StampDBAsync();
+
+  /*! \return Full path to the database file. */
+  const QString& pathToDB() const { return m_pathToDB; }
+
+  /*! \brief Open the database.
+   *  \return Request id.
+   */
+  int openDB();
+
+  /*! \brief Bring the database up to the current schema version; see StampDB::upgradeSchema.
+   *  \return Request id.
+   */
+  int upgradeSchema();
+
+  /*! \brief Read a table and the tables it links to; the tables are sent with tablesRead.
+   *  \return Request id.
+   */
+  int readTableWithLinks(const QString& tableName, const int maxLinkDepth = -1, const bool sortByKey = true);
+
+  /*! \brief Turn the snapshot cache on or off for the worker, which is the only one that writes snapshots. */
+  void setSnapshotCacheEnabled(const bool enabled);
+
+  /*! \brief Rebuild a stale snapshot in the background; connect StampDB::snapshotStale to a slot that calls this.
+   *  \return Request id.
+   */
+  int rebuildSnapshot(const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList);
+
+  /*! \brief Import an already opened CSV file into a table.
+   *
+   *  \param [in] reader Reader that is already configured; the worker now owns it, so do not use it after this call.
+   *  \param [in] tableName Name of the table that will receive the CSV data.
+   *  \param [in] upsert If true, update rows whose id already exists.
+   *  \return Request id.
+   */
+  int loadCSV(CSVReader* reader, const QString& tableName, const bool upsert = false);
+
+  /*! \brief Write the DDL and one CSV file per table into a directory.
+   *  \return Request id.
+   */
+  int exportToCSV(const QString& outputDir, const bool overwrite = false);
+
+  /*! \brief Run SQL; the records are sent with queryRecords.
+   *  \return Request id.
+   */
+  int executeQuery(const QString& sql);
+
+  /*! \brief Cancel a request that is running or has not started; it still sends finished. */
+  void cancel(const int requestId);
+
+signals:
+  /*! \brief A request is done. */
+  void finished(int requestId, bool ok);
+
+  /*! \brief Tables read by readTableWithLinks, which the receiver now owns. */
+  void tablesRead(int requestId, GenericDataCollections* tables);
+
+  /*! \brief Records returned by executeQuery. */
+  void queryRecords(int requestId, const QList<QSqlRecord>& records);
+
+  /*! \brief Progress of a request; total is -1 if it is not known. */
+  void progress(int requestId, int done, int total, const QString& text);
+
+  /*! \brief An error or information message that should be shown to the user. */
+  void message(const QString& title, const QString& text);
+
+  /*! \brief Tables changed by a request; pass them to StampDB::notifyTablesChanged so that open windows are brought up to date. */
+  void tablesChanged(const QStringList& tableNames);
+
+private:
+  QString m_pathToDB;
+  QThread* m_thread;
+  StampDBWorker* m_worker;
+  int m_lastRequestId;
+};
+
+#endif // STAMPDBASYNC_H
@@ -0,0 +1,167 @@
+#include "stampdbworker.h"
+#include "stampdb.h"
+#include "csvreader.h"
+#include "genericdatacollections.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QHash>
+#include <QScopedPointer>
+#include <QThread>
+#include <QUuid>
+
+StampDBWorker::StampDBWorker(const QString& pathToDB, QThread* resultThread, QObject *parent) :
+  QObject(parent), m_db(nullptr), m_resultThread(resultThread), m_currentRequestId(-1), m_cancelRequestId(-1), m_stopping(0)
+{
+  // A child so that it moves to the worker thread with this object.
+  m_db = new StampDB(this);
+  m_db->setConnectionName(QString("StampDBWorker_%1").arg(QUuid::createUuid().toString()));
+  m_db->pathToDB(pathToDB);
+  // Snapshots are only written here so that a stale snapshot never slows the GUI thread.
+  m_db->setSnapshotWriter(true);
+  connect(m_db, SIGNAL(progress(int,int,QString)), this, SLOT(forwardProgress(int,int,QString)));
+  connect(m_db, SIGNAL(message(QString,QString)), this, SIGNAL(message(QString,QString)));
+  connect(m_db, SIGNAL(tablesChanged(QStringList,QObject*)), this, SIGNAL(tablesChanged(QStringList)));
+}
+
+void StampDBWorker::requestCancel(const int requestId)
+{
+  m_cancelRequestId.storeRelaxed(requestId);
+  if (m_currentRequestId.loadRelaxed() == requestId && m_db != nullptr)
+  {
+    m_db->requestCancel();
+  }
+}
+
+void StampDBWorker::requestStop()
+{
+  m_stopping.storeRelaxed(1);
+  if (m_db != nullptr)
+  {
+    m_db->requestCancel();
+  }
+}
+
+bool StampDBWorker::beginRequest(const int requestId)
+{
+  m_currentRequestId.storeRelaxed(requestId);
+  if (m_db == nullptr)
+  {
+    return false;
+  }
+  m_db->clearCancel();
+  if (m_stopping.loadRelaxed() != 0 || m_cancelRequestId.loadRelaxed() == requestId)
+  {
+    m_db->requestCancel();
+    return false;
+  }
+  return true;
+}
+
+void StampDBWorker::forwardProgress(int done, int total, const QString& text)
+{
+  emit progress(m_currentRequestId.loadRelaxed(), done, total, text);
+}
+
+void StampDBWorker::openDB(const int requestId)
+{
+  bool ok = beginRequest(requestId) && m_db->openDB();
+  if (!ok && m_db != nullptr && !m_db->isCancelRequested())
+  {
+    emit message("ERROR", QString(tr("Failed to open the database %1: %2")).arg(m_db->pathToDB(), m_db->lastError().text()));
+  }
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::upgradeSchema(const int requestId)
+{
+  bool ok = beginRequest(requestId) && m_db->upgradeSchema();
+  if (!ok && m_db != nullptr && !m_db->isCancelRequested())
+  {
+    qDebug() << "Failed to upgrade the schema for" << m_db->pathToDB();
+  }
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::readTableWithLinks(const int requestId, const QString& tableName, const int maxLinkDepth, const bool sortByKey)
+{
+  if (!beginRequest(requestId) || !m_db->openDB())
+  {
+    emit finished(requestId, false);
+    return;
+  }
+  emit progress(requestId, 0, -1, QString(tr("Reading %1")).arg(tableName));
+  GenericDataCollections* tables = m_db->readTableWithLinks(tableName, maxLinkDepth, sortByKey);
+  if (tables == nullptr)
+  {
+    emit finished(requestId, false);
+    return;
+  }
+  if (m_db->isCancelRequested())
+  {
+    delete tables;
+    emit finished(requestId, false);
+    return;
+  }
+  // The tables, and the collections they own, must belong to the thread that uses them.
+  tables->moveToThread(m_resultThread);
+  emit tablesRead(requestId, tables);
+  emit finished(requestId, true);
+}
+
+void StampDBWorker::setSnapshotCacheEnabled(const bool enabled)
+{
+  if (m_db != nullptr)
+  {
+    m_db->setSnapshotCacheEnabled(enabled);
+  }
+}
+
+void StampDBWorker::rebuildSnapshot(const int requestId, const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList)
+{
+  bool ok = beginRequest(requestId) && m_db->rebuildSnapshot(tableName, fieldNames, orderByList);
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::loadCSV(const int requestId, CSVReader* reader, const QString& tableName, const bool upsert)
+{
+  QScopedPointer<CSVReader> owner(reader);
+  bool ok = reader != nullptr && beginRequest(requestId) && m_db->loadCSV(*reader, tableName, upsert);
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::exportToCSV(const int requestId, const QString& outputDir, const bool overwrite)
+{
+  bool ok = beginRequest(requestId) && m_db->exportToCSV(QDir(outputDir), overwrite);
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::executeQuery(const int requestId, const QString& sql)
+{
+  if (!beginRequest(requestId))
+  {
+    emit finished(requestId, false);
+    return;
+  }
+  QList<QSqlRecord> records;
+  QString keyField;
+  QHash<int, int> keys;
+  bool ok = m_db->executeQuery(sql, records, keyField, keys);
+  if (ok)
+  {
+    emit queryRecords(requestId, records);
+  }
+  emit finished(requestId, ok);
+}
+
+void StampDBWorker::shutdown()
+{
+  m_currentRequestId.storeRelaxed(-1);
+  if (m_db != nullptr)
+  {
+    // The destructor removes the connection, which must happen on the thread that used it.
+    StampDB* db = m_db;
+    m_db = nullptr;
+    delete db;
+  }
+}
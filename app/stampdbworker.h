@@ -0,0 +1,116 @@
+#ifndef STAMPDBWORKER_H
+#define STAMPDBWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QAtomicInt>
+#include <QSqlRecord>
+
+class StampDB;
+class CSVReader;
+class GenericDataCollections;
+class QThread;
+
+//**************************************************************************
+/*! \class StampDBWorker
+ * \brief Runs StampDB operations on a worker thread with its own StampDB and connection.
+ *
+ * Use StampDBAsync rather than this class directly. Every operation runs on the
+ * thread that owns this object and reports with signals that carry the request id.
+ * Results that are QObjects are moved to the result thread before they are sent.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class StampDBWorker : public QObject
+{
+  Q_OBJECT
+public:
+  /*! \brief Constructor
+   *
+   *  \param [in] pathToDB Full path to the database file.
+   *  \param [in] resultThread Thread that receives the results, usually the GUI thread.
+   *  \param [in, out] parent The object's owner. The parent's destructor destroys this object.
+   */
+  explicit StampDBWorker(const QString& pathToDB, QThread* resultThread, QObject *parent = nullptr);
+
+  /*! \brief Ask a request to stop; a request that has not started yet will not run. Safe to call from any thread. */
+  void requestCancel(const int requestId);
+
+  /*! \brief Stop the current request and every request that has not started. Safe to call from any thread. */
+  void requestStop();
+
+  /*! \brief Open the database. */
+  void openDB(const int requestId);
+
+  /*! \brief Bring the database up to the current schema version, which may fill large indexes. */
+  void upgradeSchema(const int requestId);
+
+  /*! \brief Read a table and the tables it links to; sends tablesRead on success. */
+  void readTableWithLinks(const int requestId, const QString& tableName, const int maxLinkDepth, const bool sortByKey);
+
+  /*! \brief Turn the snapshot cache on or off for the worker's StampDB, which writes the snapshots. */
+  void setSnapshotCacheEnabled(const bool enabled);
+
+  /*! \brief Read a table from the DB and write its snapshot; see StampDB::rebuildSnapshot. */
+  void rebuildSnapshot(const int requestId, const QString& tableName, const QStringList& fieldNames, const QStringList& orderByList);
+
+  /*! \brief Import a CSV file; this object now owns the reader and deletes it when done. */
+  void loadCSV(const int requestId, CSVReader* reader, const QString& tableName, const bool upsert);
+
+  /*! \brief Write the DDL and one CSV file per table into a directory. */
+  void exportToCSV(const int requestId, const QString& outputDir, const bool overwrite);
+
+  /*! \brief Run SQL and send the records with queryRecords on success. */
+  void executeQuery(const int requestId, const QString& sql);
+
+  /*! \brief Close the database and delete the StampDB on this thread so that the connection is removed here. */
+  void shutdown();
+
+signals:
+  /*! \brief A request is done; every request sends this exactly once. */
+  void finished(int requestId, bool ok);
+
+  /*! \brief Tables read by readTableWithLinks, which the receiver now owns. */
+  void tablesRead(int requestId, GenericDataCollections* tables);
+
+  /*! \brief Records returned by executeQuery. */
+  void queryRecords(int requestId, const QList<QSqlRecord>& records);
+
+  /*! \brief Progress of a request; total is -1 if it is not known. */
+  void progress(int requestId, int done, int total, const QString& text);
+
+  /*! \brief An error or information message that should be shown to the user. */
+  void message(const QString& title, const QString& text);
+
+  /*! \brief Tables changed by a request, such as loadCSV. */
+  void tablesChanged(const QStringList& tableNames);
+
+private slots:
+  void forwardProgress(int done, int total, const QString& text);
+
+private:
+  /*! \brief Start a request.
+   *  \return False if the request was canceled before it started.
+   */
+  bool beginRequest(const int requestId);
+
+  /*! Created in the constructor, but only used on the worker thread. */
+  StampDB* m_db;
+
+  QThread* m_resultThread;
+
+  /*! Request that is running, -1 if none. */
+  QAtomicInt m_currentRequestId;
+
+  /*! Last request that was canceled. */
+  QAtomicInt m_cancelRequestId;
+
+  /*! Non-zero when every request should stop. */
+  QAtomicInt m_stopping;
+};
+
+#endif // STAMPDBWORKER_H
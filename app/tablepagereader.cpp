@@ -0,0 +1,29 @@
+#include "tablepagereader.h"
+#include "stampdb.h"
+
+TablePageReader::TablePageReader(StampDB& db, const QString& tableName, const int lastKey, const int pageSize) :
+  m_db(db), m_tableName(tableName), m_lastKey(lastKey), m_pageSize(pageSize), m_atEnd(false)
+{
+}
+
+int TablePageReader::readNextPage(QList<int>& keys, QList<QList<QVariant> >& rows)
+{
+  keys.clear();
+  rows.clear();
+  if (m_atEnd)
+  {
+    return 0;
+  }
+  if (!m_db.readTablePage(m_tableName, m_lastKey, m_pageSize, keys, rows))
+  {
+    m_atEnd = true;
+    return 0;
+  }
+  if (!keys.isEmpty())
+  {
+    m_lastKey = keys.last();
+  }
+  // A short page means that there is nothing left.
+  m_atEnd = (keys.size() < m_pageSize);
+  return keys.size();
+}
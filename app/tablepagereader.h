@@ -0,0 +1,56 @@
+#ifndef TABLEPAGEREADER_H
+#define TABLEPAGEREADER_H
+
+#include <QList>
+#include <QString>
+#include <QVariant>
+
+class StampDB;
+
+//**************************************************************************
+/*! \class TablePageReader
+ * \brief Reads the rest of a table one page at a time after the first page was read with StampDB::readTableFirstPage.
+ *
+ * Pages are read in key order using the last key read, so each page is an
+ * indexed range scan rather than an OFFSET that gets slower deeper into the table.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class TablePageReader
+{
+public:
+  /*! \brief Number of rows read per page unless told otherwise. */
+  static const int DefaultPageSize = 2000;
+
+  /*! \brief Constructor
+   *  \param [in] db Database from which to read; it must outlive this object.
+   *  \param [in] tableName Table to read.
+   *  \param [in] lastKey Largest key already read.
+   *  \param [in] pageSize Number of rows to read per page.
+   */
+  TablePageReader(StampDB& db, const QString& tableName, const int lastKey, const int pageSize = DefaultPageSize);
+
+  /*! \return True if every row has been read. */
+  bool atEnd() const { return m_atEnd; }
+
+  /*! \return Name of the table that is read. */
+  const QString& getTableName() const { return m_tableName; }
+
+  /*! \brief Read the next page.
+   *  \param [out] keys Key for each row read.
+   *  \param [out] rows Values for each row in schema field order.
+   *  \return Number of rows read; zero at the end or on failure.
+   */
+  int readNextPage(QList<int>& keys, QList<QList<QVariant> >& rows);
+
+private:
+  StampDB& m_db;
+  QString m_tableName;
+  int m_lastKey;
+  int m_pageSize;
+  bool m_atEnd;
+};
+
+#endif // TABLEPAGEREADER_H
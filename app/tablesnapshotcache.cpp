@@ -0,0 +1,216 @@
+#include "tablesnapshotcache.h"
+#include "genericdatacollection.h"
+#include "describesqltable.h"
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThreadPool>
+
+TableSnapshotCache::TableSnapshotCache() : m_enabled(false), m_maxSize(DefaultMaxSize)
+{
+}
+
+void TableSnapshotCache::setDatabasePath(const QString& pathToDB)
+{
+  m_pathToDB = pathToDB;
+  m_cacheDir.clear();
+  const QString cacheRoot = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if (!pathToDB.isEmpty() && !cacheRoot.isEmpty())
+  {
+    // One directory per database so that two databases never share files.
+    QByteArray pathHash = QCryptographicHash::hash(QFileInfo(pathToDB).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex();
+    m_cacheDir = QDir(cacheRoot).filePath(QString("snapshots/%1").arg(QString::fromLatin1(pathHash.left(16))));
+  }
+}
+
+QString TableSnapshotCache::getSignature(const DescribeSqlTable& table, const QStringList& fieldNames, const QStringList& orderByList) const
+{
+  QFileInfo dbInfo(m_pathToDB);
+  QFileInfo walInfo(m_pathToDB + "-wal");
+  QString dbState = QString("%1:%2").arg(dbInfo.size()).arg(dbInfo.lastModified().toMSecsSinceEpoch());
+  if (walInfo.exists())
+  {
+    dbState += QString(":%1:%2").arg(walInfo.size()).arg(walInfo.lastModified().toMSecsSinceEpoch());
+  }
+
+  QCryptographicHash schemaHash(QCryptographicHash::Sha1);
+  schemaHash.addData(table.getDDL(false).toUtf8());
+  QStringList allFieldNames = table.getFieldNames();
+  for (int i=0; i<allFieldNames.size(); ++i)
+  {
+    schemaHash.addData(QString("%1=%2;").arg(allFieldNames.at(i)).arg(static_cast<int>(table.getFieldMetaType(allFieldNames.at(i)))).toUtf8());
+  }
+  schemaHash.addData(QString("select %1 order by %2").arg(fieldNames.join(","), orderByList.join(",")).toUtf8());
+  return dbState + "/" + QString::fromLatin1(schemaHash.result().toHex());
+}
+
+QString TableSnapshotCache::getCacheName(const QString& tableName, const QStringList& fieldNames)
+{
+  if (fieldNames.isEmpty())
+  {
+    return tableName;
+  }
+  QByteArray fieldHash = QCryptographicHash::hash(fieldNames.join(",").toLower().toUtf8(), QCryptographicHash::Md5).toHex();
+  return QString("%1-%2").arg(tableName, QString::fromLatin1(fieldHash.left(8)));
+}
+
+QString TableSnapshotCache::getFileName(const QString& tableName) const
+{
+  return QDir(m_cacheDir).filePath(tableName.toLower() + ".gdc");
+}
+
+GenericDataCollection* TableSnapshotCache::load(const QString& tableName, const QString& signature) const
+{
+  if (!isEnabled())
+  {
+    return nullptr;
+  }
+  QFile file(getFileName(tableName));
+  if (!file.exists() || !file.open(QIODevice::ReadOnly))
+  {
+    return nullptr;
+  }
+
+  qint64 fileSize = file.size();
+  uchar* mapped = file.map(0, fileSize);
+  if (mapped == nullptr)
+  {
+    return nullptr;
+  }
+
+  GenericDataCollection* collection = nullptr;
+  {
+    // The mapped memory is read in place; it is not copied into a buffer.
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), fileSize);
+    QDataStream stream(data);
+    stream.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString fileSignature;
+    stream >> magic >> version;
+    if (magic == FileMagic && version == FileVersion)
+    {
+      stream >> fileSignature;
+      if (fileSignature == signature)
+      {
+        collection = new GenericDataCollection();
+        if (!collection->readBinary(stream))
+        {
+          qDebug() << "Cache file for table" << tableName << "is damaged";
+          delete collection;
+          collection = nullptr;
+        }
+      }
+    }
+  }
+  file.unmap(mapped);
+  return collection;
+}
+
+void TableSnapshotCache::saveInBackground(const QString& tableName, const QString& signature, const GenericDataCollection& collection) const
+{
+  if (!isEnabled())
+  {
+    return;
+  }
+  // The snapshot shares the data, so this is cheap, and later changes to the collection do not affect it.
+  const GenericDataCollection* snapshot = collection.createSnapshot();
+  TableSnapshotCache cache(*this);
+  QThreadPool::globalInstance()->start([cache, tableName, signature, snapshot]() {
+    cache.save(tableName, signature, *snapshot);
+    delete snapshot;
+  });
+}
+
+bool TableSnapshotCache::save(const QString& tableName, const QString& signature, const GenericDataCollection& collection) const
+{
+  if (!QDir().mkpath(m_cacheDir))
+  {
+    qDebug() << "Unable to create the cache directory" << m_cacheDir;
+    return false;
+  }
+
+  // Readers never see a partial file; it is renamed into place when complete.
+  QSaveFile file(getFileName(tableName));
+  if (!file.open(QIODevice::WriteOnly))
+  {
+    return false;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_6_0);
+  stream << FileMagic << FileVersion << signature;
+  collection.writeBinary(stream);
+  if (stream.status() != QDataStream::Ok)
+  {
+    file.cancelWriting();
+    return false;
+  }
+  if (!file.commit())
+  {
+    return false;
+  }
+  prune(getFileName(tableName), signature);
+  return true;
+}
+
+void TableSnapshotCache::prune(const QString& keepFileName, const QString& signature) const
+{
+  // The part before the '/' is the state of the database file; a file written for another state never matches again.
+  const QString dbState = signature.section('/', 0, 0);
+  const QString keepName = QFileInfo(keepFileName).fileName();
+  QDir cacheDir(m_cacheDir);
+  QFileInfoList files = cacheDir.entryInfoList(QStringList() << "*.gdc", QDir::Files, QDir::Time);
+  qint64 totalSize = 0;
+  for (int i=0; i<files.size(); ++i)
+  {
+    const QFileInfo& fileInfo = files.at(i);
+    if (fileInfo.fileName() == keepName)
+    {
+      totalSize += fileInfo.size();
+      continue;
+    }
+    QFile file(fileInfo.absoluteFilePath());
+    quint32 magic = 0;
+    quint32 version = 0;
+    QString fileSignature;
+    if (file.open(QIODevice::ReadOnly))
+    {
+      QDataStream stream(&file);
+      stream.setVersion(QDataStream::Qt_6_0);
+      stream >> magic >> version;
+      if (magic == FileMagic && version == FileVersion)
+      {
+        stream >> fileSignature;
+      }
+      file.close();
+    }
+    // Newest first, so the oldest files are the ones over the limit.
+    if (fileSignature.section('/', 0, 0) != dbState || totalSize + fileInfo.size() > m_maxSize)
+    {
+      if (!file.remove())
+      {
+        qDebug() << "Unable to remove the cache file" << fileInfo.absoluteFilePath();
+      }
+    }
+    else
+    {
+      totalSize += fileInfo.size();
+    }
+  }
+}
+
+void TableSnapshotCache::clear() const
+{
+  if (!m_cacheDir.isEmpty())
+  {
+    QDir(m_cacheDir).removeRecursively();
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef TABLESNAPSHOTCACHE_H
+#define TABLESNAPSHOTCACHE_H
+
+#include <QString>
+#include <QStringList>
+
+class GenericDataCollection;
+class DescribeSqlTable;
+
+//**************************************************************************
+/*! \class TableSnapshotCache
+ * \brief Binary files of loaded tables so that a table can be opened without SQL or type conversions.
+ *
+ * There is one file per table, and per set of projected fields, in a directory for
+ * the database under the user's cache location, never next to the database. A file stores the column storage of a GenericDataCollection
+ * (typed values, null bits, and dictionaries) along with a signature built from the
+ * database file (size and modification time, including the write-ahead log) and
+ * the table's schema and row order. A file whose signature does not match is
+ * ignored and rewritten by the StampDB that writes snapshots (see StampDB::setSnapshotWriter).
+ *
+ * Any change to the database makes every file stale, so each write removes the
+ * files written for an older state of the database, then removes the oldest
+ * files until the directory is no larger than getMaxSize.
+ *
+ * Files are memory mapped when read and written in the background from a
+ * copy-on-write snapshot of the collection. All methods may be called from any thread.
+ *
+ * The cache is off until setEnabled(true) because it holds a copy of the user's data.
+ *
+ * \author Andrew Pitonyak
+ * \copyright Andrew Pitonyak, but you may use without restriction.
+ * \date 2026
+ **************************************************************************/
+class TableSnapshotCache
+{
+public:
+  /*! \brief Constructor; the cache is disabled until it is enabled and the database path is set. */
+  TableSnapshotCache();
+
+  /*! \brief Set the database that is cached; the cache files live in "snapshots/<hash of the path>" under QStandardPaths::CacheLocation.
+   *  \param [in] pathToDB Full path to the SQLite database, empty to disable the cache.
+   */
+  void setDatabasePath(const QString& pathToDB);
+
+  /*! \return True if the cache can be used. */
+  bool isEnabled() const { return m_enabled && !m_cacheDir.isEmpty(); }
+
+  /*! \brief Turn the cache on or off. */
+  void setEnabled(const bool enabled) { m_enabled = enabled; }
+
+  /*! \brief Default for getMaxSize. */
+  static const qint64 DefaultMaxSize = Q_INT64_C(256) * 1024 * 1024;
+
+  /*! \return Largest number of bytes kept in the cache directory. */
+  qint64 getMaxSize() const { return m_maxSize; }
+
+  /*! \brief Set the largest number of bytes kept in the cache directory; the newest file is kept even if it is larger. */
+  void setMaxSize(const qint64 maxSize) { m_maxSize = maxSize; }
+
+  /*! \brief Build the signature for the current state of the database and a table.
+   *  \param [in] table Schema for the table.
+   *  \param [in] fieldNames Fields that are read, empty for all fields.
+   *  \param [in] orderByList Fields used to order the rows.
+   *  \return Signature that must match for a cache file to be used.
+   */
+  QString getSignature(const DescribeSqlTable& table, const QStringList& fieldNames, const QStringList& orderByList) const;
+
+  /*! \brief Name used for the cache file so that a table read with only some fields does not replace the complete table.
+   *  \param [in] tableName Name of the table.
+   *  \param [in] fieldNames Fields that are read, empty for all fields.
+   *  \return Name to use with load and saveInBackground.
+   */
+  static QString getCacheName(const QString& tableName, const QStringList& fieldNames);
+
+  /*! \brief Load a table from its cache file.
+   *  \param [in] tableName Name from getCacheName.
+   *  \param [in] signature Expected signature from getSignature.
+   *  \return New collection that you own, or nullptr if there is no valid cache file.
+   */
+  GenericDataCollection* load(const QString& tableName, const QString& signature) const;
+
+  /*! \brief Write a table's cache file on a background thread.
+   *  \param [in] tableName Name from getCacheName.
+   *  \param [in] signature Signature from getSignature taken before the table was read.
+   *  \param [in] collection Table to write; a snapshot is taken, so the collection may change afterwards.
+   */
+  void saveInBackground(const QString& tableName, const QString& signature, const GenericDataCollection& collection) const;
+
+  /*! \brief Remove every cache file. */
+  void clear() const;
+
+private:
+  /*! \return Full path to the cache file for a table. */
+  QString getFileName(const QString& tableName) const;
+
+  /*! \brief Write the cache file; this is called on a background thread. */
+  bool save(const QString& tableName, const QString& signature, const GenericDataCollection& collection) const;
+
+  /*! \brief Remove the files that cannot match the database again, then the oldest files over getMaxSize.
+   *  \param [in] keepFileName File that was just written.
+   *  \param [in] signature Signature of that file, which holds the current state of the database.
+   */
+  void prune(const QString& keepFileName, const QString& signature) const;
+
+  /*! \brief Identifies a cache file. */
+  static const quint32 FileMagic = 0x47444353;
+
+  /*! \brief Increment when the file format changes. */
+  static const quint32 FileVersion = 2;
+
+  QString m_pathToDB;
+  QString m_cacheDir;
+  bool m_enabled;
+  qint64 m_maxSize;
+};
+
+#endif // TABLESNAPSHOTCACHE_H
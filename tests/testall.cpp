@@ -1,7 +1,23 @@
 
 #include "testall.h"
 #include "imageutility.h"
-//#include "stampdb.h"
+#include "genericdatacollection.h"
+#include "genericdatacolumn.h"
+#include "fieldref.h"
+#include "genericdatacollections.h"
+#include "genericdatacollectionstablemodel.h"
+#include "describesqltables.h"
+#include "stampdb.h"
+#include "chunkedlist.h"
+
+#include <QDataStream>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QTemporaryDir>
 
 void TestAll::testImageUtility() {
     ImageUtility iu;
@@ -69,3 +85,850 @@ void TestAll::testImageUtility() {
 **/
 }
 
+
+//
+// Build a small collection: id, name, and count.
+// IDs 1 to 5, names "b", "a", "B", "c", "a", count 10 * id; the count for ID 3 is null.
+//
+static void fillCollection(GenericDataCollection& collection)
+{
+    collection.appendPropertyName("id", QMetaType::Int);
+    collection.appendPropertyName("name", QMetaType::QString);
+    collection.appendPropertyName("count", QMetaType::Int);
+    const QStringList names = {"b", "a", "B", "c", "a"};
+    for (int i=0; i<names.size(); ++i) {
+        int id = i + 1;
+        QList<QVariant> values = {QVariant(id), QVariant(names.at(i)), (id == 3) ? QVariant() : QVariant(10 * id)};
+        collection.appendValues(id, values);
+    }
+}
+
+void TestAll::testColumnStorage() {
+    GenericDataColumn column(QMetaType::Int, 3);
+    QVERIFY(column.size() == 3);
+    QVERIFY(!column.contains(0));
+    QVERIFY(!column.value(0).isValid());
+
+    column.setValue(0, QVariant(7));
+    QVERIFY(column.contains(0));
+    QVERIFY(column.value(0).metaType().id() == QMetaType::Int);
+    QVERIFY(column.value(0).toInt() == 7);
+    QVERIFY(column.toString(0) == "7");
+
+    // A value of another type is kept exactly as it was set.
+    column.setValue(1, QVariant(QString("abc")));
+    QVERIFY(column.contains(1));
+    QVERIFY(column.value(1).metaType().id() == QMetaType::QString);
+    QVERIFY(column.value(1).toString() == "abc");
+
+    // Setting a value of the column type replaces the overflow value.
+    column.setValue(1, QVariant(8));
+    QVERIFY(column.value(1).metaType().id() == QMetaType::Int);
+    QVERIFY(column.value(1).toInt() == 8);
+
+    column.removeValue(0);
+    QVERIFY(!column.contains(0));
+    QVERIFY(column.toString(0) == "");
+
+    column.moveSlot(1, 2);
+    QVERIFY(column.value(2).toInt() == 8);
+    column.removeLast();
+    QVERIFY(column.size() == 2);
+
+    // Nulls in a collection.
+    GenericDataCollection collection;
+    fillCollection(collection);
+    QVERIFY(collection.getObjectCount() == 5);
+    QVERIFY(!collection.containsValue(3, "count"));
+    QVERIFY(collection.containsValue(4, "count"));
+    QVERIFY(collection.getInt(4, "count") == 40);
+    QVERIFY(collection.getInt(3, "count", -5) == -5);
+
+    // A string column with repeated values is dictionary encoded, values are unchanged.
+    GenericDataColumn grades(QMetaType::QString, 0);
+    grades.resize(12);
+    for (int slot=0; slot<12; ++slot) {
+        grades.setValue(slot, QVariant(QString((slot % 2 == 0) ? "VF" : "F")));
+    }
+    QVERIFY(grades.encodeAsDictionary(256));
+    QVERIFY(grades.isDictionaryEncoded());
+    QVERIFY(grades.getDictionary().size() == 2);
+    QVERIFY(grades.value(3).toString() == "F");
+    QVERIFY(grades.findMatches("vf", Qt::CaseInsensitive).count(true) == 6);
+
+    // A value that is no longer used frees its code for the next new value.
+    GenericDataColumn conditions(QMetaType::QString, 0);
+    conditions.resize(12);
+    for (int slot=0; slot<12; ++slot) {
+        conditions.setValue(slot, QVariant(QString((slot < 11) ? "used" : "mint")));
+    }
+    QVERIFY(conditions.encodeAsDictionary(2));
+    QVERIFY(conditions.getDictionaryCount() == 2);
+    conditions.removeValue(11);
+    QVERIFY(conditions.getDictionaryCount() == 1);
+    conditions.setValue(10, QVariant(QString("fine")));
+    QVERIFY(conditions.getDictionaryCount() == 2);
+    QVERIFY(conditions.getDictionary().size() == 2);
+    QVERIFY(conditions.value(10).toString() == "fine");
+
+    // The limit is still in force after the encoding, so a third distinct value decodes the column.
+    conditions.setValue(9, QVariant(QString("poor")));
+    QVERIFY(!conditions.isDictionaryEncoded());
+    QVERIFY(conditions.value(9).toString() == "poor");
+    QVERIFY(conditions.value(10).toString() == "fine");
+    QVERIFY(conditions.value(0).toString() == "used");
+}
+
+void TestAll::testFieldRef() {
+    GenericDataCollection collection;
+    fillCollection(collection);
+
+    FieldRef nameRef = collection.resolve("NAME");
+    QVERIFY(nameRef.isValid());
+    QVERIFY(nameRef.getIndex() == collection.getPropertyIndex("name"));
+    QVERIFY(nameRef.getLowerCaseName() == "name");
+    QVERIFY(!collection.resolve("missing").isValid());
+
+    // A bound reference and a name only reference return the same values.
+    FieldRef byName("Name");
+    FieldRef countRef = collection.resolve("count");
+    for (int row=0; row<collection.rowCount(); ++row) {
+        const GenericDataObject* object = collection.getObjectByRow(row);
+        QVERIFY(object->getString(nameRef) == object->getString(byName));
+        QVERIFY(object->getString(nameRef) == object->getString("name"));
+        QVERIFY(object->contains(countRef) == collection.containsValue(object->getInt("id"), "count"));
+    }
+
+    GenericDataObject* object = collection.getObjectById(2);
+    object->set(nameRef, QVariant(QString("z")));
+    QVERIFY(collection.getString(2, "name") == "z");
+}
+
+void TestAll::testSort() {
+    GenericDataCollection collection;
+    fillCollection(collection);
+
+    // Case insensitive, ties ("b" and "B", "a" and "a") broken by ID.
+    collection.addSortField("name", Qt::AscendingOrder, Qt::CaseInsensitive);
+    collection.sort();
+    QList<int> expected = {2, 5, 1, 3, 4};
+    for (int row=0; row<expected.size(); ++row) {
+        QVERIFY(collection.getObjectByRow(row)->getInt("id") == expected.at(row));
+    }
+
+    collection.clearSortFields();
+    collection.addSortField("count", Qt::DescendingOrder);
+    collection.sort();
+    QVERIFY(collection.getObjectByRow(0)->getInt("id") == 5);
+
+    // No sort fields sorts by ID.
+    collection.clearSortFields();
+    collection.sort();
+    for (int row=0; row<collection.rowCount(); ++row) {
+        QVERIFY(collection.getObjectByRow(row)->getInt("id") == row + 1);
+    }
+
+    // Strings sort as the view does: numbers by value and accented letters with their base letter.
+    GenericDataCollection words;
+    words.appendPropertyName("id", QMetaType::Int);
+    words.appendPropertyName("name", QMetaType::QString);
+    const QStringList names = {"zebra", "item10", "éclair", "item9"};
+    for (int i=0; i<names.size(); ++i) {
+        words.appendValues(i + 1, QList<QVariant>() << QVariant(i + 1) << QVariant(names.at(i)));
+    }
+    words.addSortField("name", Qt::AscendingOrder, Qt::CaseInsensitive);
+    words.sort();
+    expected = {3, 4, 2, 1};
+    for (int row=0; row<expected.size(); ++row) {
+        QVERIFY(words.getObjectByRow(row)->getInt("id") == expected.at(row));
+    }
+}
+
+void TestAll::testIdRowIndex() {
+    GenericDataCollection collection;
+    fillCollection(collection);
+    for (int id=1; id<=5; ++id) {
+        QVERIFY(collection.getIndexOf(id) == id - 1);
+    }
+    QVERIFY(collection.getIndexOf(99) == -1);
+
+    collection.removeObject(2);
+    QVERIFY(!collection.containsObject(2));
+    QVERIFY(collection.getIndexOf(2) == -1);
+    QVERIFY(collection.getIndexOf(3) == 1);
+    QVERIFY(collection.getIndexOf(5) == 3);
+    QVERIFY(collection.getString(5, "name") == "a");
+    QVERIFY(collection.getIds().size() == 4);
+
+    // The reverse index follows a sort.
+    collection.addSortField("id", Qt::DescendingOrder);
+    collection.sort();
+    QVERIFY(collection.getIndexOf(5) == 0);
+    QVERIFY(collection.getIndexOf(1) == 3);
+
+    collection.removeRows(QList<int>() << 0 << 0 << 7);
+    QVERIFY(collection.getObjectCount() == 3);
+    QVERIFY(collection.getIndexOf(4) == 0);
+    QVERIFY(collection.getLargestId() == 5);
+
+    // Many removals by ID compact the rows once; unknown IDs are ignored.
+    collection.removeObjects(QList<int>() << 4 << 99 << 1);
+    QVERIFY(collection.getObjectCount() == 1);
+    QVERIFY(collection.getIndexOf(3) == 0);
+    QVERIFY(collection.getIndexOf(1) == -1);
+}
+
+void TestAll::testValueIndex() {
+    GenericDataCollection collection;
+    fillCollection(collection);
+    int scanCount = collection.countValues("name", "b");
+    QVERIFY(scanCount == 2);
+
+    QVERIFY(collection.createIndex("name", Qt::CaseInsensitive));
+    QVERIFY(collection.hasIndex("name"));
+    QVERIFY(collection.countValues("name", "b") == scanCount);
+    QVERIFY(collection.countValues("name", "b", Qt::CaseSensitive) == 1);
+    QVERIFY(collection.getObjectByValue("name", "a")->getInt("id") == 2);
+
+    // The index follows edits, removals, and additions.
+    collection.getObjectById(1)->setValueNative("name", QString("a"));
+    QVERIFY(collection.countValues("name", "a") == 3);
+    QVERIFY(collection.countValues("name", "b") == 1);
+    collection.removeObject(2);
+    QVERIFY(collection.countValues("name", "a") == 2);
+    QVERIFY(collection.getObjectByValue("name", "a")->getInt("id") == 1);
+    collection.appendValues(6, QList<QVariant>() << 6 << QString("A") << 60);
+    QVERIFY(collection.countValues("name", "a") == 3);
+    QVERIFY(collection.countValues("name", "a", Qt::CaseSensitive) == 2);
+
+    collection.dropIndex("name");
+    QVERIFY(!collection.hasIndex("name"));
+    QVERIFY(collection.countValues("name", "a") == 3);
+}
+
+void TestAll::testCopyOnWrite() {
+    GenericDataCollection collection;
+    fillCollection(collection);
+    GenericDataCollection copy;
+    copy = collection;
+    QVERIFY(copy.getObjectCount() == collection.getObjectCount());
+    QVERIFY(copy.getString(4, "name") == "c");
+
+    // Changing the copy leaves the original alone, and the other way around.
+    copy.getObjectById(4)->setValueNative("name", QString("changed"));
+    copy.removeObject(5);
+    QVERIFY(collection.getString(4, "name") == "c");
+    QVERIFY(collection.containsObject(5));
+    collection.getObjectById(1)->setValueNative("count", 99);
+    QVERIFY(copy.getInt(1, "count") == 10);
+    QVERIFY(copy.getString(4, "name") == "changed");
+
+    // A snapshot does not see later changes.
+    const GenericDataCollection* snapshot = collection.createSnapshot();
+    collection.getObjectById(2)->setValueNative("name", QString("later"));
+    QVERIFY(snapshot->getString(2, "name") == "a");
+    QVERIFY(snapshot->getInt(1, "count") == 99);
+    delete snapshot;
+}
+
+void TestAll::testChunkedList() {
+    const int n = ChunkedList<int>::ChunkSize * 2 + 10;
+    ChunkedList<int> list(n, -1);
+    QVERIFY(list.size() == n);
+    QVERIFY(list.chunkCount() == 3);
+    QVERIFY(list.at(n - 1) == -1);
+    for (int i=0; i<n; ++i) {
+        list[i] = i;
+    }
+
+    // A write to the copy only copies the chunk that holds the value.
+    ChunkedList<int> copy = list;
+    copy[5] = 500;
+    QVERIFY(list.at(5) == 5);
+    QVERIFY(copy.at(5) == 500);
+    QVERIFY(copy.chunk(0).constData() != list.chunk(0).constData());
+    QVERIFY(copy.chunk(1).constData() == list.chunk(1).constData());
+    QVERIFY(copy.chunk(2).constData() == list.chunk(2).constData());
+
+    // Shrink into the first chunk and grow again; new values get the fill value.
+    copy.resize(10);
+    QVERIFY(copy.chunkCount() == 1);
+    copy.resize(ChunkedList<int>::ChunkSize + 1, 7);
+    QVERIFY(copy.at(9) == 9);
+    QVERIFY(copy.at(10) == 7);
+    QVERIFY(copy.at(ChunkedList<int>::ChunkSize) == 7);
+    QVERIFY(list.size() == n);
+
+    // The stream format is the same as a QList.
+    QList<int> flat;
+    for (int i=0; i<n; ++i) {
+        flat << i;
+    }
+    QByteArray bytes;
+    {
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        out << list;
+    }
+    QByteArray flatBytes;
+    {
+        QDataStream out(&flatBytes, QIODevice::WriteOnly);
+        out << flat;
+    }
+    QVERIFY(bytes == flatBytes);
+    ChunkedList<int> read;
+    {
+        QDataStream in(bytes);
+        in >> read;
+        QVERIFY(in.status() == QDataStream::Ok);
+    }
+    QVERIFY(read.size() == n);
+    QVERIFY(read.at(n - 1) == n - 1);
+}
+
+void TestAll::testBinaryRoundTrip() {
+    // A dictionary encoded column with a null and a value of another type.
+    GenericDataColumn grades(QMetaType::QString, 12);
+    for (int slot=0; slot<12; ++slot) {
+        grades.setValue(slot, QVariant(QString((slot % 3 == 0) ? "VF" : "F")));
+    }
+    QVERIFY(grades.encodeAsDictionary(256));
+    grades.removeValue(4);
+    grades.setValue(5, QVariant(17));
+
+    QByteArray bytes;
+    {
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        grades.writeBinary(out);
+    }
+    GenericDataColumn copy(QMetaType::QString, 0);
+    {
+        QDataStream in(bytes);
+        QVERIFY(copy.readBinary(in));
+    }
+    QVERIFY(copy.isDictionaryEncoded());
+    QVERIFY(copy.getDictionary() == grades.getDictionary());
+    QVERIFY(copy.size() == grades.size());
+    for (int slot=0; slot<grades.size(); ++slot) {
+        QVERIFY(copy.contains(slot) == grades.contains(slot));
+        QVERIFY(copy.value(slot) == grades.value(slot));
+    }
+
+    // Truncated data is rejected.
+    {
+        GenericDataColumn truncated(QMetaType::QString, 0);
+        QDataStream in(bytes.left(bytes.size() / 2));
+        QVERIFY(!truncated.readBinary(in));
+    }
+
+    // A sorted collection with a removed object keeps its order, values, and largest ID.
+    GenericDataCollection collection;
+    fillCollection(collection);
+    collection.removeObject(2);
+    collection.addSortField("name");
+    collection.sort();
+    bytes.clear();
+    {
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        collection.writeBinary(out);
+    }
+    GenericDataCollection restored;
+    {
+        QDataStream in(bytes);
+        QVERIFY(restored.readBinary(in));
+    }
+    QVERIFY(restored.getObjectCount() == collection.getObjectCount());
+    QVERIFY(restored.getLargestId() == collection.getLargestId());
+    for (int row=0; row<collection.rowCount(); ++row) {
+        int id = collection.getObjectByRow(row)->getInt("id");
+        QVERIFY(restored.getObjectByRow(row)->getInt("id") == id);
+        QVERIFY(restored.getString(id, "name") == collection.getString(id, "name"));
+        QVERIFY(restored.containsValue(id, "count") == collection.containsValue(id, "count"));
+    }
+    QVERIFY(!restored.containsObject(2));
+}
+
+//
+// Country table with IDs 1 to 3 for the change tracking tests.
+//
+static GenericDataCollection* createCountries()
+{
+    GenericDataCollection* countries = new GenericDataCollection();
+    countries->appendPropertyName("id", QMetaType::Int);
+    countries->appendPropertyName("name", QMetaType::QString);
+    countries->appendPropertyName("a3", QMetaType::QString);
+    countries->appendValues(1, QList<QVariant>() << 1 << QString("Canada") << QString("CAN"));
+    countries->appendValues(2, QList<QVariant>() << 2 << QString("France") << QString("FRA"));
+    countries->appendValues(3, QList<QVariant>() << 3 << QString("Japan") << QString("JPN"));
+    return countries;
+}
+
+//
+// The country table and a model that tracks changes to it.
+//
+struct CountryFixture
+{
+    CountryFixture() : schema(DescribeSqlTables::getStampSchema()), countries(createCountries())
+    {
+        tables.addCollection("country", countries.data());
+        model.reset(new GenericDataCollectionsTableModel(false, "country", tables, schema));
+    }
+
+    DescribeSqlTables schema;
+    QScopedPointer<GenericDataCollection> countries;
+    GenericDataCollections tables;
+    QScopedPointer<GenericDataCollectionsTableModel> model;
+};
+
+//
+// Read "id=name" for every country in the database, ordered by id.
+//
+static QStringList readCountryNames(StampDB& stampDB)
+{
+    QStringList names;
+    QSqlQuery query(stampDB.getDB());
+    if (query.exec("SELECT id, name FROM country ORDER BY id")) {
+        while (query.next()) {
+            names << QString("%1=%2").arg(query.value(0).toInt()).arg(query.value(1).toString());
+        }
+    }
+    return names;
+}
+
+void TestAll::testCoalesceAddEditDelete() {
+    CountryFixture fixture;
+    GenericDataCollectionsTableModel& model = *fixture.model;
+
+    // A row that is added, edited, and deleted is never written.
+    model.addRow();
+    QVERIFY(fixture.countries->getObjectCount() == 4);
+    model.setData(model.getIndexByRowCol(3, 1), QString("Peru"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(3, 2), QString("PER"), Qt::EditRole);
+    model.deleteRows(QModelIndexList() << model.getIndexByRowCol(3, 0));
+
+    QList<int> insertIds;
+    QList<int> deleteIds;
+    QMap<int, QStringList> editedFields;
+    model.coalesceTrackedChanges(insertIds, deleteIds, editedFields);
+    QVERIFY(insertIds.isEmpty());
+    QVERIFY(deleteIds.isEmpty());
+    QVERIFY(editedFields.isEmpty());
+}
+
+void TestAll::testCoalesceEdits() {
+    CountryFixture fixture;
+    GenericDataCollectionsTableModel& model = *fixture.model;
+
+    // Every edit to a row becomes one UPDATE that lists each field once.
+    model.setData(model.getIndexByRowCol(1, 1), QString("A"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(1, 2), QString("AAA"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(1, 1), QString("B"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(1, 1), QString("Gaul"), Qt::EditRole);
+
+    QList<int> insertIds;
+    QList<int> deleteIds;
+    QMap<int, QStringList> editedFields;
+    model.coalesceTrackedChanges(insertIds, deleteIds, editedFields);
+    QVERIFY(insertIds.isEmpty());
+    QVERIFY(deleteIds.isEmpty());
+    QVERIFY(editedFields.size() == 1);
+    QVERIFY(editedFields.contains(2));
+    QVERIFY(editedFields.value(2).size() == 2);
+    QVERIFY(editedFields.value(2).contains("name", Qt::CaseInsensitive));
+    QVERIFY(editedFields.value(2).contains("a3", Qt::CaseInsensitive));
+    QVERIFY(fixture.countries->getString(2, "name") == "Gaul");
+}
+
+void TestAll::testCoalesceDeleteAdd() {
+    CountryFixture fixture;
+    GenericDataCollectionsTableModel& model = *fixture.model;
+
+    // Delete the last row and add a row that reuses the ID.
+    model.deleteRows(QModelIndexList() << model.getIndexByRowCol(2, 0));
+    fixture.countries->setLargestId(2);
+    model.addRow();
+    QVERIFY(fixture.countries->containsObject(3));
+
+    // The old row is deleted and the new row is inserted, the save deletes first.
+    QList<int> insertIds;
+    QList<int> deleteIds;
+    QMap<int, QStringList> editedFields;
+    model.coalesceTrackedChanges(insertIds, deleteIds, editedFields);
+    QVERIFY(insertIds == QList<int>() << 3);
+    QVERIFY(deleteIds == QList<int>() << 3);
+    QVERIFY(editedFields.isEmpty());
+}
+
+void TestAll::testCoalesceEditDelete() {
+    CountryFixture fixture;
+    GenericDataCollectionsTableModel& model = *fixture.model;
+
+    // A row that is edited and then deleted is only deleted.
+    model.setData(model.getIndexByRowCol(0, 1), QString("Dominion"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(2, 1), QString("Nippon"), Qt::EditRole);
+    model.deleteRows(QModelIndexList() << model.getIndexByRowCol(0, 0));
+
+    QList<int> insertIds;
+    QList<int> deleteIds;
+    QMap<int, QStringList> editedFields;
+    model.coalesceTrackedChanges(insertIds, deleteIds, editedFields);
+    QVERIFY(insertIds.isEmpty());
+    QVERIFY(deleteIds == QList<int>() << 1);
+    QVERIFY(editedFields.size() == 1);
+    QVERIFY(editedFields.contains(3));
+}
+
+void TestAll::testSaveTrackedChanges() {
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    StampDB stampDB;
+    stampDB.setConnectionName("testSaveTrackedChanges");
+    stampDB.pathToDB(dir.filePath("stamps.sqlite"));
+    QVERIFY(stampDB.createSchema());
+    {
+        QSqlQuery query(stampDB.getDB());
+        QVERIFY(query.exec("INSERT INTO country (id, name, a3) VALUES (1, 'Canada', 'CAN'), (2, 'France', 'FRA'), (3, 'Japan', 'JPN')"));
+    }
+
+    CountryFixture fixture;
+    GenericDataCollectionsTableModel& model = *fixture.model;
+    QString errorMessage;
+
+    // Add, edit, and delete, then save them together.
+    model.addRow();
+    QVERIFY(fixture.countries->containsObject(4));
+    model.setData(model.getIndexByRowCol(3, 1), QString("Peru"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(3, 2), QString("PER"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(1, 1), QString("Gaul"), Qt::EditRole);
+    model.deleteRows(QModelIndexList() << model.getIndexByRowCol(0, 0));
+    QVERIFY(model.saveTrackedChanges("country", *fixture.countries, stampDB.getDB(), fixture.schema, stampDB.getQueryCache(), errorMessage));
+    QVERIFY(errorMessage.isEmpty());
+    QVERIFY(model.trackerIsEmpty());
+    QVERIFY(readCountryNames(stampDB) == QStringList() << "2=Gaul" << "3=Japan" << "4=Peru");
+
+    // A failed statement rolls back every change and keeps the changes to save again.
+    {
+        QSqlQuery query(stampDB.getDB());
+        QVERIFY(query.exec("CREATE TRIGGER country_fail BEFORE UPDATE ON country WHEN NEW.name = 'fail' BEGIN SELECT RAISE(ABORT, 'fail'); END"));
+    }
+    model.setData(model.getIndexByRowCol(fixture.countries->getIndexOf(2), 1), QString("France"), Qt::EditRole);
+    model.setData(model.getIndexByRowCol(fixture.countries->getIndexOf(3), 1), QString("fail"), Qt::EditRole);
+    model.deleteRows(QModelIndexList() << model.getIndexByRowCol(fixture.countries->getIndexOf(4), 0));
+    QVERIFY(!model.saveTrackedChanges("country", *fixture.countries, stampDB.getDB(), fixture.schema, stampDB.getQueryCache(), errorMessage));
+    QVERIFY(!errorMessage.isEmpty());
+    QVERIFY(!model.trackerIsEmpty());
+    QVERIFY(readCountryNames(stampDB) == QStringList() << "2=Gaul" << "3=Japan" << "4=Peru");
+    stampDB.closeDB();
+}
+
+//
+// Benchmarks are slow, so they only run if ADP_BENCHMARK is set.
+// ADP_BENCHMARK_ROWS sets the number of generated rows, 500000 by default.
+//
+static int benchmarkRows()
+{
+    bool ok = false;
+    int rows = qEnvironmentVariableIntValue("ADP_BENCHMARK_ROWS", &ok);
+    return (ok && rows > 0) ? rows : 500000;
+}
+
+//
+// Value from /proc/self/status in kB, such as VmHWM for the peak resident set size.
+// Returns -1 if it is not available, which is every system other than Linux.
+//
+static qint64 readProcessStatus(const QByteArray& key)
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return -1;
+    }
+    const QByteArray prefix = key + ':';
+    const QList<QByteArray> lines = file.readAll().split('\n');
+    for (int i=0; i<lines.size(); ++i) {
+        if (lines.at(i).startsWith(prefix)) {
+            return lines.at(i).mid(prefix.size()).trimmed().split(' ').value(0).toLongLong();
+        }
+    }
+    return -1;
+}
+
+//
+// Fill the catalog table with numRows rows. Every value is computed from the row number,
+// so each run loads the same data.
+//
+static bool generateCatalog(StampDB& stampDB, const int numRows)
+{
+    QSqlDatabase& db = stampDB.getDB();
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    if (!query.prepare("INSERT INTO catalog (id, scott, countryid, typeid, releasedate, updated, facevalue, description) VALUES (?, ?, ?, ?, ?, ?, ?, ?)")) {
+        db.rollback();
+        return false;
+    }
+    const QStringList prefixes = {"", "C", "O", "RW", "J", "Q", "E", "UX"};
+    const QDate firstDate(1847, 7, 1);
+    const QDateTime firstUpdate(QDate(2020, 1, 1), QTime(0, 0));
+    const int batchSize = 10000;
+    for (int first=1; first<=numRows; first+=batchSize) {
+        QVariantList ids, scotts, countryIds, typeIds, releaseDates, updates, faceValues, descriptions;
+        for (int id=first; id<first+batchSize && id<=numRows; ++id) {
+            ids << id;
+            scotts << QString("%1%2").arg(prefixes.at(id % prefixes.size())).arg(id);
+            countryIds << 1 + id % 50;
+            typeIds << 1 + id % 8;
+            releaseDates << firstDate.addDays(id % 60000).toString(Qt::ISODate);
+            updates << firstUpdate.addSecs(id).toString(Qt::ISODate);
+            faceValues << (id % 100) * 0.05;
+            descriptions << QString("Design %1 issue %2").arg(id % 997).arg(id);
+        }
+        query.addBindValue(ids);
+        query.addBindValue(scotts);
+        query.addBindValue(countryIds);
+        query.addBindValue(typeIds);
+        query.addBindValue(releaseDates);
+        query.addBindValue(updates);
+        query.addBindValue(faceValues);
+        query.addBindValue(descriptions);
+        if (!query.execBatch()) {
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+
+//
+// Fill the inventory table with one row for each catalog row from 1 to numRows.
+//
+static bool generateInventory(StampDB& stampDB, const int numRows)
+{
+    QSqlDatabase& db = stampDB.getDB();
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    if (!query.prepare("INSERT INTO inventory (id, catalogid, quantity, grade, condition, centering, comment, purchasedate, paid, dealerid, locationid, replace, updated, typeid, valuemultiplier) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)")) {
+        db.rollback();
+        return false;
+    }
+    const QStringList grades = {"XF", "VF", "F", "VG", "G"};
+    const QStringList conditions = {"MNH", "MH", "Used", "NG"};
+    const QStringList centering = {"Well centered", "Off center", "Perfs cut"};
+    const QDate firstDate(1990, 1, 1);
+    const QDateTime firstUpdate(QDate(2020, 1, 1), QTime(0, 0));
+    const int batchSize = 10000;
+    for (int first=1; first<=numRows; first+=batchSize) {
+        QVariantList ids, catalogIds, quantities, gradeList, conditionList, centeringList, comments, purchaseDates, paid, dealerIds, locationIds, replace, updates, typeIds, multipliers;
+        for (int id=first; id<first+batchSize && id<=numRows; ++id) {
+            ids << id;
+            catalogIds << id;
+            quantities << 1 + id % 4;
+            gradeList << grades.at(id % grades.size());
+            conditionList << conditions.at(id % conditions.size());
+            centeringList << centering.at(id % centering.size());
+            comments << ((id % 10 == 0) ? QVariant(QString("Comment, \"quoted\" %1").arg(id)) : QVariant());
+            purchaseDates << firstDate.addDays(id % 12000).toString(Qt::ISODate);
+            paid << (id % 500) * 0.25;
+            dealerIds << 1 + id % 20;
+            locationIds << 1 + id % 5;
+            replace << (id % 7 == 0);
+            updates << firstUpdate.addSecs(id).toString(Qt::ISODate);
+            typeIds << 1 + id % 3;
+            multipliers << 1.0;
+        }
+        query.addBindValue(ids);
+        query.addBindValue(catalogIds);
+        query.addBindValue(quantities);
+        query.addBindValue(gradeList);
+        query.addBindValue(conditionList);
+        query.addBindValue(centeringList);
+        query.addBindValue(comments);
+        query.addBindValue(purchaseDates);
+        query.addBindValue(paid);
+        query.addBindValue(dealerIds);
+        query.addBindValue(locationIds);
+        query.addBindValue(replace);
+        query.addBindValue(updates);
+        query.addBindValue(typeIds);
+        query.addBindValue(multipliers);
+        if (!query.execBatch()) {
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+
+//
+// Fill the tables that the full inventory export joins to the catalog and inventory rows.
+// Each catalog row has a book value for the grade of its inventory row and for one other grade.
+//
+static bool generateLinkedTables(StampDB& stampDB, const int numRows)
+{
+    QSqlDatabase& db = stampDB.getDB();
+    if (!db.transaction()) {
+        return false;
+    }
+    QSqlQuery query(db);
+    QStringList ddl;
+    for (int id=1; id<=50; ++id) {
+        ddl << QString("INSERT INTO country (id, name, a3) VALUES (%1, 'Country %1', 'C%2')").arg(id).arg(id, 2, 10, QLatin1Char('0'));
+    }
+    const QStringList typeNames = {"Regular", "Airmail", "Official", "Revenue", "Postage Due", "Parcel Post", "Special Delivery", "Envelope"};
+    for (int id=1; id<=typeNames.size(); ++id) {
+        ddl << QString("INSERT INTO catalogtype (id, name, description) VALUES (%1, '%2', '%2 stamps')").arg(id).arg(typeNames.at(id - 1));
+    }
+    for (int id=1; id<=20; ++id) {
+        ddl << QString("INSERT INTO dealer (id, name) VALUES (%1, 'Dealer %1')").arg(id);
+    }
+    for (int id=1; id<=5; ++id) {
+        ddl << QString("INSERT INTO stamplocation (id, name, description) VALUES (%1, 'Album %1', 'Shelf %1')").arg(id);
+    }
+    // The same grades, in the same order, as generateInventory.
+    const QStringList grades = {"XF", "VF", "F", "VG", "G"};
+    for (int id=1; id<=grades.size(); ++id) {
+        ddl << QString("INSERT INTO valuetype (id, description) VALUES (%1, '%2')").arg(id).arg(grades.at(id - 1));
+    }
+    ddl << "INSERT INTO valuesource (id, year, description) VALUES (1, '2024-01-01', 'Catalog 2024')";
+    for (int i=0; i<ddl.size(); ++i) {
+        if (!query.exec(ddl.at(i))) {
+            db.rollback();
+            return false;
+        }
+    }
+
+    if (!query.prepare("INSERT INTO bookvalues (catalogid, sourceid, valuetypeid, bookvalue) VALUES (?, ?, ?, ?)")) {
+        db.rollback();
+        return false;
+    }
+    const int batchSize = 10000;
+    for (int first=1; first<=numRows; first+=batchSize) {
+        QVariantList catalogIds, sourceIds, valueTypeIds, bookValues;
+        for (int id=first; id<first+batchSize && id<=numRows; ++id) {
+            for (int offset=0; offset<2; ++offset) {
+                catalogIds << id;
+                sourceIds << 1;
+                valueTypeIds << 1 + (id + offset) % grades.size();
+                bookValues << (id % 400) * 0.25 + offset;
+            }
+        }
+        query.addBindValue(catalogIds);
+        query.addBindValue(sourceIds);
+        query.addBindValue(valueTypeIds);
+        query.addBindValue(bookValues);
+        if (!query.execBatch()) {
+            db.rollback();
+            return false;
+        }
+    }
+    return db.commit();
+}
+
+//
+// Run the query used by the one file CSV export and read every value, as the export does.
+// Returns the elapsed milliseconds, or -1 if the query fails.
+//
+static qint64 runFullInventoryExport(StampDB& stampDB, qint64& numRows)
+{
+    numRows = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QSqlQuery query(stampDB.getDB());
+    query.setForwardOnly(true);
+    if (!query.exec(StampDB::FullInventorySql)) {
+        qDebug() << "Full inventory export failed:" << query.lastError().text();
+        return -1;
+    }
+    const int numCols = query.record().count();
+    qint64 numChars = 0;
+    while (query.next()) {
+        for (int col=0; col<numCols; ++col) {
+            numChars += query.value(col).toString().size();
+        }
+        ++numRows;
+    }
+    qint64 elapsed = timer.elapsed();
+    qDebug() << "Read" << numRows << "rows and" << numChars << "characters";
+    return elapsed;
+}
+
+void TestAll::benchmarkCatalogLoad() {
+    if (!qEnvironmentVariableIsSet("ADP_BENCHMARK")) {
+        QSKIP("Set ADP_BENCHMARK to run the benchmarks.");
+    }
+    const int numRows = benchmarkRows();
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    StampDB stampDB;
+    stampDB.setConnectionName("benchmarkCatalogLoad");
+    stampDB.pathToDB(dir.filePath("stamps.sqlite"));
+    // Measure the read from the DB and the row storage, not the snapshot cache.
+    stampDB.setSnapshotCacheEnabled(false);
+    QVERIFY(stampDB.createSchema());
+    QVERIFY(generateCatalog(stampDB, numRows));
+
+    qint64 rssBefore = readProcessStatus("VmRSS");
+    qint64 peakBefore = readProcessStatus("VmHWM");
+    QElapsedTimer timer;
+    timer.start();
+    GenericDataCollection* catalog = stampDB.readTableBySchema("catalog");
+    qint64 loadMs = timer.elapsed();
+    QVERIFY(catalog != nullptr);
+    QVERIFY(catalog->getObjectCount() == numRows);
+    qint64 rssLoaded = readProcessStatus("VmRSS");
+    qint64 peakLoad = readProcessStatus("VmHWM");
+    delete catalog;
+
+    qDebug() << "Catalog rows" << numRows;
+    qDebug() << "Load from the DB" << loadMs << "ms";
+    qDebug() << "RSS before" << rssBefore << "kB, loaded" << rssLoaded << "kB";
+    qDebug() << "Peak RSS before" << peakBefore << "kB, after the load" << peakLoad << "kB";
+    stampDB.closeDB();
+}
+
+void TestAll::benchmarkExport() {
+    if (!qEnvironmentVariableIsSet("ADP_BENCHMARK")) {
+        QSKIP("Set ADP_BENCHMARK to run the benchmarks.");
+    }
+    const int numRows = benchmarkRows();
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    StampDB stampDB;
+    stampDB.setConnectionName("benchmarkExport");
+    stampDB.pathToDB(dir.filePath("stamps.sqlite"));
+    QVERIFY(stampDB.createSchema());
+    QVERIFY(generateLinkedTables(stampDB, numRows));
+    QVERIFY(generateCatalog(stampDB, numRows));
+    QVERIFY(generateInventory(stampDB, numRows));
+
+    // Before: the tables as they were before createIndexes, with only the primary keys.
+    QSqlQuery query(stampDB.getDB());
+    QStringList indexNames;
+    QVERIFY(query.exec("SELECT name FROM sqlite_master WHERE type='index' AND name LIKE 'idx\\_%' ESCAPE '\\'"));
+    while (query.next()) {
+        indexNames << query.value(0).toString();
+    }
+    query.finish();
+    QVERIFY(!indexNames.isEmpty());
+    for (int i=0; i<indexNames.size(); ++i) {
+        QVERIFY(query.exec(QString("DROP INDEX %1").arg(indexNames.at(i))));
+    }
+    qint64 numRowsBefore = 0;
+    qint64 withoutMs = runFullInventoryExport(stampDB, numRowsBefore);
+
+    // After: the indexes from createIndexes.
+    QVERIFY(stampDB.createIndexes());
+    qint64 numRowsAfter = 0;
+    qint64 withMs = runFullInventoryExport(stampDB, numRowsAfter);
+
+    // Every inventory row matches one book value.
+    QVERIFY(numRowsBefore == numRows);
+    QVERIFY(numRowsAfter == numRowsBefore);
+
+    qDebug() << "Inventory rows" << numRows << "dropped indexes" << indexNames;
+    qDebug() << "Full inventory export query without indexes" << withoutMs << "ms, with indexes" << withMs << "ms";
+    stampDB.closeDB();
+}
@@ -5,4 +5,19 @@ class TestAll: public QObject
     Q_OBJECT
 private slots:
     void testImageUtility();
+    void testColumnStorage();
+    void testFieldRef();
+    void testSort();
+    void testIdRowIndex();
+    void testValueIndex();
+    void testCopyOnWrite();
+    void testChunkedList();
+    void testBinaryRoundTrip();
+    void testCoalesceAddEditDelete();
+    void testCoalesceEdits();
+    void testCoalesceDeleteAdd();
+    void testCoalesceEditDelete();
+    void testSaveTrackedChanges();
+    void benchmarkCatalogLoad();
+    void benchmarkExport();
 };
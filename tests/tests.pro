@@ -15,11 +15,90 @@ QT += testlib
 SOURCES += \
     testmain.cpp \
     testall.cpp \
+    ../app/changedobject.cpp \
+    ../app/changedobjectbase.cpp \
+    ../app/changetracker.cpp \
+    ../app/changetrackerbase.cpp \
+    ../app/csvcolumn.cpp \
+    ../app/csvcontroller.cpp \
+    ../app/csvline.cpp \
+    ../app/csvreader.cpp \
+    ../app/csvwriter.cpp \
+    ../app/dbtransactionhandler.cpp \
+    ../app/describesqlfield.cpp \
+    ../app/describesqltable.cpp \
+    ../app/describesqltables.cpp \
+    ../app/genericdatacollection.cpp \
+    ../app/genericdatacollections.cpp \
+    ../app/genericdatacollectionstablemodel.cpp \
+    ../app/genericdatacolumn.cpp \
+    ../app/genericdataobject.cpp \
+    ../app/genericdataobjectfilter.cpp \
+    ../app/genericdataobjectpool.cpp \
+    ../app/genericdatavalueindex.cpp \
     ../app/imageutility.cpp \
+    ../app/linkedfieldselectioncache.cpp \
+    ../app/memoryusage.cpp \
+    ../app/preparedquerycache.cpp \
+    ../app/qtenummapper.cpp \
+    ../app/scrollmessagebox.cpp \
+    ../app/sqlfieldtype.cpp \
+    ../app/sqlfieldtypemaster.cpp \
+    ../app/stampdb.cpp \
+    ../app/tableeditfielddescriptor.cpp \
+    ../app/tableeditfielddescriptors.cpp \
+    ../app/tablepagereader.cpp \
+    ../app/tablesnapshotcache.cpp \
+    ../app/tablesortfield.cpp \
+    ../app/typemapper.cpp \
+    ../app/valuecomparer.cpp \
+    ../app/variantcomparer.cpp \
+    ../app/xmlutility.cpp \
 
 HEADERS += \
     testall.h \
+    ../app/changedobject.h \
+    ../app/changedobjectbase.h \
+    ../app/changetracker.h \
+    ../app/changetrackerbase.h \
+    ../app/chunkedlist.h \
+    ../app/csvcolumn.h \
+    ../app/csvcontroller.h \
+    ../app/csvline.h \
+    ../app/csvreader.h \
+    ../app/csvwriter.h \
+    ../app/dbtransactionhandler.h \
+    ../app/describesqlfield.h \
+    ../app/describesqltable.h \
+    ../app/describesqltables.h \
+    ../app/fieldref.h \
+    ../app/genericdatacollection.h \
+    ../app/genericdatacollections.h \
+    ../app/genericdatacollectionstablemodel.h \
+    ../app/genericdatacolumn.h \
+    ../app/genericdataobject.h \
+    ../app/genericdataobjectfilter.h \
+    ../app/genericdataobjectpool.h \
+    ../app/genericdatavalueindex.h \
+    ../app/globals.h \
     ../app/imageutility.h \
+    ../app/linkedfieldselectioncache.h \
+    ../app/memoryusage.h \
+    ../app/preparedquerycache.h \
+    ../app/qtenummapper.h \
+    ../app/scrollmessagebox.h \
+    ../app/sqlfieldtype.h \
+    ../app/sqlfieldtypemaster.h \
+    ../app/stampdb.h \
+    ../app/tableeditfielddescriptor.h \
+    ../app/tableeditfielddescriptors.h \
+    ../app/tablepagereader.h \
+    ../app/tablesnapshotcache.h \
+    ../app/tablesortfield.h \
+    ../app/typemapper.h \
+    ../app/valuecomparer.h \
+    ../app/variantcomparer.h \
+    ../app/xmlutility.h \
 
 INCLUDEPATH += \
     ../app 